@@ -5,6 +5,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "dynarray.h"
 #include "checkerDT.h"
@@ -14,9 +15,10 @@
 boolean CheckerDT_Node_isValid(Node_T n) {
    Node_T parent;
    const char* npath;
-   const char* ppath;
+   char* ppath;
    const char* rest;
    size_t i;
+   boolean result = FALSE;
 
    /* Sample check: a NULL pointer is not a valid node */
    if(n == NULL) {
@@ -25,157 +27,207 @@ boolean CheckerDT_Node_isValid(Node_T n) {
    }
 
    parent = Node_getParent(n);
-   if(parent != NULL) {
-      npath = Node_getPath(n);
-
-      /* Sample check that parent's path must be prefix of n's path */
-      ppath = Node_getPath(parent);
-      i = strlen(ppath);
-      if(strncmp(npath, ppath, i)) {
-         fprintf(stderr, "P's path is not a prefix of C's path\n");
-         return FALSE;
-      }
-      /* Check that next char after parent's path is '/' */
-      rest = npath + i;
-      if (strstr(rest, "/") != rest) {
-         fprintf(stderr, "C is not child of P\n");
-         return FALSE;
-      }
-      /* Sample check that n's path after parent's path + '/'
-         must have no further '/' characters */
-      rest++;
-      if(strstr(rest, "/") != NULL) {
-         fprintf(stderr, "C's path has grandchild of P's path\n");
-         return FALSE;
-      }
-      /* Check that child's path continues after parent's */
-      if(strstr(rest, "\0") != rest) {
-         fprintf(stderr, "C's path does not continue after P's path\n");
-         return FALSE;
-      }
+   if(parent == NULL)
+      return TRUE;
+
+   /* Node_getPath may reuse its string, so the parent's path is
+      copied before the child's is asked for */
+   npath = Node_getPath(parent);
+   if(npath == NULL) {
+      fprintf(stderr, "Cannot build P's path\n");
+      return FALSE;
    }
+   i = strlen(npath);
+   ppath = malloc(i + 1);
+   if(ppath == NULL) {
+      fprintf(stderr, "Cannot allocate memory to check a node\n");
+      return FALSE;
+   }
+   strcpy(ppath, npath);
+   npath = Node_getPath(n);
+   rest = npath == NULL ? NULL : npath + i;
 
-   return TRUE;
+   if(npath == NULL)
+      fprintf(stderr, "Cannot build C's path\n");
+   /* Sample check that parent's path must be prefix of n's path */
+   else if(strncmp(npath, ppath, i))
+      fprintf(stderr, "P's path is not a prefix of C's path\n");
+   /* Check that next char after parent's path is '/' */
+   else if(*rest != '/')
+      fprintf(stderr, "C is not child of P\n");
+   /* Sample check that n's path after parent's path + '/'
+      must have no further '/' characters */
+   else if(strchr(rest + 1, '/') != NULL)
+      fprintf(stderr, "C's path has grandchild of P's path\n");
+   /* Check that child's path continues after parent's */
+   else if(rest[1] == '\0')
+      fprintf(stderr, "C's path does not continue after P's path\n");
+   else
+      result = TRUE;
+
+   free(ppath);
+   return result;
 }
 
 /*
-   Performs a pre-order traversal of the tree rooted at n.
-   Returns FALSE if a broken invariant is found and
-   returns TRUE otherwise. Specifically checks if
-   Node_T invariants are followed and if DT links are 
-   correct.
+   Pushes the children of n onto stack, the last child first, so that
+   they are popped in order. The checks walk the tree with a stack
+   on the heap rather than by recursion, so that they can check a
+   tree of any depth.
+   Returns FALSE if stack cannot grow, and TRUE otherwise.
 */
-static boolean CheckerDT_treeCheck(Node_T n) {
+static boolean CheckerDT_pushChildren(DynArray_T stack, Node_T n) {
    size_t c;
 
-   if(n != NULL) {
+   assert(stack != NULL);
+   assert(n != NULL);
 
-      /* Sample check on each non-root node: node must be valid */
-      /* If not, pass that failure back up immediately */
-      if(!CheckerDT_Node_isValid(n))
+   for(c = Node_getNumChildren(n); c > 0; c--)
+      if(!DynArray_add(stack, Node_getChild(n, c - 1))) {
+         fprintf(stderr, "Cannot allocate memory to walk the tree\n");
          return FALSE;
-
-
-      for(c = 0; c < Node_getNumChildren(n); c++)
-      {
-         Node_T child = Node_getChild(n, c);
-
-         /* Check that Parent-Child links are correct */
-         if (Node_getParent(child) != n) {
-            fprintf(stderr,
-                    "Children does not have link to correct parent\n");
-            return FALSE;
-         }
-
-         /* if recurring down one subtree results in a failed check
-            farther down, passes the failure back up immediately */
-         if(!CheckerDT_treeCheck(child))
-            return FALSE;
       }
-   }
    return TRUE;
 }
 
-/* 
-   Performs a pre-order traversal of the tree rooted at n.
-   Returns the number of nodes within that tree.
+/*
+   Returns a new stack holding only n, or NULL if there is an
+   allocation error.
 */
-static size_t CheckerDT_nodeCount(Node_T n) {
-   size_t c;
-   size_t count;
+static DynArray_T CheckerDT_newStack(Node_T n) {
+   DynArray_T stack;
 
-   if (n == NULL) return 0;
-   else count = 1;
+   assert(n != NULL);
 
-   for(c = 0; c < Node_getNumChildren(n); c++) {
-      Node_T child = Node_getChild(n, c);
-
-      count += CheckerDT_nodeCount(child);
+   stack = DynArray_new(0);
+   if(stack != NULL && !DynArray_add(stack, n)) {
+      DynArray_free(stack);
+      stack = NULL;
    }
-
-   return count;
+   if(stack == NULL)
+      fprintf(stderr, "Cannot allocate memory to walk the tree\n");
+   return stack;
 }
 
 /*
-   Performs a pre-order traversal of the tree rooted at n.
-   Returns FALSE if the number of nodes in the tree does 
-   not match count, and returns TRUE otherwise.
+   Pops the node on top of stack, which must not be empty.
 */
-static boolean CheckerDT_treeCountCheck(Node_T n, size_t count) {
-   size_t c;
-   c = CheckerDT_nodeCount(n);
-   if (c == count) return TRUE;
-   fprintf(stderr, "count does not match number of nodes in tree\n");
-   return FALSE;
+static Node_T CheckerDT_pop(DynArray_T stack) {
+   assert(stack != NULL);
+   assert(DynArray_getLength(stack) > 0);
+
+   return DynArray_removeAt(stack, DynArray_getLength(stack) - 1);
 }
 
-/* 
-   Performs a pre-order traversal of the tree rooted at n.
-   Checks that the children of each node are ordered correctly.
-   Returns TRUE if lexicographic order is followed, FALSE 
-   otherwise.
+/*
+   Checks n and the links to its children: n must be valid, each child
+   must link back to n as its parent, and the children must be in
+   lexicographic order.
+   Returns FALSE if a broken invariant is found and TRUE otherwise.
 */
-static boolean CheckerDT_orderCheck(Node_T n) {
+static boolean CheckerDT_nodeCheck(Node_T n) {
    size_t c;
-   int compare;
 
-   if(n != NULL) {
+   assert(n != NULL);
 
-      if(Node_getNumChildren(n) > 1) {
-         for(c = 0; c < Node_getNumChildren(n) - 1; c++)
-         {
-            compare = Node_compare(Node_getChild(n, c),
-                                   Node_getChild(n, c + 1));
-
-            if(compare >= 0) {
-               fprintf(stderr,
-                       "Children do not follow lexicographic order\n");
-               return FALSE;
-            }
-         }
-      }
+   /* Sample check on each non-root node: node must be valid */
+   if(!CheckerDT_Node_isValid(n))
+      return FALSE;
 
-      /* Run pre-order traversal */
-      for(c = 0; c < Node_getNumChildren(n); c++) {
-         if (!CheckerDT_orderCheck(Node_getChild(n, c))) return FALSE;
+   for(c = 0; c < Node_getNumChildren(n); c++) {
+      /* Check that Parent-Child links are correct */
+      if(Node_getParent(Node_getChild(n, c)) != n) {
+         fprintf(stderr,
+                 "Children does not have link to correct parent\n");
+         return FALSE;
+      }
+      if(c > 0 && Node_compare(Node_getChild(n, c - 1),
+                               Node_getChild(n, c)) >= 0) {
+         fprintf(stderr,
+                 "Children do not follow lexicographic order\n");
+         return FALSE;
       }
    }
    return TRUE;
 }
 
 /*
-   Calls multiple other checks on the tree rooted at x with count.
-   Returns FALSE if any test fails, and TRUE otherwise.
+   Performs a pre-order traversal of the tree rooted at n, checking
+   each node with CheckerDT_nodeCheck and counting the nodes as it
+   goes, so that the whole tree is walked only once.
+   Returns FALSE if a broken invariant is found or the number of nodes
+   in the tree does not match count, and returns TRUE otherwise.
 */
 static boolean CheckerDT_treeFullCheck(Node_T n, size_t count) {
-   if (!CheckerDT_treeCountCheck(n, count)) return FALSE;
-   if (!CheckerDT_treeCheck(n)) return FALSE;
-   if (!CheckerDT_orderCheck(n)) return FALSE;
+   DynArray_T stack;
+   boolean result = TRUE;
+   size_t nodes = 0;
+
+   if(n != NULL) {
+      if((stack = CheckerDT_newStack(n)) == NULL)
+         return FALSE;
+
+      /* a failed check farther down passes the failure back up
+         immediately */
+      while(result && DynArray_getLength(stack) > 0) {
+         n = CheckerDT_pop(stack);
+         nodes++;
+         result = CheckerDT_nodeCheck(n) &&
+                  CheckerDT_pushChildren(stack, n);
+      }
+      DynArray_free(stack);
+      if(!result)
+         return FALSE;
+   }
+
+   if(nodes != count) {
+      fprintf(stderr, "count does not match number of nodes in tree\n");
+      return FALSE;
+   }
    return TRUE;
 }
 
-/* see checkerDT.h for specification */
-boolean CheckerDT_isValid(boolean isInit, Node_T root, size_t count) {
+/*
+   Checks changed and each of its ancestors with CheckerDT_nodeCheck,
+   and that each of them is the child of its parent that has its path,
+   up to root, which must be where the ancestors end.
+   Returns FALSE if a broken invariant is found and TRUE otherwise.
+*/
+static boolean CheckerDT_pathCheck(Node_T root, Node_T changed) {
+   Node_T n;
+   Node_T parent;
+   const char* path;
+   size_t childID;
+
+   assert(changed != NULL);
+
+   for(n = changed; (parent = Node_getParent(n)) != NULL; n = parent) {
+      if(!CheckerDT_nodeCheck(n))
+         return FALSE;
+      if((path = Node_getPath(n)) == NULL) {
+         fprintf(stderr, "Cannot build C's path\n");
+         return FALSE;
+      }
+      if(Node_hasChild(parent, path, &childID) != 1 ||
+         Node_getChild(parent, childID) != n) {
+         fprintf(stderr, "P does not have a link to its child C\n");
+         return FALSE;
+      }
+   }
+   if(n != root) {
+      fprintf(stderr, "A node is not in the tree under the root\n");
+      return FALSE;
+   }
+   return CheckerDT_nodeCheck(n);
+}
+
+/*
+   Checks the invariants of the data structure as a whole, which do
+   not require walking the tree.
+   Returns FALSE if a broken invariant is found and TRUE otherwise.
+*/
+static boolean CheckerDT_stateCheck(boolean isInit, Node_T root,
+                                    size_t count) {
 
    /* Sample check on a top-level data structure invariant:
       if the DT is not initialized, its count should be 0. */
@@ -201,6 +253,37 @@ boolean CheckerDT_isValid(boolean isInit, Node_T root, size_t count) {
          fprintf(stderr, "Root node has a parent\n");
       }
 
-   /* Now checks invariants recursively at each node from the root. */
+   return TRUE;
+}
+
+/*
+   The number of calls of CheckerDT_isValidAt since the whole tree
+   was last checked.
+*/
+static size_t checksSinceFull;
+
+/* see checkerDT.h for specification */
+boolean CheckerDT_isValid(boolean isInit, Node_T root, size_t count) {
+   if(!CheckerDT_stateCheck(isInit, root, count))
+      return FALSE;
+
+   /* Now checks invariants at each node from the root. */
+   checksSinceFull = 0;
    return CheckerDT_treeFullCheck(root, count);
 }
+
+/* see checkerDT.h for specification */
+boolean CheckerDT_isValidAt(boolean isInit, Node_T root, size_t count,
+                            Node_T changed) {
+
+   /* Walking the whole tree once every count calls costs each call
+      a constant on average, however large the tree grows */
+   if(++checksSinceFull > count)
+      return CheckerDT_isValid(isInit, root, count);
+
+   if(!CheckerDT_stateCheck(isInit, root, count))
+      return FALSE;
+   if(changed == NULL)
+      return TRUE;
+   return CheckerDT_pathCheck(root, changed);
+}
@@ -24,4 +24,17 @@ boolean CheckerDT_Node_isValid(Node_T n);
 */
 boolean CheckerDT_isValid(boolean isInit, Node_T root, size_t count);
 
+/*
+   Returns TRUE if the hierarchy is in a valid state or FALSE
+   otherwise, as CheckerDT_isValid does, but checks only the nodes a
+   change could have broken: changed, the deepest node the change
+   added children to, removed children from or created, and each of
+   its ancestors, along with their links to their children. changed
+   may be NULL if the call changed no node. Once every count calls,
+   the whole hierarchy is checked instead, so that the cost of a call
+   stays constant on average however large the hierarchy grows.
+*/
+boolean CheckerDT_isValidAt(boolean isInit, Node_T root, size_t count,
+                            Node_T changed);
+
 #endif
@@ -25,34 +25,39 @@ static size_t count;
 /*
    Starting at the parameter curr, traverses as far down
    the hierarchy as possible while still matching the path
-   parameter.
+   parameter, one path component at a time. Each component is
+   located among the current node's sorted children by binary search.
 
    Returns a pointer to the farthest matching node down that path,
    or NULL if there is no node in curr's hierarchy that matches
    a prefix of the path
 */
 static Node_T DT_traversePathFrom(char* path, Node_T curr) {
-   Node_T found;
-   size_t i;
+   Node_T child;
+   size_t length;
+   size_t next;
 
    assert(path != NULL);
 
    if(curr == NULL)
       return NULL;
 
-   else if(!strcmp(path,Node_getPath(curr)))
-      return curr;
+   length = Node_getPathLength(curr);
+   if(strlen(path) < length || !Node_hasPath(curr, path, length))
+      return NULL;
+   if(path[length] != '\0' && path[length] != '/')
+      return NULL;
 
-   else if(!strncmp(path, Node_getPath(curr), strlen(Node_getPath(curr)))) {
-      for(i = 0; i < Node_getNumChildren(curr); i++) {
-         found = DT_traversePathFrom(path,
-                                Node_getChild(curr, i));
-         if(found != NULL)
-            return found;
-      }
-      return curr;
+   /* Descends while the next component names one of curr's children */
+   while(path[length] == '/') {
+      next = strcspn(path + length + 1, "/");
+      child = Node_findChild(curr, path + length + 1, next);
+      if(child == NULL)
+         break;
+      curr = child;
+      length += 1 + next;
    }
-   return NULL;
+   return curr;
 }
 
 /*
@@ -127,10 +132,10 @@ static int DT_insertRestOfPath(char* path, Node_T parent) {
       }
    }
    else {
-      if(!strcmp(path, Node_getPath(curr)))
+      if(Node_hasPath(curr, path, strlen(path)))
          return ALREADY_IN_TREE;
 
-      restPath += (strlen(Node_getPath(curr)) + 1);
+      restPath += Node_getPathLength(curr) + 1;
    }
 
    copyPath = malloc(strlen(restPath)+1);
@@ -189,14 +194,17 @@ int DT_insertPath(char* path) {
    Node_T curr;
    int result;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(CheckerDT_isValidAt(isInitialized,root,count,NULL));
    assert(path != NULL);
 
    if(!isInitialized)
       return INITIALIZATION_ERROR;
    curr = DT_traversePath(path);
    result = DT_insertRestOfPath(path, curr);
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   /* the farthest node down path is the new one, or curr if nothing
+      was inserted */
+   assert(CheckerDT_isValidAt(isInitialized,root,count,
+                              DT_traversePath(path)));
    return result;
 }
 
@@ -205,7 +213,7 @@ boolean DT_containsPath(char* path) {
    Node_T curr;
    boolean result;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(CheckerDT_isValidAt(isInitialized,root,count,NULL));
    assert(path != NULL);
 
    if(!isInitialized)
@@ -216,12 +224,12 @@ boolean DT_containsPath(char* path) {
 
    if(curr == NULL)
       result = FALSE;
-   else if(strcmp(path, Node_getPath(curr)))
+   else if(!Node_hasPath(curr, path, strlen(path)))
       result = FALSE;
    else
       result = TRUE;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(CheckerDT_isValidAt(isInitialized,root,count,NULL));
    return result;
 }
 
@@ -241,7 +249,7 @@ static int DT_rmPathAt(char* path, Node_T curr) {
 
    parent = Node_getParent(curr);
 
-   if(!strcmp(path,Node_getPath(curr))) {
+   if(Node_hasPath(curr, path, strlen(path))) {
       if(parent == NULL)
          root = NULL;
       else
@@ -261,7 +269,7 @@ int DT_rmPath(char* path) {
    Node_T curr;
    int result;
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   assert(CheckerDT_isValidAt(isInitialized,root,count,NULL));
    assert(path != NULL);
 
    if(!isInitialized)
@@ -273,7 +281,9 @@ int DT_rmPath(char* path) {
    else
       result = DT_rmPathAt(path, curr);
 
-   assert(CheckerDT_isValid(isInitialized,root,count));
+   /* once path is gone, the farthest node down it is its parent */
+   assert(CheckerDT_isValidAt(isInitialized,root,count,
+                              DT_traversePath(path)));
    return result;
 }
 
@@ -304,75 +314,87 @@ int DT_destroy(void) {
 
 
 /*
-   Performs a pre-order traversal of the tree rooted at n,
-   inserting each payload to DynArray_T d beginning at index i.
-   Returns the next unused index in d after the insertion(s).
+   Performs a pre-order traversal of the tree rooted at n, calling
+   (*pfApply)(node, length, pvExtra) with each node and the length of
+   its path, in the order DT_toString lists them.
 */
-static size_t DT_preOrderTraversal(Node_T n, DynArray_T d, size_t i) {
+static void DT_preOrderTraversal(Node_T n,
+                                 void (*pfApply)(Node_T node,
+                                                 size_t length,
+                                                 void* pvExtra),
+                                 void* pvExtra) {
    size_t c;
 
-   assert(d != NULL);
+   assert(pfApply != NULL);
 
    if(n != NULL) {
-      (void) DynArray_set(d, i, Node_getPath(n));
-      i++;
+      (*pfApply)(n, Node_getPathLength(n), pvExtra);
       for(c = 0; c < Node_getNumChildren(n); c++)
-         i = DT_preOrderTraversal(Node_getChild(n, c), d, i);
+         DT_preOrderTraversal(Node_getChild(n, c), pfApply, pvExtra);
    }
-   return i;
 }
 
 /*
-   Alternate version of strlen that uses pAcc as an in-out parameter
-   to accumulate a string length, rather than returning the length of
-   str, and also always adds one more in addition to str's length.
+   Accumulates into the size_t pointed to by pvAcc the length of
+   one line of DT_toString output: length plus one for the newline.
 */
-static void DT_strlenAccumulate(char* str, size_t* pAcc) {
-   assert(pAcc != NULL);
+static void DT_strlenAccumulate(Node_T node, size_t length,
+                                void* pvAcc) {
+   (void) node;
+   assert(pvAcc != NULL);
 
-   if(str != NULL)
-      *pAcc += (strlen(str) + 1);
+   *(size_t*) pvAcc += length + 1;
 }
 
 /*
-   Alternate version of strcat that inverts the typical argument
-   order, appending str onto acc, and also always adds a newline at
-   the end of the concatenated string.
+   A string under construction by DT_toString, along with the offset
+   of its end, so that each line is written in place instead of
+   rescanning the string to find its end.
+*/
+struct dtBuffer {
+   char* string;
+   size_t end;
+};
+
+/*
+   Appends the path of node, which has length characters, and a
+   newline at the end of the struct dtBuffer pointed to by pvAcc. The
+   path is built in place, so no node keeps a copy of it.
 */
-static void DT_strcatAccumulate(char* str, char* acc) {
+static void DT_copyAccumulate(Node_T node, size_t length,
+                              void* pvAcc) {
+   struct dtBuffer* acc = pvAcc;
+
+   assert(node != NULL);
    assert(acc != NULL);
 
-   if(str != NULL)
-      strcat(acc, str); strcat(acc, "\n");
+   (void) Node_writePath(node, acc->string + acc->end);
+   acc->end += length;
+   acc->string[acc->end++] = '\n';
 }
 
 /* see dt.h for specification */
 char* DT_toString(void) {
-   DynArray_T nodes;
+   struct dtBuffer acc;
    size_t totalStrlen = 1;
-   char* result = NULL;
 
    assert(CheckerDT_isValid(isInitialized,root,count));
 
    if(!isInitialized)
       return NULL;
 
-   nodes = DynArray_new(count);
-   (void) DT_preOrderTraversal(root, nodes, 0);
-
-   DynArray_map(nodes, (void (*)(void *, void*)) DT_strlenAccumulate, (void*) &totalStrlen);
+   DT_preOrderTraversal(root, DT_strlenAccumulate, &totalStrlen);
 
-   result = malloc(totalStrlen);
-   if(result == NULL) {
-      DynArray_free(nodes);
+   acc.string = malloc(totalStrlen);
+   if(acc.string == NULL) {
       assert(CheckerDT_isValid(isInitialized,root,count));
       return NULL;
    }
-   *result = '\0';
+   acc.end = 0;
 
-   DynArray_map(nodes, (void (*)(void *, void*)) DT_strcatAccumulate, (void *) result);
+   DT_preOrderTraversal(root, DT_copyAccumulate, &acc);
+   acc.string[acc.end] = '\0';
 
-   DynArray_free(nodes);
    assert(CheckerDT_isValid(isInitialized,root,count));
-   return result;
+   return acc.string;
 }
@@ -12,6 +12,9 @@
 /*
    a Node_T is an object that contains a path payload and references to
    the node's parent (if it exists) and children (if they exist).
+   Only the last component of the path is stored in the node; the full
+   path is built from the names of its ancestors whenever it is
+   needed, and never kept.
 */
 typedef struct node* Node_T;
 
@@ -48,10 +51,37 @@ size_t Node_destroy(Node_T n);
 int Node_compare(Node_T node1, Node_T node2);
 
 /*
-   Returns n's path.
+   Returns n's path, or NULL if there is an allocation error in
+   building it. The string belongs to the node module and may be
+   overwritten by the next call of Node_getPath, or freed when a root
+   is destroyed, so a caller that needs two paths at once must copy
+   the first.
 */
 const char* Node_getPath(Node_T n);
 
+/*
+   Returns the length of n's path, not counting the '\0'. Walks up to
+   the root, so takes time proportional to n's depth.
+
+   This and the two functions below are only in nodeGood.c: checkerDT.c
+   is linked with every node implementation, so it sticks to
+   Node_getPath.
+*/
+size_t Node_getPathLength(Node_T n);
+
+/*
+   Writes n's path into path, which must have room for
+   Node_getPathLength(n) + 1 characters, and returns path.
+*/
+char* Node_writePath(Node_T n, char* path);
+
+/*
+   Returns TRUE if n's path is the first length characters of path,
+   and FALSE otherwise. Compares names from n up to the root, so it
+   never allocates memory.
+*/
+boolean Node_hasPath(Node_T n, const char* path, size_t length);
+
 /*
   Returns the number of child directories n has.
 */
@@ -74,6 +104,14 @@ int Node_hasChild(Node_T n, const char* path, size_t* childID);
 */
 Node_T Node_getChild(Node_T n, size_t childID);
 
+/*
+   Returns the child node of n whose name (the last component of its
+   path) is the first length characters of name, or NULL if n has no
+   such child. Binary searches n's sorted children, so name need not
+   be NUL-terminated after length.
+*/
+Node_T Node_findChild(Node_T n, const char* name, size_t length);
+
 /*
    Returns the parent node of n, if it exists, otherwise returns NULL
 */
@@ -16,49 +16,37 @@
    A node structure represents a directory in the directory tree
 */
 struct node {
-   /* the full path of this directory */
-   char* path;
+   /* the name of this directory: the last component of its path */
+   char* name;
 
    /* the parent directory of this directory
       NULL for the root of the directory tree */
    Node_T parent;
 
    /* the subdirectories of this directory
-      stored in sorted order by pathname */
+      stored in sorted order by name */
    DynArray_T children;
 };
 
 
 /*
-  returns a path with contents
-  n->path/dir
-  or NULL if there is an allocation error.
-
-  Allocates memory for the returned string,
-  which is then owned by the caller!
+   A search key for a child of some node: the first length characters
+   of name. Lets the children be binary searched without building a
+   throwaway node for the comparison.
 */
-static char* Node_buildPath(Node_T n, const char* dir) {
-   char* path;
-
-   assert(dir != NULL);
-
-   if(n == NULL)
-      path = malloc(strlen(dir)+1);
-   else
-      path = malloc(strlen(n->path) + 1 + strlen(dir) + 1);
+struct nodeKey {
+   const char* name;
+   size_t length;
+};
 
-   if(path == NULL)
-      return NULL;
-   *path = '\0';
 
-   if(n != NULL) {
-      strcpy(path, n->path);
-      strcat(path, "/");
-   }
-   strcat(path, dir);
-
-   return path;
-}
+/*
+   The buffer Node_getPath builds paths in, and its size. It only
+   grows, so it holds the longest path asked for so far, until a root
+   is destroyed, which frees it.
+*/
+static char* pathBuffer;
+static size_t pathBufferSize;
 
 /* see node.h for specification */
 Node_T Node_create(const char* dir, Node_T parent){
@@ -73,18 +61,19 @@ Node_T Node_create(const char* dir, Node_T parent){
       return NULL;
    }
 
-   new->path = Node_buildPath(parent, dir);
+   new->name = malloc(strlen(dir) + 1);
 
-   if(new->path == NULL) {
+   if(new->name == NULL) {
       free(new);
       assert(parent == NULL || CheckerDT_Node_isValid(parent));
       return NULL;
    }
 
+   strcpy(new->name, dir);
    new->parent = parent;
    new->children = DynArray_new(0);
    if(new->children == NULL) {
-      free(new->path);
+      free(new->name);
       free(new);
       assert(parent == NULL || CheckerDT_Node_isValid(parent));
       return NULL;
@@ -110,7 +99,14 @@ size_t Node_destroy(Node_T n) {
    }
    DynArray_free(n->children);
 
-   free(n->path);
+   /* Without a root, no path needs the buffer */
+   if(n->parent == NULL) {
+      free(pathBuffer);
+      pathBuffer = NULL;
+      pathBufferSize = 0;
+   }
+
+   free(n->name);
    free(n);
    count++;
 
@@ -118,30 +114,138 @@ size_t Node_destroy(Node_T n) {
 }
 
 /* see node.h for specification */
-/*char* Node_getPath(Node_T n) {
-   char* pathCopy;
+size_t Node_getPathLength(Node_T n) {
+   size_t length;
 
    assert(n != NULL);
 
-   pathCopy = malloc(strlen(n->path)+1);
-   if(pathCopy == NULL)
-      return NULL;
+   length = strlen(n->name);
+   for(n = n->parent; n != NULL; n = n->parent)
+      length += strlen(n->name) + 1;
 
-   return strcpy(pathCopy, n->path);
+   return length;
 }
-*/
+
+/* see node.h for specification */
+char* Node_writePath(Node_T n, char* path) {
+   char* end;
+   size_t length;
+
+   assert(n != NULL);
+   assert(path != NULL);
+
+   /* Fills in the names from the last component back to the root */
+   end = path + Node_getPathLength(n);
+   *end = '\0';
+   for(;;) {
+      length = strlen(n->name);
+      end -= length;
+      memcpy(end, n->name, length);
+      n = n->parent;
+      if(n == NULL)
+         break;
+      *--end = '/';
+   }
+   assert(end == path);
+
+   return path;
+}
+
+/* see node.h for specification */
+boolean Node_hasPath(Node_T n, const char* path, size_t length) {
+   size_t nameLength;
+
+   assert(n != NULL);
+   assert(path != NULL);
+
+   /* Matches the names against path from its last component back */
+   for(;;) {
+      nameLength = strlen(n->name);
+      if(length < nameLength ||
+         memcmp(path + length - nameLength, n->name, nameLength) != 0)
+         return FALSE;
+      length -= nameLength;
+      n = n->parent;
+      if(n == NULL)
+         return (boolean) (length == 0);
+      if(length == 0 || path[length - 1] != '/')
+         return FALSE;
+      length--;
+   }
+}
+
+/* see node.h for specification */
 const char* Node_getPath(Node_T n) {
+   size_t size;
+   char* grown;
+
+   assert(n != NULL);
+
+   size = Node_getPathLength(n) + 1;
+   if(size > pathBufferSize) {
+      grown = realloc(pathBuffer, size);
+      if(grown == NULL)
+         return NULL;
+      pathBuffer = grown;
+      pathBufferSize = size;
+   }
+   return Node_writePath(n, pathBuffer);
+}
+
+/* Returns the number of ancestors n has. */
+static size_t Node_getDepth(Node_T n) {
+   size_t depth = 0;
+
    assert(n != NULL);
 
-   return n->path;
+   for(n = n->parent; n != NULL; n = n->parent)
+      depth++;
+   return depth;
 }
 
 /* see node.h for specification */
 int Node_compare(Node_T node1, Node_T node2) {
+   Node_T a1 = node1;
+   Node_T a2 = node2;
+   size_t depth1;
+   size_t depth2;
+   size_t d;
+   const char* s1;
+   const char* s2;
+   int c1;
+   int c2;
+
    assert(node1 != NULL);
    assert(node2 != NULL);
 
-   return strcmp(node1->path, node2->path);
+   /* Siblings' paths differ only in their last component */
+   if(node1->parent == node2->parent)
+      return strcmp(node1->name, node2->name);
+
+   /* Otherwise climbs to the ancestors of each just below the deepest
+      ancestor they share, without building either path */
+   depth1 = Node_getDepth(node1);
+   depth2 = Node_getDepth(node2);
+   for(d = depth1; d > depth2; d--)
+      a1 = a1->parent;
+   for(d = depth2; d > depth1; d--)
+      a2 = a2->parent;
+   /* A path is less than the paths below it, which it is a prefix of */
+   if(a1 == a2)
+      return depth1 < depth2 ? -1 : 1;
+   while(a1->parent != a2->parent) {
+      a1 = a1->parent;
+      a2 = a2->parent;
+   }
+
+   /* The paths first differ within the names of a1 and a2, or where
+      one of those names ends, and is followed by a '/' or by the end
+      of the path */
+   for(s1 = a1->name, s2 = a2->name; *s1 != '\0' && *s1 == *s2; s1++)
+      s2++;
+   c1 = *s1 != '\0' ? (unsigned char) *s1 : (a1 == node1 ? 0 : '/');
+   c2 = *s2 != '\0' ? (unsigned char) *s2 : (a2 == node2 ? 0 : '/');
+   return c1 - c2;
 }
 
 /* see node.h for specification */
@@ -151,22 +255,51 @@ size_t Node_getNumChildren(Node_T n) {
    return DynArray_getLength(n->children);
 }
 
+/*
+   Compares the first key->length characters of key->name, taken as
+   a node's name, against n's name, using the same ordering as
+   Node_compare does for siblings.
+   Returns <0, 0, or >0 if the key is less than, equal to, or greater
+   than n, respectively.
+*/
+static int Node_compareKey(const struct nodeKey* key, Node_T n) {
+   int result;
+
+   assert(key != NULL);
+   assert(n != NULL);
+
+   result = strncmp(key->name, n->name, key->length);
+   if(result != 0)
+      return result;
+   /* The key is a proper prefix of n's name */
+   if(n->name[key->length] != '\0')
+      return -1;
+   return 0;
+}
+
 /* see node.h for specification */
 int Node_hasChild(Node_T n, const char* path, size_t* childID) {
+   struct nodeKey key;
+   const char* name;
    size_t index;
    int result;
-   Node_T checker;
 
    assert(n != NULL);
    assert(path != NULL);
 
-   checker = Node_create(path, NULL);
-   if(checker == NULL) {
-      return -1;
-   }
-   result = DynArray_bsearch(n->children, checker, &index,
-                    (int (*)(const void*, const void*)) Node_compare);
-   (void) Node_destroy(checker);
+   /* A child's name is the last component of its path */
+   name = strrchr(path, '/');
+   name = (name == NULL) ? path : name + 1;
+
+   key.name = name;
+   key.length = strlen(name);
+   result = DynArray_bsearch(n->children, &key, &index,
+         (int (*)(const void*, const void*)) Node_compareKey);
+
+   /* ... and the rest of its path is n's path */
+   if(result == 1 && (name == path ||
+         !Node_hasPath(n, path, (size_t) (name - 1 - path))))
+      result = 0;
 
    if(childID != NULL)
       *childID = index;
@@ -174,6 +307,22 @@ int Node_hasChild(Node_T n, const char* path, size_t* childID) {
    return result;
 }
 
+/* see node.h for specification */
+Node_T Node_findChild(Node_T n, const char* name, size_t length) {
+   struct nodeKey key;
+   size_t i;
+
+   assert(n != NULL);
+   assert(name != NULL);
+
+   key.name = name;
+   key.length = length;
+   if(DynArray_bsearch(n->children, &key, &i,
+         (int (*)(const void*, const void*)) Node_compareKey) == 1)
+      return DynArray_get(n->children, i);
+   return NULL;
+}
+
 /* see node.h for specification */
 Node_T Node_getChild(Node_T n, size_t childID) {
    assert(n != NULL);
@@ -196,32 +345,22 @@ Node_T Node_getParent(Node_T n) {
 /* see node.h for specification */
 int Node_linkChild(Node_T parent, Node_T child) {
    size_t i;
-   char* rest;
 
    assert(parent != NULL);
    assert(child != NULL);
    assert(CheckerDT_Node_isValid(parent));
    assert(CheckerDT_Node_isValid(child));
 
-   if(Node_hasChild(parent, child->path, NULL)) {
+   if(child->parent == parent &&
+      Node_findChild(parent, child->name, strlen(child->name)) != NULL) {
       assert(CheckerDT_Node_isValid(parent));
       assert(CheckerDT_Node_isValid(child));
       return ALREADY_IN_TREE;
    }
-   i = strlen(parent->path);
-   if(strncmp(child->path, parent->path, i)) {
-      assert(CheckerDT_Node_isValid(parent));
-      assert(CheckerDT_Node_isValid(child));
-      return PARENT_CHILD_ERROR;
-   }
-   rest = child->path + i;
-   if(strlen(child->path) >= i && rest[0] != '/') {
-      assert(CheckerDT_Node_isValid(parent));
-      assert(CheckerDT_Node_isValid(child));
-      return PARENT_CHILD_ERROR;
-   }
-   rest++;
-   if(strstr(rest, "/") != NULL) {
+   /* child's path is parent's path + / + its name only if it was
+      created under parent and its name is a single component */
+   if((child->parent != NULL && child->parent != parent) ||
+      *child->name == '\0' || strchr(child->name, '/') != NULL) {
       assert(CheckerDT_Node_isValid(parent));
       assert(CheckerDT_Node_isValid(child));
       return PARENT_CHILD_ERROR;
@@ -302,11 +441,11 @@ char* Node_toString(Node_T n) {
 
    assert(n != NULL);
 
-   copyPath = malloc(strlen(n->path)+1);
+   copyPath = malloc(Node_getPathLength(n) + 1);
    if(copyPath == NULL) {
       return NULL;
    }
    else {
-      return strcpy(copyPath, n->path);
+      return Node_writePath(n, copyPath);
    }
 }
@@ -0,0 +1,205 @@
+/*--------------------------------------------------------------------*/
+/* epoch.c                                                            */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for pthreads and sched_yield under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include "epoch.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The size of a cache line, to which each slot is padded so that
+   readers on different cores never share one. */
+
+enum { CACHE_LINE = 64 };
+
+/*--------------------------------------------------------------------*/
+
+/* A slot belongs to one thread at a time, and announces whether that
+   thread is inside a read-side critical section. */
+
+struct Slot
+{
+   /* The global epoch when the thread's outermost critical section
+      began, or 0 if the thread is not inside one. Written by the
+      owner, read by writers. */
+   unsigned long ulEpoch;
+
+   /* The depth of nesting of the thread's critical sections. Touched
+      only by the owner. */
+   unsigned long ulDepth;
+
+   /* While the slot is free, one more than the index of the next free
+      slot, or 0 if there is none. Guarded by registryLock. */
+   size_t uNextFree;
+
+   char acPad[CACHE_LINE - 2 * sizeof(unsigned long) - sizeof(size_t)];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* The global epoch, advanced by every Epoch_synchronize. It starts at
+   1 because 0 marks a slot as outside any critical section. */
+
+static unsigned long ulGlobalEpoch = 1;
+
+/* The slots, of which the first uHighWater have ever been used. */
+
+static struct Slot asSlots[EPOCH_MAX_THREADS];
+static size_t uHighWater;
+
+/* One more than the index of the first slot freed by an exiting
+   thread, or 0 if there is none. */
+
+static size_t uFreeHead;
+
+/* Guards the assignment of slots to threads. */
+
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The key under which each thread keeps its slot. */
+
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t slotKey;
+
+/*--------------------------------------------------------------------*/
+
+/* Put pvSlot, the slot of a thread that is exiting, on the list of
+   free slots. */
+
+static void Epoch_releaseSlot(void *pvSlot)
+{
+   struct Slot *psSlot = (struct Slot*)pvSlot;
+
+   assert(psSlot != NULL);
+   assert(psSlot->ulDepth == 0);
+
+   (void)pthread_mutex_lock(&registryLock);
+   psSlot->uNextFree = uFreeHead;
+   uFreeHead = (size_t)(psSlot - asSlots) + 1;
+   (void)pthread_mutex_unlock(&registryLock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Create slotKey, exiting the process if that is impossible. */
+
+static void Epoch_createKey(void)
+{
+   if (pthread_key_create(&slotKey, Epoch_releaseSlot) != 0)
+   {
+      fprintf(stderr, "epoch: cannot create thread key\n");
+      exit(EXIT_FAILURE);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the calling thread's slot, assigning it one on first use.
+   Exits the process if more than EPOCH_MAX_THREADS threads need
+   slots at once. */
+
+static struct Slot *Epoch_getSlot(void)
+{
+   struct Slot *psSlot;
+   size_t uIndex;
+
+   (void)pthread_once(&keyOnce, Epoch_createKey);
+   psSlot = (struct Slot*)pthread_getspecific(slotKey);
+   if (psSlot != NULL)
+      return psSlot;
+
+   (void)pthread_mutex_lock(&registryLock);
+   if (uFreeHead != 0)
+   {
+      uIndex = uFreeHead - 1;
+      uFreeHead = asSlots[uIndex].uNextFree;
+   }
+   else if (uHighWater < EPOCH_MAX_THREADS)
+   {
+      uIndex = uHighWater;
+      __atomic_store_n(&uHighWater, uHighWater + 1, __ATOMIC_RELEASE);
+   }
+   else
+   {
+      (void)pthread_mutex_unlock(&registryLock);
+      fprintf(stderr, "epoch: more than %d reading threads\n",
+              EPOCH_MAX_THREADS);
+      exit(EXIT_FAILURE);
+   }
+   (void)pthread_mutex_unlock(&registryLock);
+
+   psSlot = &asSlots[uIndex];
+   if (pthread_setspecific(slotKey, psSlot) != 0)
+   {
+      fprintf(stderr, "epoch: cannot record thread slot\n");
+      exit(EXIT_FAILURE);
+   }
+   return psSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_enter(void)
+{
+   struct Slot *psSlot = Epoch_getSlot();
+
+   if (psSlot->ulDepth++ == 0)
+   {
+      __atomic_store_n(&psSlot->ulEpoch,
+                       __atomic_load_n(&ulGlobalEpoch, __ATOMIC_RELAXED),
+                       __ATOMIC_RELAXED);
+      /* The announcement must be visible before any shared pointer is
+         read, or a writer could miss it and reuse what is read. */
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_exit(void)
+{
+   struct Slot *psSlot = (struct Slot*)pthread_getspecific(slotKey);
+
+   assert(psSlot != NULL);
+   assert(psSlot->ulDepth > 0);
+
+   if (--psSlot->ulDepth == 0)
+      __atomic_store_n(&psSlot->ulEpoch, 0, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+void Epoch_synchronize(void)
+{
+   unsigned long ulTarget;
+   unsigned long ulEpoch;
+   size_t uCount;
+   size_t u;
+
+   /* Every unlink the caller made must be visible before the slots
+      are read: a reader either announced itself in time to be seen
+      below, or will not find what was unlinked. */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   ulTarget = __atomic_add_fetch(&ulGlobalEpoch, 1, __ATOMIC_SEQ_CST);
+
+   uCount = __atomic_load_n(&uHighWater, __ATOMIC_ACQUIRE);
+   for (u = 0; u < uCount; u++)
+   {
+      for (;;)
+      {
+         ulEpoch = __atomic_load_n(&asSlots[u].ulEpoch, __ATOMIC_ACQUIRE);
+         if (ulEpoch == 0 || ulEpoch >= ulTarget)
+            break;
+         (void)sched_yield();
+      }
+   }
+}
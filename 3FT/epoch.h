@@ -0,0 +1,41 @@
+/*--------------------------------------------------------------------*/
+/* epoch.h                                                            */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#ifndef EPOCH_INCLUDED
+#define EPOCH_INCLUDED
+
+/* The epoch module lets readers use shared data without locks, while
+   writers wait before reusing memory that readers may still hold.
+   A reader brackets its accesses with Epoch_enter and Epoch_exit. A
+   writer that has unlinked some memory calls Epoch_synchronize, after
+   which no reader can still be using it. Each thread announces its
+   reads in a slot of its own, so readers never write to shared cache
+   lines. At most EPOCH_MAX_THREADS threads may read at once. */
+
+enum { EPOCH_MAX_THREADS = 1024 };
+
+/*--------------------------------------------------------------------*/
+
+/* Begin a read-side critical section of the calling thread. Critical
+   sections may nest. */
+
+void Epoch_enter(void);
+
+/*--------------------------------------------------------------------*/
+
+/* End the innermost read-side critical section of the calling
+   thread. */
+
+void Epoch_exit(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Wait until every read-side critical section that began before the
+   call has ended. Must not be called from within a critical
+   section. */
+
+void Epoch_synchronize(void);
+
+#endif
@@ -1,520 +1,1590 @@
 /* ft.c
    Authors: Rohan Amin and Alex Luo */
 
+#if defined(FT_THREADSAFE) || defined(FT_STATS)
+/* for pthread_mutex_t and clock_gettime under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#ifdef FT_THREADSAFE
+#include <pthread.h>
+#include "epoch.h"
+#endif
+
+#ifdef FT_STATS
+#include <time.h>
+#endif
+
 #include "ft.h"
 #include <assert.h>
 #include <stddef.h>
 #include "a4def.h"
 #include "node.h"
-#include "dynarray.h"
+#include "pool.h"
+#include "pathindex.h"
+#include "ftimage.h"
+#include "journal.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+
+
+/* A File Tree is an ADT with 8 state variables,
+   plus a lock in the thread-safe build: */
+struct ft {
+   /* a pointer to the root node in the hierarchy */
+   Node_T root;
+
+   /* a counter of the number of nodes in the hierarchy */
+   size_t count;
+
+   /* the pool from which the nodes, their names and their children
+      arrays are allocated, so that FT_free frees them all at once */
+   Pool_T pool;
+
+   /* the index from full path to node, NULL unless enabled by
+      FT_enableIndexIn */
+   PathIndex_T index;
+
+   /* the journal that every change to the hierarchy is appended to,
+      NULL unless opened by FT_openJournalIn, and the size at which
+      it is next compacted into a snapshot */
+   Journal_T journal;
+   size_t compactSize;
+
+   /* for a snapshot, the tree it was taken of, whose pool holds its
+      nodes and whose lock guards their holds; NULL for a live tree */
+   FT_T source;
+
+   /* the number of snapshots taken of this tree and not yet freed:
+      while there are none, no node is shared and none is copied */
+   size_t snapshots;
+
+#ifdef FT_THREADSAFE
+   /* held by the functions that change the tree and by the
+      traversals; lookups take no lock at all */
+   pthread_mutex_t lock;
+#endif
+};
+
+/* The tree behind the global API: NULL when not in an initialized
+   state. */
+static FT_T defaultTree;
+
+#ifdef FT_THREADSAFE
+/* The number of retired blocks at which a writer waits for the
+   readers to quiesce and then reuses the blocks */
+enum { RECLAIM_BATCH = 256 };
+#endif
+
+
+/*
+   Begins a lookup in ft, which takes no lock: in the thread-safe
+   build, it enters an epoch, so that nothing the lookup can reach is
+   reused until FT_endRead. Does nothing in the default build.
+*/
+static void FT_beginRead(FT_T ft) {
+   assert(ft != NULL);
+#ifdef FT_THREADSAFE
+   Epoch_enter();
+#endif
+}
+
+/*
+   Ends a lookup in ft begun by FT_beginRead.
+*/
+static void FT_endRead(FT_T ft) {
+   assert(ft != NULL);
+#ifdef FT_THREADSAFE
+   Epoch_exit();
+#endif
+}
+
+/*
+   Acquires ft's lock, excluding every other change and traversal,
+   but not lookups. Does nothing in the default build.
+*/
+static void FT_lock(FT_T ft) {
+   assert(ft != NULL);
+#ifdef FT_THREADSAFE
+   (void) pthread_mutex_lock(&ft->lock);
+#endif
+}
+
+/*
+   Reuses the memory retired while ft's lock was held, once no lookup
+   can still hold it, then releases the lock. In the thread-safe
+   build, waiting for the lookups is deferred until RECLAIM_BATCH
+   blocks have been retired; in the default build there are no
+   concurrent lookups, so the memory is reused at once.
+*/
+static void FT_unlock(FT_T ft) {
+   assert(ft != NULL);
+#ifdef FT_THREADSAFE
+   if(Pool_getRetiredCount(ft->pool) >= RECLAIM_BATCH) {
+      Epoch_synchronize();
+      Pool_reclaim(ft->pool);
+   }
+   (void) pthread_mutex_unlock(&ft->lock);
+#else
+   Pool_reclaim(ft->pool);
+#endif
+}
+
+/*
+   Waits until no lookup begun before the call can still be running,
+   so that a node the lookups could reach, once hidden, can change.
+   Does nothing in the default build, which has no concurrent
+   lookups.
+*/
+static void FT_quiesce(void) {
+#ifdef FT_THREADSAFE
+   Epoch_synchronize();
+#endif
+}
+
+#ifdef FT_STATS
+/* The statistics gathered since the last reset, but for the arrays
+   grown, which node.c counts: growsBefore is its count at the reset */
+static struct ftStats stats;
+static size_t growsBefore;
+
+/* The names of the entry points, in the order of enum ftStatsOp */
+static const char* const statsNames[FT_OPS] = {
+   "insertDir", "containsDir", "rmDir", "insertFile", "containsFile",
+   "rmFile", "getFileContents", "replaceFileContents", "rename",
+   "stat", "du", "toString", "map", "glob", "listPrefix", "writeTo",
+   "openTree", "readDir", "seekDir", "bulkLoad", "save", "load",
+   "saveImage", "snapshot"
+};
+
+/*
+   Returns the current time in nanoseconds.
+*/
+static unsigned long FT_statsNow(void) {
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (unsigned long) now.tv_sec * 1000000000UL +
+          (unsigned long) now.tv_nsec;
+}
+
+/*
+   Adds value to the counter at pCounter, which, in the thread-safe
+   build, other threads may be adding to at the same time.
+*/
+static void FT_statsAdd(size_t* pCounter, size_t value) {
+   assert(pCounter != NULL);
+#ifdef FT_THREADSAFE
+   (void) __atomic_fetch_add(pCounter, value, __ATOMIC_RELAXED);
+#else
+   *pCounter += value;
+#endif
+}
+
+/*
+   Returns the bucket of a struct ftHistogram that value falls in.
+*/
+static size_t FT_statsBucket(size_t value) {
+   size_t shift = 0;
+
+   if(value < FT_HISTOGRAM_SUBS)
+      return value;
+   while((value >> shift) >= 2 * FT_HISTOGRAM_SUBS)
+      shift++;
+   if(shift >= FT_HISTOGRAM_BUCKETS / FT_HISTOGRAM_SUBS - 1)
+      return FT_HISTOGRAM_BUCKETS - 1;
+   return shift * FT_HISTOGRAM_SUBS + (value >> shift);
+}
+
+/*
+   Counts value into *pHistogram.
+*/
+static void FT_statsCount(struct ftHistogram* pHistogram, size_t value) {
+   size_t max;
+
+   assert(pHistogram != NULL);
+
+   FT_statsAdd(&pHistogram->count, 1);
+   FT_statsAdd(&pHistogram->sum, value);
+   FT_statsAdd(&pHistogram->buckets[FT_statsBucket(value)], 1);
+#ifdef FT_THREADSAFE
+   max = __atomic_load_n(&pHistogram->max, __ATOMIC_RELAXED);
+   while(value > max &&
+         !__atomic_compare_exchange_n(&pHistogram->max, &max, value,
+                                      TRUE, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED))
+      ;
+#else
+   max = pHistogram->max;
+   if(value > max)
+      pHistogram->max = value;
+#endif
+}
+
+/*
+   Counts a call to op that began at start.
+*/
+static void FT_statsCall(enum ftStatsOp op, unsigned long start) {
+   FT_statsCount(&stats.latency[op], (size_t) (FT_statsNow() - start));
+}
+
+/*
+   The instrumentation, which compiles to nothing without FT_STATS.
+   FT_STATS_START, the last declaration of an entry point, notes when
+   it began, and FT_STATS_STOP(op), before each of its returns, counts
+   the call. FT_STATS_COUNTER, the last declaration of a walk,
+   declares a count of the nodes it visits, FT_STATS_VISIT counts one
+   and FT_STATS_VISITED(histogram) counts the total into the
+   histogram of stats.
+*/
+#define FT_STATS_START unsigned long statsStart = FT_statsNow()
+#define FT_STATS_STOP(op) FT_statsCall(op, statsStart)
+#define FT_STATS_COUNTER size_t statsVisits = 0
+#define FT_STATS_VISIT (statsVisits++)
+#define FT_STATS_VISITED(histogram) \
+   FT_statsCount(&stats.histogram, statsVisits)
+#else
+#define FT_STATS_START
+#define FT_STATS_STOP(op) ((void) 0)
+#define FT_STATS_COUNTER
+#define FT_STATS_VISIT ((void) 0)
+#define FT_STATS_VISITED(histogram) ((void) 0)
+#endif
+
+/* Defined with the snapshots it writes, below */
+static int FT_compact(FT_T ft);
+
+/*
+   Appends to ft's journal, if it has one, a record of op on path,
+   with the length bytes at contents, or no contents if contents is
+   NULL, syncing it first if it completes a group. Called with ft's
+   lock held, before the change is made, which is then ended with
+   FT_journalEnd, and only if this succeeds.
+   Returns SUCCESS, or IO_ERROR or MEMORY_ERROR if the record cannot
+   be journaled, in which case the change must not be made.
+*/
+static int FT_journalBegin(FT_T ft, enum JournalOp op,
+                           const char* path, const void* contents,
+                           size_t length) {
+   assert(ft != NULL);
+   assert(path != NULL);
+
+   if(ft->journal == NULL)
+      return SUCCESS;
+   return Journal_append(ft->journal, op, path, contents, length);
+}
+
+/*
+   Ends the change of ft that FT_journalBegin recorded, whose status
+   is result: keeps the record if result is SUCCESS, and compacts the
+   journal if it has grown past its limit, or drops it otherwise.
+   A compaction that fails is retried after the next change.
+   Returns result.
+*/
+static int FT_journalEnd(FT_T ft, int result) {
+   assert(ft != NULL);
+
+   if(ft->journal == NULL)
+      return result;
+   if(result != SUCCESS)
+      Journal_cancel(ft->journal);
+   else {
+      Journal_commit(ft->journal);
+      if(Journal_getSize(ft->journal) >= ft->compactSize)
+         (void) FT_compact(ft);
+   }
+   return result;
+}
+
+/*
+   The state of a cursor over the components of a path: on a
+   well-formed component, past the last one, or on an empty component,
+   which makes the whole path malformed.
+*/
+enum ftStep { FT_COMPONENT, FT_END, FT_MALFORMED };
+
+/*
+   A cursor over the components of a path, which it never copies: the
+   current component is the length characters at name, a slice of the
+   caller's path that is not '\0'-terminated.
+*/
+struct ftCursor {
+   const char* name;
+   size_t length;
+   enum ftStep step;
+};
+
+/*
+   Places pCursor on the first component of path. An empty path, or
+   one that starts with a slash, is malformed.
+   Returns the new state of pCursor.
+*/
+static enum ftStep FT_firstComponent(struct ftCursor* pCursor,
+                                     const char* path) {
+   assert(pCursor != NULL);
+   assert(path != NULL);
+
+   pCursor->name = path;
+   pCursor->length = strcspn(path, "/");
+   pCursor->step = pCursor->length == 0 ? FT_MALFORMED : FT_COMPONENT;
+   return pCursor->step;
+}
+
+/*
+   Advances pCursor, which must be on a well-formed component, to the
+   next one. A path with two slashes in a row, or that ends with a
+   slash, is malformed.
+   Returns the new state of pCursor.
+*/
+static enum ftStep FT_nextComponent(struct ftCursor* pCursor) {
+   const char* end;
+
+   assert(pCursor != NULL);
+   assert(pCursor->step == FT_COMPONENT);
+
+   end = pCursor->name + pCursor->length;
+   if(*end == '\0')
+      pCursor->step = FT_END;
+   else {
+      pCursor->name = end + 1;
+      pCursor->length = strcspn(pCursor->name, "/");
+      pCursor->step = pCursor->length == 0 ? FT_MALFORMED : FT_COMPONENT;
+   }
+   return pCursor->step;
+}
+
+/*
+   Returns TRUE if pCursor is on the last component of its path.
+*/
+static boolean FT_isLastComponent(const struct ftCursor* pCursor) {
+   assert(pCursor != NULL);
+   assert(pCursor->step == FT_COMPONENT);
+   return (boolean) (pCursor->name[pCursor->length] == '\0');
+}
+
+/*
+   A path buffer shared by the nodes of a traversal: each node's path
+   is its parent's path, already in the buffer, plus its own name.
+*/
+struct ftPath {
+   char* string;
+   size_t size;
+};
+
+/*
+   Makes room in pPath for a path of length characters plus a '\0'.
+   Returns FALSE if there is an allocation error, TRUE otherwise.
+*/
+static boolean FT_reservePath(struct ftPath* pPath, size_t length) {
+   char* string;
+   size_t size;
 
+   assert(pPath != NULL);
 
-/* A File Tree is an AO with 3 state variables: */
-/* a flag for if it is in an initialized state (TRUE) or not (FALSE) */
-static boolean isInitialized;
+   if(length < pPath->size)
+      return TRUE;
+   size = 2 * pPath->size;
+   if(size <= length)
+      size = length + 1;
+   string = realloc(pPath->string, size);
+   if(string == NULL)
+      return FALSE;
+   pPath->string = string;
+   pPath->size = size;
+   return TRUE;
+}
+
+/*
+   Writes n's name into pPath after the path of its parent, offset
+   characters long, or at the start if offset is 0.
+   Returns the length of n's path, or 0 if there is an allocation
+   error.
+*/
+static size_t FT_appendName(struct ftPath* pPath, Node_T n,
+                            size_t offset) {
+   size_t length;
+
+   assert(pPath != NULL);
+   assert(n != NULL);
+
+   length = offset + Node_getNameLength(n);
+   if(offset != 0)
+      length++;
+   if(!FT_reservePath(pPath, length))
+      return 0;
+   if(offset != 0)
+      pPath->string[offset] = '/';
+   memcpy(pPath->string + length - Node_getNameLength(n),
+          Node_getName(n), Node_getNameLength(n));
+   pPath->string[length] = '\0';
+   return length;
+}
 
-/* a pointer to the root node in the hierarchy */
-static Node_T root;
+/*
+   Where a walk stands in one directory on the way down from the
+   node it started at to the node it is visiting: the directory, the
+   index of its next child to visit, and the state the visitor
+   derived for it. The walk climbs back up through its frames rather
+   than through parent links, which a snapshot cannot rely on.
+*/
+struct ftFrame {
+   Node_T dir;
+   size_t next;
+   unsigned long state;
+};
+
+/* The number of frames a walk makes room for when it first descends */
+enum { MIN_FRAMES = 16 };
+
+/*
+   Pushes onto the stack of *pSize frames at *pFrames a frame at
+   index depth for directory dir with state state, growing the stack
+   if it is full.
+   Returns FALSE if there is an allocation error, TRUE otherwise.
+*/
+static boolean FT_pushFrame(struct ftFrame** pFrames, size_t* pSize,
+                            size_t depth, Node_T dir,
+                            unsigned long state) {
+   struct ftFrame* frames;
+   size_t size;
 
-/* a counter of the number of nodes in the hierarchy */
-static size_t count;
+   assert(pFrames != NULL);
+   assert(pSize != NULL);
 
+   if(depth == *pSize) {
+      size = *pSize == 0 ? MIN_FRAMES : 2 * *pSize;
+      frames = realloc(*pFrames, size * sizeof(struct ftFrame));
+      if(frames == NULL)
+         return FALSE;
+      *pFrames = frames;
+      *pSize = size;
+   }
+   (*pFrames)[depth].dir = dir;
+   (*pFrames)[depth].next = 0;
+   (*pFrames)[depth].state = state;
+   return TRUE;
+}
 
 /*
-   Performs a pre-order traversal of the tree rooted at n,
-   inserting each payload to DynArray_T d beginning at index i.
-   Returns the next unused index in d after the insertion(s).
+   Walks the hierarchy rooted at n in pre-order, the order
+   FT_toString lists it in, calling
+   (*pfVisit)(node, parentState, &nodeState, pvExtra) on each node,
+   where parentState is the state the call on the node's parent
+   stored, or state for n itself. Keeps a frame for each directory
+   between n and the current node in a stack on the heap rather than
+   recursing, so the call stack stays the same size however deep the
+   hierarchy is. The walk ends at the first call that returns FALSE.
+   Returns FALSE if a call does or there is an allocation error,
+   TRUE otherwise.
 */
-static size_t FT_preOrderTraversal(Node_T n, DynArray_T d, size_t i) {
-   size_t c;
+static boolean FT_walk(Node_T n, unsigned long state,
+                       boolean (*pfVisit)(Node_T n,
+                                          unsigned long parentState,
+                                          unsigned long* pState,
+                                          void* pvExtra),
+                       void* pvExtra) {
+   struct ftFrame* frames = NULL;
+   struct ftFrame* top;
+   size_t size = 0;
+   size_t depth = 0;
+   Node_T child;
+   boolean result = TRUE;
+   FT_STATS_COUNTER;
 
-   assert(d != NULL);
+   assert(pfVisit != NULL);
 
-   if(n != NULL) {
-      (void) DynArray_set(d, i, Node_getPath(n));
-      i++;
-      for(c = 0; c < Node_getNumChildren(n); c++)
-            i = FT_preOrderTraversal(Node_getChild(n, c), d, i);
+   if(n == NULL)
+      return TRUE;
+   FT_STATS_VISIT;
+   if(!(*pfVisit)(n, state, &state, pvExtra))
+      return FALSE;
+   if(Node_getNumChildren(n) > 0) {
+      if(!FT_pushFrame(&frames, &size, depth, n, state))
+         return FALSE;
+      depth++;
+   }
+
+   /* A childless node never gets a frame */
+   while(depth > 0) {
+      top = &frames[depth - 1];
+      if(top->next == Node_getNumChildren(top->dir)) {
+         depth--;
+         continue;
+      }
+      child = Node_getChild(top->dir, top->next++);
+      FT_STATS_VISIT;
+      if(!(*pfVisit)(child, top->state, &state, pvExtra)) {
+         result = FALSE;
+         break;
+      }
+      if(Node_getNumChildren(child) > 0) {
+         if(!FT_pushFrame(&frames, &size, depth, child, state)) {
+            result = FALSE;
+            break;
+         }
+         depth++;
+      }
    }
-   return i;
+   free(frames);
+   FT_STATS_VISITED(walkVisits);
+   return result;
+}
+
+/*
+   What FT_traverse needs while it walks: a path buffer shared by
+   all the nodes, and the function to apply to each path.
+*/
+struct ftTraversal {
+   struct ftPath path;
+   void (*pfApply)(const char* path, size_t length, void* pvExtra);
+   void* pvExtra;
+};
+
+/*
+   Visits n for FT_traverse, whose struct ftTraversal is at
+   pvTraversal: puts n's path into the buffer, after the path of n's
+   parent, which is offset characters long, and applies the function
+   to it. Stores the length of n's path in *pLength.
+   Returns FALSE if there is an allocation error, TRUE otherwise.
+*/
+static boolean FT_visitPath(Node_T n, unsigned long offset,
+                            unsigned long* pLength,
+                            void* pvTraversal) {
+   struct ftTraversal* pTraversal = pvTraversal;
+   struct ftPath* pPath;
+   size_t length;
+
+   assert(n != NULL);
+   assert(pLength != NULL);
+   assert(pTraversal != NULL);
+
+   pPath = &pTraversal->path;
+   length = FT_appendName(pPath, n, (size_t) offset);
+   if(length == 0)
+      return FALSE;
+
+   (*pTraversal->pfApply)(pPath->string, length, pTraversal->pvExtra);
+   *pLength = length;
+   return TRUE;
+}
+
+/*
+   Performs a pre-order traversal over the whole hierarchy of ft,
+   calling (*pfApply)(path, length, pvExtra) with the path of each
+   node and the length of that path, in the order FT_toString lists
+   them.
+   Returns FALSE if there is an allocation error, TRUE otherwise.
+*/
+static boolean FT_traverse(FT_T ft,
+                           void (*pfApply)(const char* path,
+                                           size_t length,
+                                           void* pvExtra),
+                           void* pvExtra) {
+   struct ftTraversal traversal;
+   boolean result;
+
+   assert(ft != NULL);
+   assert(pfApply != NULL);
+
+   traversal.path.string = NULL;
+   traversal.path.size = 0;
+   traversal.pfApply = pfApply;
+   traversal.pvExtra = pvExtra;
+   result = FT_walk(ft->root, 0, FT_visitPath, &traversal);
+   free(traversal.path.string);
+   return result;
 }
 
 /*
-   Alternate version of strlen that uses pAcc as an in-out parameter
-   to accumulate a string length, rather than returning the length of
-   str, and also always adds one more in addition to str's length.
+   Accumulates into the size_t pointed to by pvAcc the length of
+   one line of FT_toString output: length plus one for the newline.
 */
-static void FT_strlenAccumulate(char* str, size_t* pAcc) {
-   assert(pAcc != NULL);
+static void FT_strlenAccumulate(const char* path, size_t length,
+                                void* pvAcc) {
+   (void) path;
+   assert(pvAcc != NULL);
 
-   if(str != NULL)
-      *pAcc += (strlen(str) + 1);
+   *(size_t*) pvAcc += length + 1;
 }
 
 /*
-   Alternate version of strcat that inverts the typical argument
-   order, appending str onto acc, and also always adds a newline at
-   the end of the concatenated string.
+   A string under construction by FT_toString, along with the offset
+   of its end, so that each line is written in place instead of
+   rescanning the string to find its end.
+*/
+struct ftBuffer {
+   char* string;
+   size_t end;
+};
+
+/*
+   Appends path, which has length characters, and a newline at the end
+   of the struct ftBuffer pointed to by pvAcc.
 */
-static void FT_strcatAccumulate(char* str, char* acc) {
+static void FT_copyAccumulate(const char* path, size_t length,
+                              void* pvAcc) {
+   struct ftBuffer* acc = pvAcc;
+
+   assert(path != NULL);
    assert(acc != NULL);
 
-   if(str != NULL)
-      strcat(acc, str); strcat(acc, "\n");
+   memcpy(acc->string + acc->end, path, length);
+   acc->end += length;
+   acc->string[acc->end++] = '\n';
+}
+
+/*
+   Writes path, which has length characters, and a newline to the
+   stream pointed to by pvStream.
+*/
+static void FT_writeAccumulate(const char* path, size_t length,
+                               void* pvStream) {
+   assert(path != NULL);
+   assert(pvStream != NULL);
+
+   (void) fwrite(path, 1, length, (FILE*) pvStream);
+   (void) putc('\n', (FILE*) pvStream);
 }
 
 /*
    Given a prospective parent and child node,
    adds child to parent's children list, if possible
-   If not possible, destroys the hierarchy rooted at child
-   and returns PARENT_CHILD_ERROR, otherwise, returns SUCCESS.
+   If not possible, returns NOT_A_DIRECTORY or PARENT_CHILD_ERROR,
+   leaving the hierarchy rooted at child to the caller to destroy,
+   otherwise, returns SUCCESS.
 */
 
-static int FT_linkParentToChild(Node_T parent, Node_T child){
+static int FT_linkParentToChild(FT_T ft, Node_T parent, Node_T child){
+   assert (ft != NULL);
    assert (parent != NULL);
    if (Node_getStatus(parent) == TRUE) return NOT_A_DIRECTORY; 
 
-   if(Node_linkChild(parent,child) != SUCCESS) {
-      (void) Node_destroy(child);
+   if(Node_linkChild(parent, child, ft->pool) != SUCCESS)
       return PARENT_CHILD_ERROR;
-   }
 
    return SUCCESS;
 }
 
 /*
-   Destroys the entire hierarchy of nodes rooted at curr,
+   Adds up the totals of the chain of new nodes from last up to first,
+   each of which is the only child of the one before, so that every
+   node of the chain has the totals of its hierarchy.
+*/
+
+static void FT_totalChain(Node_T first, Node_T last) {
+   Node_T parent;
+
+   assert(first != NULL);
+   assert(last != NULL);
+   while(last != first) {
+      parent = Node_getParent(last);
+      Node_addTotals(parent, last);
+      last = parent;
+   }
+}
+
+/*
+   Destroys the entire hierarchy of nodes rooted at curr in ft,
    including curr itself.
 */
 
-static void FT_removePathFrom(Node_T curr) {
+static void FT_removePathFrom(FT_T ft, Node_T curr) {
+   assert(ft != NULL);
    if(curr != NULL) {
-      count -= Node_destroy(curr);
+      ft->count -= Node_destroy(curr, ft->pool);
    }
 }
 
 /*
-   Inserts a new file with contents (contents) and a length (length) 
-   into the tree rooted at parent.
-   If a node representing path already exists, returns ALREADY_IN_TREE
+   Inserts a new file with contents (contents) and a length (length)
+   into ft under parent, creating a node for each component of the
+   path from pCursor's current one on, the first of which names no
+   child of parent.
+   If a node representing the path already exists, returns ALREADY_IN_TREE
    If there is an allocation error in creating any of the new nodes or
    their fields, returns MEMORY_ERROR
    If there is an error linking any of the new nodes,
    returns PARENT_CHILD_ERROR
-   If there is a path issue, returns CONFLICTING_PATH
+   If there is a path issue, or the path is malformed, returns
+   CONFLICTING_PATH
    Otherwise, returns SUCCESS
 */
-static int FT_appendFiles(char* path, Node_T parent,
-                          void* contents, size_t length){
+static int FT_appendFiles(FT_T ft, struct ftCursor* pCursor,
+                          Node_T parent, void* contents,
+                          size_t length){
    Node_T curr; 
    Node_T firstNew = NULL;
    Node_T new;
-   char* copyPath;
-   char* restPath = path;
-   char* dirToken;
-   int result;
+   int result = SUCCESS;
    size_t newCount = 0;
-   char* temp; 
 
-   assert (path != NULL);
+   assert (ft != NULL);
+   assert (pCursor != NULL);
    curr = parent; 
    if (curr == NULL) {
       /* File cannot be root */ 
       return CONFLICTING_PATH;
    }
-   else{
-      /* Checks if path is already in Tree */ 
-      if(!strcmp(path,Node_getPath(curr)))
-         return ALREADY_IN_TREE;
-         restPath += (strlen(Node_getPath(curr)) + 1);
-   }
+   /* Checks if path is already in Tree */ 
+   if (pCursor->step == FT_END)
+      return ALREADY_IN_TREE;
 
    /* Checks if Node is a File */ 
    if (Node_getStatus(curr) == TRUE) return NOT_A_DIRECTORY; 
-   copyPath = (char*) malloc(strlen(restPath) + 1);
-
-   /* Returns memory error if memory allocation fails */ 
-   if (copyPath == NULL)
-      return MEMORY_ERROR;
-   strcpy(copyPath, restPath);
-   dirToken = strtok(copyPath, "/");
 
-   while (dirToken != NULL){
-      temp = dirToken;
-      dirToken = strtok(NULL, "/");
-      /* When adding a file, only the last token
+   while (result == SUCCESS && pCursor->step == FT_COMPONENT){
+      /* When adding a file, only the last component
          in the path is the file */
-      if (dirToken == NULL)
-         new = Node_addFile(temp, curr, contents, length); 
+      if (FT_isLastComponent(pCursor))
+         new = Node_addFile(pCursor->name, pCursor->length, curr,
+                            contents, length, ft->pool); 
       else{
          /* Creates directories rather than files
-            leading up to the final token */
-         new = Node_create(temp, curr);
+            leading up to the final component */
+         new = Node_create(pCursor->name, pCursor->length, curr,
+                           ft->pool);
+      }
+      /* Returns memory error if memory allocation fails */
+      if (new == NULL) {
+         result = MEMORY_ERROR;
+         break;
       }
       newCount++;
       if(firstNew == NULL)
          firstNew = new;
       else{
-         result = FT_linkParentToChild(curr, new);
-         if (result != SUCCESS) {
-            (void) Node_destroy(new); 
-            (void) Node_destroy(firstNew);
-            free(copyPath);
-            return result;
-         }
-      }
-      /* Returns memory error if memory allocation fails */
-      if (new == NULL) {
-         (void) Node_destroy(firstNew); 
-         free(copyPath);
-         return MEMORY_ERROR;
+         result = Node_appendChild(curr, new, ft->pool);
+         if (result != SUCCESS)
+            (void) Node_destroy(new, ft->pool); 
       }
       curr = new;
+      (void) FT_nextComponent(pCursor);
    }
-   free(copyPath);
-   if(parent == NULL){
-      return INITIALIZATION_ERROR;
+   if (result == SUCCESS && pCursor->step == FT_MALFORMED)
+      result = CONFLICTING_PATH;
+
+   /* Adds new Node to file tree hierarchy */ 
+   if (result == SUCCESS) {
+      FT_totalChain(firstNew, curr);
+      result = FT_linkParentToChild(ft, parent, firstNew);
    }
-   else{
-      /* Adds new Node to file tree hierarchy */ 
-      result = FT_linkParentToChild(parent, firstNew);
-      if (result == SUCCESS)
-         count += newCount;
-      else
-         (void) Node_destroy(firstNew);
-      return result;
-   }        
+   if (result == SUCCESS)
+      ft->count += newCount;
+   else if (firstNew != NULL)
+      (void) Node_destroy(firstNew, ft->pool);
+   return result;
 }
 /*
-   Inserts a new path into the tree rooted at parent, or, if
-   parent is NULL, as the root of the data structure.
-   If a node representing path already exists, returns ALREADY_IN_TREE
+   Inserts a new path into ft under parent, creating a node for each
+   component of the path from pCursor's current one on, the first of
+   which names no child of parent, or, if parent is NULL, is to be
+   the root of ft.
+   If a node representing the path already exists, returns ALREADY_IN_TREE
    If there is an allocation error in creating any of the new nodes or
    their fields, returns MEMORY_ERROR
    If there is an error linking any of the new nodes,
    returns PARENT_CHILD_ERROR
+   If the path is not under ft's root, or is malformed, returns
+   CONFLICTING_PATH
    Otherwise, returns SUCCESS
 */
-static int FT_insertRestOfPath(char* path, Node_T parent){
+static int FT_insertRestOfPath(FT_T ft, struct ftCursor* pCursor,
+                               Node_T parent){
    Node_T curr; 
    Node_T firstNew = NULL;
    Node_T new;
-   char* copyPath;
-   char* restPath; 
-   char* dirToken;
-   int result;
+   int result = SUCCESS;
    size_t newCount = 0;
 
-   assert (path != NULL);
-   restPath = path; 
+   assert (ft != NULL);
+   assert (pCursor != NULL);
    curr = parent;
    /* Returns error if there is a conflicting path */
    if (curr == NULL) {
-      if(root != NULL) {
+      if(ft->root != NULL) {
          return CONFLICTING_PATH;
       }
    }
-   else{
-      /* Checks if path is already in Tree */ 
-      if(!strcmp(path,Node_getPath(curr)))
-         return ALREADY_IN_TREE;
-      restPath += (strlen(Node_getPath(curr)) + 1);
-   }
-   copyPath = malloc(strlen(restPath) + 1);
+   /* Checks if path is already in Tree */ 
+   else if (pCursor->step == FT_END)
+      return ALREADY_IN_TREE;
 
-   /* Returns MEMORY_ERROR if memory allocation fails */ 
-   if (copyPath == NULL)
-      return MEMORY_ERROR;
-   strcpy(copyPath, restPath);
-   dirToken = strtok(copyPath, "/");
-   while (dirToken != NULL) {
-      new = Node_create(dirToken, curr);
+   while (result == SUCCESS && pCursor->step == FT_COMPONENT) {
+      new = Node_create(pCursor->name, pCursor->length, curr, ft->pool);
+      if(new == NULL){
+         result = MEMORY_ERROR;
+         break;
+      }
       newCount++;
 
       if(firstNew == NULL)
          firstNew = new;
       else {
-         result = FT_linkParentToChild(curr, new);
+         result = Node_appendChild(curr, new, ft->pool);
          /* Reverts changes if the node isn't successfully linked */
-         if(result != SUCCESS) {
-            (void) Node_destroy(new);
-            (void) Node_destroy(firstNew);
-            free(copyPath);
-            return result;
-         }
-      }
-      if(new == NULL){
-         (void) Node_destroy(firstNew);
-         free(copyPath);
-         return MEMORY_ERROR;
+         if(result != SUCCESS)
+            (void) Node_destroy(new, ft->pool);
       }
       curr = new;
-      dirToken = strtok(NULL, "/");
+      (void) FT_nextComponent(pCursor);
    }
-   /* Frees the memory allocated for local variable */ 
-   free(copyPath);
+   if (result == SUCCESS && pCursor->step == FT_MALFORMED)
+      result = CONFLICTING_PATH;
+   if (result == SUCCESS)
+      FT_totalChain(firstNew, curr);
 
-   if(parent == NULL){
+   if(result == SUCCESS && parent == NULL){
       /* If the structure is initialized but the new path 
          is the first element, puts the Node at the root */ 
-      root = firstNew;
-      count = newCount;
+      __atomic_store_n(&ft->root, firstNew, __ATOMIC_RELEASE);
+      ft->count = newCount;
       return SUCCESS;
    }
-   else {
-      /* Links new node to parent if the Node is not the root */
-      result = FT_linkParentToChild(parent, firstNew);
-      if(result == SUCCESS)
-         count += newCount;
-      else
-         (void) Node_destroy(firstNew);
-      return result;
-   }
+   /* Links new node to parent if the Node is not the root */
+   if(result == SUCCESS)
+      result = FT_linkParentToChild(ft, parent, firstNew);
+   if(result == SUCCESS)
+      ft->count += newCount;
+   else if(firstNew != NULL)
+      (void) Node_destroy(firstNew, ft->pool);
+   return result;
 }
 /*
-  Removes the directory hierarchy rooted at path starting from
-  curr. If curr is the data structure's root, root becomes NULL.
-  Returns NO_SUCH_PATH if curr is not the node for path,
-  and SUCCESS otherwise.
+   Returns the hash of n's path, given hash, the hash of the path of
+   n's parent, or of the empty path if isRoot is TRUE.
 */
-
-static int FT_rmPathAt(char* path, Node_T curr){
-   Node_T parent;
-   assert(path != NULL);
-   assert(curr != NULL);
-   parent = Node_getParent(curr);
-   
-   if (Node_getStatus(curr) != FALSE)
-      return NOT_A_DIRECTORY; 
-   if (!strcmp(path, Node_getPath(curr))){
-      if(parent == NULL)
-         root = NULL;
-      else
-         Node_unlinkChild(parent, curr);
-      FT_removePathFrom(curr);
-
-      return SUCCESS;
-
-   }
-   else
-      return NO_SUCH_PATH; 
+static unsigned long FT_hashChild(unsigned long hash, Node_T n,
+                                  boolean isRoot){
+   assert(n != NULL);
+   if(!isRoot)
+      hash = PathIndex_hashAppend(hash, "/", 1);
+   return PathIndex_hashAppend(hash, Node_getName(n),
+                               Node_getNameLength(n));
 }
 
+/*
+   Stops using ft's index, which could not keep up with a change to
+   the tree: lookups walk the tree again from then on.
+*/
+static void FT_dropIndex(FT_T ft){
+   PathIndex_T index = ft->index;
 
+   assert(index != NULL);
+   __atomic_store_n(&ft->index, NULL, __ATOMIC_RELEASE);
+   PathIndex_retire(index);
+}
 
 /*
-   Starting at the parameter curr, traverses as far down
-   the hierarchy as possible while still matching the path
-   parameter.
-   Returns a pointer to the farthest matching node down that path,
-   or NULL if there is no node in curr's hierarchy that matches
-   a prefix of the path
+   Visits n for a walk that adds a hierarchy to the index at pvIndex:
+   stores in *pHash the hash of n's path, given parentHash, the hash
+   of the path of n's parent, and adds n to the index under it.
+   Returns FALSE if the index cannot grow, TRUE otherwise.
 */
-static Node_T FT_traversePathFrom(char* path, Node_T curr) {
-   Node_T found;
-   size_t i;
+static boolean FT_visitIndex(Node_T n, unsigned long parentHash,
+                             unsigned long* pHash, void* pvIndex){
+   assert(n != NULL);
+   assert(pHash != NULL);
+   assert(pvIndex != NULL);
 
-   assert (path != NULL);
-   if(curr == NULL)
-      return NULL;
-   else if(!strcmp(path, Node_getPath(curr)))
-      return curr;
-   else if(!strncmp(path, Node_getPath(curr), strlen(Node_getPath(curr)))){
-      for(i = 0; i < Node_getNumChildren(curr); i++){
-         found = FT_traversePathFrom(path, Node_getChild(curr, i));
-         if(found != NULL) 
-            return found;
-      }
-      return curr;
-   }
-   return NULL; 
+   *pHash = FT_hashChild(parentHash, n,
+                         (boolean) (Node_getParent(n) == NULL));
+   return (boolean) (PathIndex_insert(pvIndex, *pHash, n) == SUCCESS);
 }
+
 /*
-   Returns the farthest node reachable from the root following a given
-   path, or NULL if there is no node in the hierarchy that matches a
-   prefix of the path.
+   Visits n for a walk that takes a hierarchy out of the index at
+   pvIndex: stores in *pHash the hash of n's path, given parentHash,
+   the hash of the path of n's parent, and removes n from the index.
+   Returns TRUE.
 */
+static boolean FT_visitUnindex(Node_T n, unsigned long parentHash,
+                               unsigned long* pHash, void* pvIndex){
+   assert(n != NULL);
+   assert(pHash != NULL);
+   assert(pvIndex != NULL);
 
-static Node_T FT_traversePath(char* path){
-   assert(path != NULL);
-   return FT_traversePathFrom(path, root);
+   *pHash = FT_hashChild(parentHash, n,
+                         (boolean) (Node_getParent(n) == NULL));
+   PathIndex_remove(pvIndex, *pHash, n);
+   return TRUE;
 }
 
+/*
+   Adds to ft's index, if it has one, the nodes that an insert of path
+   just created below parent, the first of which is named by the
+   current component of pFirst, a cursor over path, or, if parent is
+   NULL, from the root down.
+   Each new node but the last has the next as its only child. If the
+   index cannot grow, drops it.
+*/
+static void FT_indexInserted(FT_T ft, const char* path, Node_T parent,
+                             const struct ftCursor* pFirst){
+   Node_T n;
+   unsigned long hash;
 
+   assert(ft != NULL);
+   assert(path != NULL);
+   assert(pFirst != NULL);
+   if(ft->index == NULL)
+      return;
 
+   hash = PathIndex_hashStart();
+   if(parent == NULL)
+      n = ft->root;
+   else {
+      /* parent's path is all of path before the slash ahead of the
+         first new component */
+      hash = PathIndex_hashAppend(hash, path,
+                                  (size_t) (pFirst->name - path) - 1);
+      n = Node_findChild(parent, pFirst->name, pFirst->length);
+   }
+   for(; n != NULL; n = Node_getChild(n, 0)) {
+      hash = FT_hashChild(hash, n, (boolean) (parent == NULL &&
+                                              n == ft->root));
+      if(PathIndex_insert(ft->index, hash, n) != SUCCESS) {
+         FT_dropIndex(ft);
+         return;
+      }
+   }
+}
 
 
 /*
-   Inserts a new directory into the tree at path, if possible.
-   Returns SUCCESS if the new directory is inserted.
-   Returns INITIALIZATION_ERROR if not in an initialized state.
-   Returns CONFLICTING_PATH if path is not underneath existing root.
-   Returns NOT_A_DIRECTORY if a proper prefix of path exists as a file.
-   Returns ALREADY_IN_TREE if the path already exists (as dir or file).
-   Returns PARENT_CHILD_ERROR if a new child cannot be added in path.
-   Returns MEMORY_ERROR if unable to allocate sufficient memory.
+   Makes *pNode, a node of ft, safe to change: if a snapshot shares
+   it or any of its ancestors, copies each node from the topmost
+   shared one down to *pNode, publishes the copies in place of the
+   originals, which the snapshots keep, and stores the copy of *pNode
+   in *pNode. A change thus costs a snapshot one node per level,
+   plus its children array, and nothing at all while ft has no
+   snapshots.
+   Returns SUCCESS, or MEMORY_ERROR if unable to allocate sufficient
+   memory, in which case nothing has changed.
 */
+static int FT_unshare(FT_T ft, Node_T* pNode){
+   Node_T local[2 * MIN_FRAMES];
+   Node_T* path = local;
+   Node_T* copies;
+   Node_T n;
+   size_t depth = 0;
+   size_t top;
+   size_t i;
+   unsigned long hash;
+   int result = SUCCESS;
 
-int FT_insertDir(char *path){
-   Node_T curr;
-   int result;
-   assert(path != NULL);
-   if(!isInitialized)
-      return INITIALIZATION_ERROR;
-   curr = FT_traversePath(path);
-   result = FT_insertRestOfPath(path,curr);
+   assert(ft != NULL);
+   assert(pNode != NULL);
+   assert(*pNode != NULL);
+   if(ft->snapshots == 0)
+      return SUCCESS;
+
+   /* Lists the nodes from *pNode up to the root, with room after
+      them for their copies, on the stack unless the path is deep */
+   for(n = *pNode; n != NULL; n = Node_getParent(n))
+      depth++;
+   if(depth > MIN_FRAMES) {
+      path = malloc(2 * depth * sizeof(Node_T));
+      if(path == NULL)
+         return MEMORY_ERROR;
+   }
+   copies = path + depth;
+   i = 0;
+   for(n = *pNode; n != NULL; n = Node_getParent(n))
+      path[i++] = n;
+
+   /* The topmost shared node and all below it on the path are
+      copied */
+   for(top = depth; top > 0 && !Node_isShared(path[top - 1]); top--)
+      ;
+   for(i = 0; i < top; i++) {
+      copies[i] = Node_copy(path[i], ft->pool);
+      if(copies[i] == NULL) {
+         while(i > 0)
+            Node_discard(copies[--i], ft->pool);
+         result = MEMORY_ERROR;
+         top = 0;
+         break;
+      }
+   }
+
+   if(top > 0) {
+      /* Builds the copied path bottom-up, out of the readers' sight,
+         then publishes it with one store: of a new children array
+         for the lowest ancestor that is not shared, or of the root */
+      for(i = 1; i < top; i++)
+         Node_setChild(copies[i], path[i - 1], copies[i - 1]);
+      if(top == depth) {
+         __atomic_store_n(&ft->root, copies[top - 1], __ATOMIC_RELEASE);
+         Node_release(path[top - 1], ft->pool);
+      }
+      else if(Node_replaceChild(path[top], path[top - 1],
+                                copies[top - 1], ft->pool) != SUCCESS) {
+         for(i = 0; i < top; i++)
+            Node_discard(copies[i], ft->pool);
+         result = MEMORY_ERROR;
+         top = 0;
+      }
+   }
+   if(top > 0) {
+      /* The copies take over their other children only once
+         published, so that nothing needs undoing before */
+      for(i = 0; i < top; i++)
+         Node_claimChildren(copies[i]);
+      *pNode = copies[0];
+   }
+
+   /* Points the index at the copies, adding each before removing
+      the original, so that a lookup never misses the path */
+   if(top > 0 && ft->index != NULL) {
+      hash = PathIndex_hashStart();
+      for(i = depth; i > 0; i--) {
+         hash = FT_hashChild(hash, path[i - 1], (boolean) (i == depth));
+         if(i > top)
+            continue;
+         if(PathIndex_insert(ft->index, hash, copies[i - 1])
+            != SUCCESS) {
+            FT_dropIndex(ft);
+            break;
+         }
+         PathIndex_remove(ft->index, hash, path[i - 1]);
+      }
+   }
+
+   if(path != local)
+      free(path);
    return result;
 }
 
+/*
+   Unshares, as FT_unshare does, *pParent, the deepest node of ft that
+   FT_traversePath found on a path to insert, if the insert will link
+   a child to it: that is, if it is a directory and pCursor is on a
+   component.
+   Returns SUCCESS, or MEMORY_ERROR as FT_unshare does.
+*/
+static int FT_unshareParent(FT_T ft, Node_T* pParent,
+                            const struct ftCursor* pCursor){
+   assert(ft != NULL);
+   assert(pParent != NULL);
+   assert(pCursor != NULL);
+   if(*pParent == NULL || pCursor->step != FT_COMPONENT ||
+      Node_getStatus(*pParent) == TRUE)
+      return SUCCESS;
+   return FT_unshare(ft, pParent);
+}
 
 /*
-  Returns TRUE if the tree contains the full path parameter as a
-  directory and FALSE otherwise.
+   Checks, before anything is journaled, the insert into ft of a path
+   read through pCursor, on which FT_traversePath found parent, as a
+   file if isFile is TRUE and as a directory otherwise.
+   Returns CONFLICTING_PATH, ALREADY_IN_TREE or NOT_A_DIRECTORY as the
+   insert would, or SUCCESS if only creating the nodes can fail.
+*/
+static int FT_checkInsert(FT_T ft, const struct ftCursor* pCursor,
+                          Node_T parent, boolean isFile){
+   struct ftCursor rest;
+
+   assert(ft != NULL);
+   assert(pCursor != NULL);
+
+   /* Finds an empty component among those still to create */
+   rest = *pCursor;
+   while(rest.step == FT_COMPONENT)
+      (void) FT_nextComponent(&rest);
+
+   if(parent == NULL)
+      return isFile || ft->root != NULL || rest.step == FT_MALFORMED ?
+             CONFLICTING_PATH : SUCCESS;
+   if(pCursor->step == FT_END)
+      return ALREADY_IN_TREE;
+   if(isFile && Node_getStatus(parent) == TRUE)
+      return NOT_A_DIRECTORY;
+   if(rest.step == FT_MALFORMED)
+      return CONFLICTING_PATH;
+   if(Node_getStatus(parent) == TRUE)
+      return NOT_A_DIRECTORY;
+   return SUCCESS;
+}
+
+/*
+  Removes the directory hierarchy rooted at curr, whose path is path,
+  from ft and from its index. The snapshots that share any of it
+  keep their part.
+  If curr is ft's root, ft's root becomes NULL.
+  Returns NOT_A_DIRECTORY if curr is a file,
+  MEMORY_ERROR if curr cannot be unlinked from its parent,
+  and SUCCESS otherwise.
+*/
+
+static int FT_rmPathAt(FT_T ft, Node_T curr, char* path){
+   Node_T parent;
+   assert(ft != NULL);
+   assert(curr != NULL);
+   parent = Node_getParent(curr);
+   
+   if (Node_getStatus(curr) != FALSE)
+      return NOT_A_DIRECTORY; 
+   if(parent == NULL)
+      __atomic_store_n(&ft->root, NULL, __ATOMIC_RELEASE);
+   else if (FT_unshare(ft, &parent) != SUCCESS ||
+            Node_unlinkChild(parent, curr, ft->pool) != SUCCESS)
+      return MEMORY_ERROR;
+   /* parent's path is all of path before the slash ahead of curr's
+      name; if the walk cannot keep track of where it is, the index
+      is dropped rather than left holding removed nodes */
+   if(ft->index != NULL && parent == NULL)
+      PathIndex_clear(ft->index);
+   else if(ft->index != NULL &&
+           !FT_walk(curr,
+                    PathIndex_hashAppend(PathIndex_hashStart(), path,
+                                         strlen(path) -
+                                         Node_getNameLength(curr) - 1),
+                    FT_visitUnindex, ft->index))
+      FT_dropIndex(ft);
+   FT_removePathFrom(ft, curr);
+
+   return SUCCESS;
+}
+
+
+
+/*
+   Starting at ft's root, traverses as far down the hierarchy as
+   possible while still matching the components of a path, read
+   through pCursor, which must be on the path's first component. Each
+   component is located among the current node's sorted children by
+   binary search.
+   Returns a pointer to the farthest matching node down that path,
+   or NULL if the first component does not name ft's root. Leaves
+   pCursor on the first component that does not match, past the last
+   one if every component matches, or on the empty component that
+   makes the path malformed.
+*/
+static Node_T FT_traversePath(FT_T ft, struct ftCursor* pCursor){
+   Node_T curr;
+   Node_T child;
+   FT_STATS_COUNTER;
+
+   assert(ft != NULL);
+   assert(pCursor != NULL);
+   curr = __atomic_load_n(&ft->root, __ATOMIC_ACQUIRE);
+   if(curr == NULL || pCursor->step != FT_COMPONENT ||
+      pCursor->length != Node_getNameLength(curr) ||
+      strncmp(pCursor->name, Node_getName(curr), pCursor->length)) {
+      FT_STATS_VISITED(pathVisits);
+      return NULL;
+   }
+
+   /* Descends while the next component names one of curr's children */
+   FT_STATS_VISIT;
+   while(FT_nextComponent(pCursor) == FT_COMPONENT) {
+      child = Node_findChild(curr, pCursor->name, pCursor->length);
+      if(child == NULL)
+         break;
+      FT_STATS_VISIT;
+      curr = child;
+   }
+   FT_STATS_VISITED(pathVisits);
+   return curr;
+}
+
+/*
+   Returns the node of ft whose path is exactly path,
+   or NULL if there is no such node in the hierarchy.
+   Looks path up in ft's index, if it has one, rather than walking
+   down from the root.
 */
 
-boolean FT_containsDir(char *path){ 
+static Node_T FT_findNode(FT_T ft, char* path){
    Node_T curr;
-   boolean result;
+   struct ftCursor cursor;
+   PathIndex_T index;
+
+   assert(ft != NULL);
    assert(path != NULL);
+   index = __atomic_load_n(&ft->index, __ATOMIC_ACQUIRE);
+   if(index != NULL)
+      return PathIndex_find(index, path, strlen(path));
+   (void) FT_firstComponent(&cursor, path);
+   curr = FT_traversePath(ft, &cursor);
+   if(cursor.step != FT_END)
+      return NULL;
+   return curr;
+}
 
-   if(!isInitialized){
-      result = FALSE; 
-      return result;
+/*
+  Returns a new, empty file tree,
+  or NULL if unable to allocate memory.
+*/
+
+FT_T FT_new(void){
+   FT_T ft;
+
+   ft = (FT_T) malloc(sizeof(struct ft));
+   if (ft == NULL)
+      return NULL;
+   ft->pool = Pool_new();
+   if (ft->pool == NULL) {
+      free(ft);
+      return NULL;
+   }
+#ifdef FT_THREADSAFE
+   if (pthread_mutex_init(&ft->lock, NULL) != 0) {
+      Pool_free(ft->pool);
+      free(ft);
+      return NULL;
    }
+#endif
+   ft->root = NULL;
+   ft->count = 0;
+   ft->index = NULL;
+   ft->journal = NULL;
+   ft->compactSize = 0;
+   ft->source = NULL;
+   ft->snapshots = 0;
+   return ft;
+}
 
-   curr = FT_traversePath(path);
+/*
+  Frees ft and all of its contents, or, if ft is a snapshot, the
+  nodes that only it still holds.
+*/
 
-   if(curr == NULL){
-      result = FALSE; 
+void FT_free(FT_T ft){
+   assert(ft != NULL);
+
+   if(ft->source != NULL) {
+      /* Gives back to the live tree only what nothing else holds */
+      FT_lock(ft->source);
+      if(ft->root != NULL)
+         Node_release(ft->root, ft->source->pool);
+      ft->source->snapshots--;
+      FT_unlock(ft->source);
+   }
+   assert(ft->snapshots == 0);
+   if(ft->journal != NULL)
+      (void) Journal_close(ft->journal);
+#ifdef FT_THREADSAFE
+   (void) pthread_mutex_destroy(&ft->lock);
+#endif
+   /* Frees every node at once, slab by slab, rather than node by node */
+   Pool_free(ft->pool);
+   free(ft);
+}
+
+/*
+  Returns a read-only snapshot of ft as it is now, which shares every
+  node with ft until ft changes it, or NULL if unable to allocate
+  memory. Takes constant time.
+*/
+
+FT_T FT_snapshotIn(FT_T ft){
+   FT_T snapshot;
+   FT_T source;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+
+   snapshot = FT_new();
+   if(snapshot == NULL) {
+      FT_STATS_STOP(FT_OP_SNAPSHOT);
+      return NULL;
+   }
+   /* A snapshot of a snapshot shares the nodes of the same tree */
+   source = (ft->source != NULL) ? ft->source : ft;
+   FT_lock(source);
+   snapshot->root = ft->root;
+   if(snapshot->root != NULL)
+      Node_share(snapshot->root);
+   snapshot->count = ft->count;
+   snapshot->source = source;
+   source->snapshots++;
+   FT_unlock(source);
+   FT_STATS_STOP(FT_OP_SNAPSHOT);
+   return snapshot;
+}
+
+/*
+  Builds an index from full path to node for ft, if it has none,
+  and keeps it up to date from then on, so that lookups of an exact
+  path no longer walk down from the root.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise.
+*/
+
+int FT_enableIndexIn(FT_T ft){
+   PathIndex_T index;
+   int result = SUCCESS;
+
+   assert(ft != NULL);
+
+   if(ft->source != NULL)
+      return READ_ONLY;
+   FT_lock(ft);
+   if(ft->index == NULL) {
+      index = PathIndex_new(ft->pool);
+      if(index == NULL)
+         result = MEMORY_ERROR;
+      else if(!FT_walk(ft->root, PathIndex_hashStart(), FT_visitIndex,
+                       index)) {
+         PathIndex_retire(index);
+         result = MEMORY_ERROR;
+      }
+      else
+         __atomic_store_n(&ft->index, index, __ATOMIC_RELEASE);
+   }
+   FT_unlock(ft);
+   return result;
+}
+
+/*
+   Inserts a new directory into ft at path, if possible.
+   Returns SUCCESS if the new directory is inserted.
+   Returns CONFLICTING_PATH if path is not underneath existing root,
+                            or is empty or has an empty component.
+   Returns NOT_A_DIRECTORY if a proper prefix of path exists as a file.
+   Returns ALREADY_IN_TREE if the path already exists (as dir or file).
+   Returns PARENT_CHILD_ERROR if a new child cannot be added in path.
+   Returns MEMORY_ERROR if unable to allocate sufficient memory.
+*/
+
+int FT_insertDirIn(FT_T ft, char *path){
+   Node_T curr;
+   struct ftCursor cursor;
+   struct ftCursor first;
+   int result;
+   FT_STATS_START;
+   assert(ft != NULL);
+   assert(path != NULL);
+   if(ft->source != NULL) {
+      FT_STATS_STOP(FT_OP_INSERT_DIR);
+      return READ_ONLY;
+   }
+   FT_lock(ft);
+   (void) FT_firstComponent(&cursor, path);
+   curr = FT_traversePath(ft, &cursor);
+   first = cursor;
+   result = FT_checkInsert(ft, &cursor, curr, FALSE);
+   if(result == SUCCESS)
+      result = FT_journalBegin(ft, JOURNAL_INSERT_DIR, path, NULL, 0);
+   if(result != SUCCESS) {
+      FT_unlock(ft);
+      FT_STATS_STOP(FT_OP_INSERT_DIR);
       return result;
    }
-   else if(strcmp(path,Node_getPath(curr)))
-      result = FALSE;
+   result = FT_unshareParent(ft, &curr, &cursor);
+   if(result == SUCCESS)
+      result = FT_insertRestOfPath(ft, &cursor, curr);
+   if(result == SUCCESS)
+      FT_indexInserted(ft, path, curr, &first);
+   result = FT_journalEnd(ft, result);
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_INSERT_DIR);
+   return result;
+}
+
+
+/*
+  Returns TRUE if ft contains the full path parameter as a
+  directory and FALSE otherwise.
+*/
+
+boolean FT_containsDirIn(FT_T ft, char *path){ 
+   Node_T curr;
+   boolean result;
+   FT_STATS_START;
+   assert(ft != NULL);
+   assert(path != NULL);
+
+   FT_beginRead(ft);
+   curr = FT_findNode(ft, path);
+
+   if(curr == NULL)
+      result = FALSE; 
    else if (Node_getStatus(curr) != FALSE) result = FALSE; 
    else
       result = TRUE;
+   FT_endRead(ft);
+   FT_STATS_STOP(FT_OP_CONTAINS_DIR);
    return result;   
    
 }
 
 /*
-  Removes the FT hierarchy rooted at the directory path.
+  Removes the hierarchy of ft rooted at the directory path.
   Returns SUCCESS if found and removed.
-  Returns INITIALIZATION_ERROR if not in an initialized state.
   Returns NOT_A_DIRECTORY if path exists but is a file not a directory.
   Returns NO_SUCH_PATH if the path does not exist in the hierarchy.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
 */
 
 
-int FT_rmDir(char *path){
+int FT_rmDirIn(FT_T ft, char *path){
    Node_T curr;
    int result;
+   FT_STATS_START;
+   assert(ft != NULL);
    assert(path != NULL);
 
-   if(!isInitialized)
-      return INITIALIZATION_ERROR;
-   curr = FT_traversePath(path);
+   if(ft->source != NULL) {
+      FT_STATS_STOP(FT_OP_RM_DIR);
+      return READ_ONLY;
+   }
+   FT_lock(ft);
+   curr = FT_findNode(ft, path);
    if(curr == NULL)
       result = NO_SUCH_PATH;
    else
-      result = FT_rmPathAt(path, curr);
+      result = FT_journalBegin(ft, JOURNAL_RM_DIR, path, NULL, 0);
+   if(result == SUCCESS)
+      result = FT_journalEnd(ft, FT_rmPathAt(ft, curr, path));
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_RM_DIR);
    return result; 
 }
 
 
 
 /*
-   Inserts a new file into the hierarchy at the given path, with the
+   Inserts a new file into ft at the given path, with the
    given contents of size length bytes.
    Returns SUCCESS if the new file is inserted.
-   Returns INITIALIZATION_ERROR if not in an initialized state.
    Returns CONFLICTING_PATH if path is not underneath existing root, 
-                            or if path would be the FT root.
+                            if path would be the FT root,
+                            or if path is empty or has an empty
+                            component.
    Returns NOT_A_DIRECTORY if a proper prefix of path exists as a file.
    Returns ALREADY_IN_TREE if the path already exists (as dir or file).
    Returns PARENT_CHILD_ERROR if a new child cannot be added in path.
    Returns MEMORY_ERROR if unable to allocate sufficient memory.
 */
 
-int FT_insertFile(char *path, void *contents, size_t length){
+int FT_insertFileIn(FT_T ft, char *path, void *contents, size_t length){
    Node_T curr;
+   struct ftCursor cursor;
+   struct ftCursor first;
    int result;
+   FT_STATS_START;
+   assert (ft != NULL);
    assert (path != NULL);
 
-   if (!isInitialized)
-      return INITIALIZATION_ERROR;
-   curr = FT_traversePath(path);
-   result = FT_appendFiles(path, curr, contents, length);
+   if(ft->source != NULL) {
+      FT_STATS_STOP(FT_OP_INSERT_FILE);
+      return READ_ONLY;
+   }
+   FT_lock(ft);
+   (void) FT_firstComponent(&cursor, path);
+   curr = FT_traversePath(ft, &cursor);
+   first = cursor;
+   result = FT_checkInsert(ft, &cursor, curr, TRUE);
+   if(result == SUCCESS)
+      result = FT_journalBegin(ft, JOURNAL_INSERT_FILE, path,
+                               contents, length);
+   if(result != SUCCESS) {
+      FT_unlock(ft);
+      FT_STATS_STOP(FT_OP_INSERT_FILE);
+      return result;
+   }
+   result = FT_unshareParent(ft, &curr, &cursor);
+   if(result == SUCCESS)
+      result = FT_appendFiles(ft, &cursor, curr, contents, length);
+   if(result == SUCCESS)
+      FT_indexInserted(ft, path, curr, &first);
+   result = FT_journalEnd(ft, result);
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_INSERT_FILE);
    return result; 
 }
 
 /*
-  Returns TRUE if the tree contains the full path parameter as a
+  Returns TRUE if ft contains the full path parameter as a
   file and FALSE otherwise.
 */
 
-boolean FT_containsFile(char *path){
+boolean FT_containsFileIn(FT_T ft, char *path){
    Node_T curr;
    boolean result;
+   FT_STATS_START;
+   assert (ft != NULL);
    assert (path != NULL);
-   if (!isInitialized)
-      return FALSE;
-   curr = FT_traversePath(path);
+   FT_beginRead(ft);
+   curr = FT_findNode(ft, path);
 
    if(curr == NULL)
       result = FALSE;
-   else if(strcmp(path, Node_getPath(curr)))
+   else if(Node_getStatus(curr) != TRUE)
       result = FALSE;
-   else if(Node_getStatus(curr) != TRUE){
-      result = FALSE;
-      return result; 
-   }
    else
       result = TRUE;
+   FT_endRead(ft);
+   FT_STATS_STOP(FT_OP_CONTAINS_FILE);
    return result; 
 }
                
 /*
-  Removes the FT file at path.
+  Removes the file at path from ft.
   Returns SUCCESS if found and removed.
-  Returns INITIALIZATION_ERROR if not in an initialized state.
   Returns NOT_A_FILE if path exists but is a directory not a file.
   Returns NO_SUCH_PATH if the path does not exist in the hierarchy.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
 */
 
-int FT_rmFile(char *path){
-   Node_T parent;
+int FT_rmFileIn(FT_T ft, char *path){
    Node_T curr;
+   Node_T parent = NULL;
+   int result;
+   FT_STATS_START;
+   assert (ft != NULL);
    assert (path != NULL); 
-   curr = FT_traversePath(path);
+   if(ft->source != NULL) {
+      FT_STATS_STOP(FT_OP_RM_FILE);
+      return READ_ONLY;
+   }
+   FT_lock(ft);
+   curr = FT_findNode(ft, path);
    
-   if (strcmp(path,Node_getPath(curr))) return NO_SUCH_PATH; 
-   else if (Node_getStatus(curr) != TRUE) return NOT_A_FILE; 
-   else{
+   if (curr != NULL)
       parent = Node_getParent(curr);
-      Node_unlinkChild(parent ,curr);
+   if (curr == NULL) result = NO_SUCH_PATH; 
+   else if (Node_getStatus(curr) != TRUE) result = NOT_A_FILE; 
+   else result = FT_journalBegin(ft, JOURNAL_RM_FILE, path, NULL, 0);
+   if (result == SUCCESS) {
+      if (FT_unshare(ft, &parent) != SUCCESS ||
+          Node_unlinkChild(parent, curr, ft->pool) != SUCCESS)
+         result = MEMORY_ERROR;
+      else{
+         if(ft->index != NULL)
+            PathIndex_remove(ft->index,
+                             PathIndex_hashAppend(PathIndex_hashStart(),
+                                                  path, strlen(path)),
+                             curr);
+         FT_removePathFrom(ft, curr);
+      }
+      result = FT_journalEnd(ft, result);
    }
-   FT_removePathFrom(curr);
-   return SUCCESS; 
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_RM_FILE);
+   return result; 
                      
 }
 
 /*
-  Returns the contents of the file at the full path parameter.
+  Returns the contents of the file of ft at the full path parameter.
   Returns NULL if the path does not exist or is a directory.
   Note: checking for a non-NULL return is not an appropriate
   contains check -- the contents of a file may be NULL.
 */
 
-void *FT_getFileContents(char *path){
+void *FT_getFileContentsIn(FT_T ft, char *path){
    Node_T curr;
    void* contents;
+   FT_STATS_START;
+   assert (ft != NULL);
    assert (path != NULL);
-   if (!isInitialized)
-      return (void*) INITIALIZATION_ERROR;
-   curr = FT_traversePath(path);
+   FT_beginRead(ft);
+   curr = FT_findNode(ft, path);
 
    if (curr == NULL)
       contents = NULL;
@@ -522,40 +1592,184 @@ void *FT_getFileContents(char *path){
       contents = NULL;  
    else
       contents = Node_getFileContents(curr);
+   FT_endRead(ft);
+   FT_STATS_STOP(FT_OP_GET_CONTENTS);
    return contents; 
    
 }
 
 /*
-  Replaces current contents of the file at the full path parameter with
-  the parameter newContents of size newLength.
+  Replaces current contents of the file of ft at the full path
+  parameter with the parameter newContents of size newLength.
   Returns the old contents if successful. (Note: contents may be NULL.)
-  Returns NULL if the path does not already exist or is a directory.
+  Returns NULL if the path does not already exist or is a directory,
+  if ft is a snapshot, if the file is shared with a snapshot and
+  cannot be copied, or if the change cannot be journaled.
 */
 
-void *FT_replaceFileContents(char *path, void *newContents,
-                             size_t newLength){
+void *FT_replaceFileContentsIn(FT_T ft, char *path, void *newContents,
+                               size_t newLength){
    Node_T curr;
    void* oldContents; 
+   FT_STATS_START;
+   assert (ft != NULL);
    assert (path != NULL);
-   if (!isInitialized)
+   if(ft->source != NULL) {
+      FT_STATS_STOP(FT_OP_REPLACE);
       return NULL;
-   curr = FT_traversePath(path);
+   }
+   FT_lock(ft);
+   curr = FT_findNode(ft, path);
    if (curr == NULL)
       oldContents = NULL; 
    else if (Node_getStatus(curr) != TRUE) oldContents = NULL; 
-   else if(strcmp(path,Node_getPath(curr))) oldContents = NULL; 
+   else if (FT_journalBegin(ft, JOURNAL_REPLACE, path, newContents,
+                            newLength) != SUCCESS)
+      oldContents = NULL;
+   else if (FT_unshare(ft, &curr) != SUCCESS) {
+      (void) FT_journalEnd(ft, MEMORY_ERROR);
+      oldContents = NULL;
+   }
    else{
       oldContents = Node_getFileContents(curr); 
       Node_changeFileContents(curr, newContents, newLength); 
+      (void) FT_journalEnd(ft, SUCCESS);
    }
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_REPLACE);
    return oldContents; 
 }
 
 /*
-  Returns SUCCESS if path exists in the hierarchy,
-  returns NO_SUCH_PATH if it does not, and
-  returns INITIALIZATION_ERROR if the structure is not initialized.
+   Returns the hash of the path of the parent of n, whose path is the
+   first length characters of path, or of the empty path if n is the
+   root.
+*/
+static unsigned long FT_hashParent(Node_T n, const char* path,
+                                   size_t length){
+   assert(n != NULL);
+   assert(path != NULL);
+   if(Node_getParent(n) == NULL)
+      return PathIndex_hashStart();
+   return PathIndex_hashAppend(PathIndex_hashStart(), path,
+                               length - Node_getNameLength(n) - 1);
+}
+
+/*
+  Moves the node of ft at oldPath, with its descendants, to newPath.
+  Only the children of the old and new parents are re-sorted, so the
+  move takes time independent of the size of the subtree, except
+  that the index, if enabled, rehashes the subtree's entries.
+  Returns as FT_rename does.
+*/
+
+int FT_renameIn(FT_T ft, char *oldPath, char *newPath){
+   Node_T curr;
+   Node_T parent;
+   Node_T ancestor;
+   struct ftCursor cursor;
+   struct ftCursor rest;
+   int result;
+   FT_STATS_START;
+   assert(ft != NULL);
+   assert(oldPath != NULL);
+   assert(newPath != NULL);
+
+   if(ft->source != NULL) {
+      FT_STATS_STOP(FT_OP_RENAME);
+      return READ_ONLY;
+   }
+   FT_lock(ft);
+   curr = FT_findNode(ft, oldPath);
+   (void) FT_firstComponent(&cursor, newPath);
+   parent = FT_traversePath(ft, &cursor);
+
+   /* Checks the rest of newPath, past the part that exists, is
+      well-formed */
+   rest = cursor;
+   while(rest.step == FT_COMPONENT)
+      (void) FT_nextComponent(&rest);
+
+   if(curr == NULL)
+      result = NO_SUCH_PATH;
+   else if(rest.step == FT_MALFORMED)
+      result = CONFLICTING_PATH;
+   else if(cursor.step == FT_END)
+      result = ALREADY_IN_TREE;
+   else if(parent == NULL)
+      /* Only the root can be renamed to a path not under the root */
+      result = (Node_getParent(curr) == NULL &&
+                FT_isLastComponent(&cursor)) ? SUCCESS
+                                             : CONFLICTING_PATH;
+   else if(Node_getStatus(parent) == TRUE)
+      result = NOT_A_DIRECTORY;
+   else if(!FT_isLastComponent(&cursor))
+      result = NO_SUCH_PATH;
+   else {
+      /* A directory cannot move below itself */
+      result = SUCCESS;
+      for(ancestor = parent; ancestor != NULL;
+          ancestor = Node_getParent(ancestor))
+         if(ancestor == curr)
+            result = CONFLICTING_PATH;
+   }
+   if(result == SUCCESS)
+      result = FT_journalBegin(ft, JOURNAL_RENAME, oldPath, newPath,
+                               strlen(newPath) + 1);
+   if(result != SUCCESS) {
+      FT_unlock(ft);
+      FT_STATS_STOP(FT_OP_RENAME);
+      return result;
+   }
+   /* The new parent first: unsharing curr cannot copy it then */
+   if(parent != NULL)
+      result = FT_unshare(ft, &parent);
+   if(result == SUCCESS)
+      result = FT_unshare(ft, &curr);
+   if(result != SUCCESS) {
+      (void) FT_journalEnd(ft, result);
+      FT_unlock(ft);
+      FT_STATS_STOP(FT_OP_RENAME);
+      return result;
+   }
+
+   /* Takes the subtree out of the index under its old paths; this,
+      and putting it back, are the only parts of a rename that take
+      time in the size of the subtree */
+   if(ft->index != NULL &&
+      !FT_walk(curr, FT_hashParent(curr, oldPath, strlen(oldPath)),
+               FT_visitUnindex, ft->index))
+      FT_dropIndex(ft);
+
+   if(parent == NULL) {
+      /* The root is hidden by emptying the tree instead */
+      __atomic_store_n(&ft->root, NULL, __ATOMIC_RELEASE);
+      result = Node_move(curr, NULL, cursor.name, cursor.length,
+                         FT_quiesce, ft->pool);
+      __atomic_store_n(&ft->root, curr, __ATOMIC_RELEASE);
+   }
+   else
+      result = Node_move(curr, parent, cursor.name, cursor.length,
+                         FT_quiesce, ft->pool);
+
+   /* Puts the subtree back in the index under its paths as of now */
+   if(ft->index != NULL &&
+      !FT_walk(curr,
+               result == SUCCESS
+                  ? FT_hashParent(curr, newPath, strlen(newPath))
+                  : FT_hashParent(curr, oldPath, strlen(oldPath)),
+               FT_visitIndex, ft->index))
+      FT_dropIndex(ft);
+
+   result = FT_journalEnd(ft, result);
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_RENAME);
+   return result;
+}
+
+/*
+  Returns SUCCESS if path exists in ft,
+  and returns NO_SUCH_PATH if it does not.
   When returning SUCCESSS,
   if path is a directory: *type is set to FALSE, *length is unchanged
   if path is a file: *type is set to TRUE, and
@@ -563,88 +1777,2335 @@ void *FT_replaceFileContents(char *path, void *newContents,
   When returning a non-SUCCESS status, *type and *length are unchanged.
 */
 
-int FT_stat(char *path, boolean *type, size_t *length){
+int FT_statIn(FT_T ft, char *path, boolean *type, size_t *length){
    Node_T curr; 
+   int result = SUCCESS;
+   FT_STATS_START;
+   assert (ft != NULL);
    assert (path != NULL);
-   if (!isInitialized)
-      return INITIALIZATION_ERROR;
-   curr = FT_traversePath(path);
-   if (strcmp(path, Node_getPath(curr)))
-      return NO_SUCH_PATH; 
-   if (Node_getStatus(curr) == FALSE)
+   FT_beginRead(ft);
+   curr = FT_findNode(ft, path);
+   if (curr == NULL)
+      result = NO_SUCH_PATH; 
+   else if (Node_getStatus(curr) == FALSE)
       *type = FALSE;
    else{
       *type = TRUE;
       *length = Node_getFileLength(curr); 
    }
-   return SUCCESS; 
+   FT_endRead(ft);
+   FT_STATS_STOP(FT_OP_STAT);
+   return result; 
 }
 
-
 /*
-  Sets the data structure to initialized status.
-  The data structure is initially empty.
-  Returns INITIALIZATION_ERROR if already initialized,
-  and SUCCESS otherwise.
+  Returns SUCCESS if path exists in ft, storing in *files, *dirs and
+  *bytes the number of files and of directories at or under path and
+  the total length of those files' contents, as FT_du does, and
+  returns NO_SUCH_PATH, leaving them unchanged, if it does not.
+  Every directory keeps these totals as the tree changes, so this
+  takes time proportional only to path's depth; a reader that runs
+  during a change may see it in some of the totals and not others.
 */
 
-int FT_init(void){
-   if (isInitialized)
-      return INITIALIZATION_ERROR;
-   isInitialized = 1;
-   root = NULL;
-   count = 0;
-   return SUCCESS; 
+int FT_duIn(FT_T ft, char *path, size_t *files, size_t *dirs,
+            size_t *bytes){
+   Node_T curr;
+   int result = SUCCESS;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(path != NULL);
+   assert(files != NULL);
+   assert(dirs != NULL);
+   assert(bytes != NULL);
+   FT_beginRead(ft);
+   curr = FT_findNode(ft, path);
+   if(curr == NULL)
+      result = NO_SUCH_PATH;
+   else
+      Node_getTotals(curr, files, dirs, bytes);
+   FT_endRead(ft);
+   FT_STATS_STOP(FT_OP_DU);
+   return result;
 }
 
 /*
-  Removes all contents of the data structure and
-  returns it to uninitialized status.
-  Returns INITIALIZATION_ERROR if not already initialized,
-  and SUCCESS otherwise.
+   A cursor over the entries under one directory, in pre-order, which
+   holds nothing of the tree between reads, so that an open cursor
+   costs the tree's changes nothing: the tree, the path of the opened
+   directory, the depth to list down to, and the path, relative to
+   the opened directory, of the entry read last or sought past, with
+   its length, 0 before the first read, and its kind. Each read finds
+   that entry again, or where it would be, in the tree as it is then.
 */
+struct ftDir {
+   FT_T ft;
+   char* base;
+   size_t maxDepth;
+   struct ftPath path;
+   size_t length;
+   boolean isFile;
+};
 
-int FT_destroy(void){
-   if(!isInitialized)
-      return INITIALIZATION_ERROR;
-   FT_removePathFrom(root);
-   root = NULL;
-   isInitialized = 0;
-   return SUCCESS; 
+/*
+   Returns TRUE if pDir lists the children of n, a directory at the
+   given depth below the opened one, and FALSE otherwise.
+*/
+static boolean FT_dirDescends(FTDir_T pDir, Node_T n, size_t depth) {
+   assert(pDir != NULL);
+   assert(n != NULL);
+   return Node_getStatus(n) == FALSE && Node_getNumChildren(n) > 0 &&
+          (pDir->maxDepth == 0 || depth < pDir->maxDepth);
 }
 
 /*
-  Returns a string representation of the
-  data structure, or NULL if the structure is
-  not initialized or there is an allocation error.
-  Allocates memory for the returned string,
-  which is then owned by client!
+  Opens in *pDir a cursor over the entries under the directory path
+  of ft, down to maxDepth levels below it, or all of them if maxDepth
+  is 0, as FT_openTree does.
+  Returns NO_SUCH_PATH if path is not in ft, NOT_A_DIRECTORY if it is
+  a file, MEMORY_ERROR if unable to allocate sufficient memory, and
+  SUCCESS otherwise.
 */
+int FT_openTreeIn(FT_T ft, char *path, size_t maxDepth, FTDir_T *pDir){
+   FTDir_T dir;
+   Node_T curr;
+   int result = SUCCESS;
+   FT_STATS_START;
 
-char *FT_toString(void){
-   DynArray_T nodes;
-   size_t totalStrlen = 1;
-   char* result = NULL;
+   assert(ft != NULL);
+   assert(path != NULL);
+   assert(pDir != NULL);
 
-   if(!isInitialized)
-      return NULL;
+   FT_beginRead(ft);
+   curr = FT_findNode(ft, path);
+   if(curr == NULL)
+      result = NO_SUCH_PATH;
+   else if(Node_getStatus(curr) == TRUE)
+      result = NOT_A_DIRECTORY;
+   FT_endRead(ft);
+   if(result != SUCCESS) {
+      FT_STATS_STOP(FT_OP_OPEN_TREE);
+      return result;
+   }
+
+   dir = malloc(sizeof(struct ftDir));
+   if(dir == NULL) {
+      FT_STATS_STOP(FT_OP_OPEN_TREE);
+      return MEMORY_ERROR;
+   }
+   dir->base = malloc(strlen(path) + 1);
+   if(dir->base == NULL) {
+      free(dir);
+      FT_STATS_STOP(FT_OP_OPEN_TREE);
+      return MEMORY_ERROR;
+   }
+   strcpy(dir->base, path);
+   dir->ft = ft;
+   dir->maxDepth = maxDepth;
+   dir->path.string = NULL;
+   dir->path.size = 0;
+   dir->length = 0;
+   dir->isFile = FALSE;
+   *pDir = dir;
+   FT_STATS_STOP(FT_OP_OPEN_TREE);
+   return SUCCESS;
+}
+
+/*
+  Opens in *pDir a cursor over the children of the directory path of
+  ft, as FT_openDir does.
+  Returns as FT_openTreeIn does.
+*/
+
+int FT_openDirIn(FT_T ft, char *path, FTDir_T *pDir){
+   return FT_openTreeIn(ft, path, 1, pDir);
+}
 
-   nodes = DynArray_new(count);
-   (void) FT_preOrderTraversal(root, nodes, 0);
+/*
+   Returns the entry of dir's tree that comes after the entry at
+   dir's path, or NULL if none does, and stores in *pOffset the
+   length of the path of the returned entry's parent relative to the
+   opened directory. Finds it in one walk down that path, as far as
+   it is still in the tree: the next entry is the first child of the
+   entry itself, if dir lists them, and otherwise the first sibling
+   after the deepest component of the path that has one.
+*/
+static Node_T FT_dirNext(FTDir_T dir, size_t* pOffset) {
+   struct ftCursor cursor;
+   Node_T curr;
+   Node_T child;
+   Node_T next = NULL;
+   size_t depth;
+   boolean status;
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strlenAccumulate, (void*) &totalStrlen);
+   assert(dir != NULL);
+   assert(pOffset != NULL);
 
-   result = malloc(totalStrlen);
-   if(result == NULL) {
-      DynArray_free(nodes);
+   curr = FT_findNode(dir->ft, dir->base);
+   if(curr == NULL || Node_getStatus(curr) == TRUE)
       return NULL;
+   *pOffset = 0;
+   if(dir->length == 0)
+      return Node_getChild(curr, 0);
+
+   (void) FT_firstComponent(&cursor, dir->path.string);
+   for(depth = 1; ; depth++) {
+      status = FT_isLastComponent(&cursor) ? dir->isFile : FALSE;
+      child = Node_getChildAfter(curr, cursor.name, cursor.length,
+                                 status);
+      if(child != NULL) {
+         next = child;
+         *pOffset = (size_t) (cursor.name - dir->path.string);
+         if(*pOffset > 0)
+            (*pOffset)--;
+      }
+      child = Node_findChild(curr, cursor.name, cursor.length);
+      if(child == NULL || Node_getStatus(child) != status ||
+         !FT_dirDescends(dir, child, depth))
+         break;
+      if(FT_isLastComponent(&cursor)) {
+         /* The children of an entry come right after it */
+         child = Node_getChild(child, 0);
+         if(child != NULL) {
+            next = child;
+            *pOffset = dir->length;
+         }
+         break;
+      }
+      curr = child;
+      (void) FT_nextComponent(&cursor);
    }
-   *result = '\0';
+   return next;
+}
+
+/* see ft.h for specification */
+int FT_readDir(FTDir_T dir, const char **name, boolean *isFile,
+               size_t *length){
+   Node_T next;
+   size_t offset;
+   size_t pathLength;
+   int result = NO_SUCH_PATH;
+   FT_STATS_START;
 
-   DynArray_map(nodes, (void (*)(void *, void*)) FT_strcatAccumulate, (void *) result);
+   assert(dir != NULL);
+   assert(name != NULL);
+   assert(isFile != NULL);
+   assert(length != NULL);
 
-   DynArray_free(nodes);
+   FT_beginRead(dir->ft);
+   next = FT_dirNext(dir, &offset);
+   if(next != NULL) {
+      /* Moves past next only once nothing can fail, so that a read
+         that runs out of memory can be tried again */
+      pathLength = FT_appendName(&dir->path, next, offset);
+      if(pathLength == 0)
+         result = MEMORY_ERROR;
+      else {
+         dir->length = pathLength;
+         dir->isFile = Node_getStatus(next);
+         *name = dir->path.string;
+         *isFile = dir->isFile;
+         *length = *isFile ? Node_getFileLength(next) : 0;
+         result = SUCCESS;
+      }
+   }
+   FT_endRead(dir->ft);
+   FT_STATS_STOP(FT_OP_READ_DIR);
    return result;
 }
-   
 
+/* see ft.h for specification */
+int FT_seekDir(FTDir_T dir, const char *name, boolean isFile){
+   struct ftCursor cursor;
+   size_t length;
+   FT_STATS_START;
+
+   assert(dir != NULL);
+   assert(name != NULL);
+
+   (void) FT_firstComponent(&cursor, name);
+   while(cursor.step == FT_COMPONENT)
+      (void) FT_nextComponent(&cursor);
+   if(cursor.step == FT_MALFORMED) {
+      FT_STATS_STOP(FT_OP_SEEK_DIR);
+      return CONFLICTING_PATH;
+   }
+
+   /* The next read finds the entry after name */
+   length = strlen(name);
+   if(!FT_reservePath(&dir->path, length)) {
+      FT_STATS_STOP(FT_OP_SEEK_DIR);
+      return MEMORY_ERROR;
+   }
+   memcpy(dir->path.string, name, length + 1);
+   dir->length = length;
+   dir->isFile = isFile;
+   FT_STATS_STOP(FT_OP_SEEK_DIR);
+   return SUCCESS;
+}
+
+/* see ft.h for specification */
+void FT_closeDir(FTDir_T dir){
+   if(dir == NULL)
+      return;
+   free(dir->base);
+   free(dir->path.string);
+   free(dir);
+}
+
+/*
+  Returns a string representation of ft,
+  or NULL if there is an allocation error.
+  Allocates memory for the returned string,
+  which is then owned by client!
+*/
+
+char *FT_toStringIn(FT_T ft){
+   struct ftBuffer acc;
+   size_t totalStrlen = 1;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+
+   /* Both passes must see the same tree */
+   FT_lock(ft);
+   acc.string = NULL;
+   if(FT_traverse(ft, FT_strlenAccumulate, &totalStrlen))
+      acc.string = malloc(totalStrlen);
+   acc.end = 0;
+   if(acc.string != NULL &&
+      !FT_traverse(ft, FT_copyAccumulate, &acc)) {
+      free(acc.string);
+      acc.string = NULL;
+   }
+   FT_unlock(ft);
+
+   if(acc.string != NULL)
+      acc.string[acc.end] = '\0';
+   FT_STATS_STOP(FT_OP_TO_STRING);
+   return acc.string;
+}
+
+/*
+  Calls (*pfApply)(path, length, pvExtra) with the path of each node
+  of ft and that path's length, in the same order that
+  FT_toStringIn lists them, without building the whole listing.
+  The path is only valid during the call.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise.
+*/
+
+int FT_mapIn(FT_T ft,
+             void (*pfApply)(const char *path, size_t length,
+                             void *pvExtra),
+             void *pvExtra){
+   int result = SUCCESS;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(pfApply != NULL);
+
+   FT_lock(ft);
+   if(!FT_traverse(ft, pfApply, pvExtra))
+      result = MEMORY_ERROR;
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_MAP);
+   return result;
+}
+
+/*
+   Returns TRUE if character c matches the pattern item at
+   pattern[*pIndex], among the first length characters of pattern,
+   and moves *pIndex past the item. An item is '?', which matches any
+   character; a set in brackets, such as "[a-z_]" or "[!0-9]", which
+   matches any character in, or with '!' or '^' not in, the set; a
+   '\' followed by a character that it matches literally; or any
+   other character, which matches itself. A '[' without its ']' is
+   an ordinary character.
+*/
+static boolean FT_matchItem(const char* pattern, size_t length,
+                            size_t* pIndex, char c) {
+   size_t i;
+   size_t close;
+   boolean negate;
+   boolean found = FALSE;
+
+   assert(pattern != NULL);
+   assert(pIndex != NULL);
+   assert(*pIndex < length);
+
+   i = *pIndex;
+   if(pattern[i] == '?') {
+      *pIndex = i + 1;
+      return TRUE;
+   }
+   if(pattern[i] == '\\' && i + 1 < length) {
+      *pIndex = i + 2;
+      return pattern[i + 1] == c;
+   }
+   if(pattern[i] == '[') {
+      /* A ']' right after the '[' or the '!' is in the set */
+      close = i + 1;
+      negate = close < length &&
+               (pattern[close] == '!' || pattern[close] == '^');
+      if(negate)
+         close++;
+      if(close < length)
+         close++;
+      while(close < length && pattern[close] != ']')
+         close++;
+      if(close < length) {
+         i += negate ? 2 : 1;
+         while(i < close) {
+            if(i + 2 < close && pattern[i + 1] == '-') {
+               if((unsigned char) pattern[i] <= (unsigned char) c &&
+                  (unsigned char) c <= (unsigned char) pattern[i + 2])
+                  found = TRUE;
+               i += 3;
+            }
+            else if(pattern[i++] == c)
+               found = TRUE;
+         }
+         *pIndex = close + 1;
+         return (boolean) (found != negate);
+      }
+   }
+   *pIndex = i + 1;
+   return pattern[i] == c;
+}
+
+/*
+   Returns TRUE if the first nameLength characters of name match the
+   first length characters of pattern, in which '*' matches any run
+   of characters and the other items are as for FT_matchItem, and
+   FALSE otherwise. Backtracks only to the last '*', so takes time
+   proportional at most to the product of the two lengths.
+*/
+static boolean FT_matchName(const char* pattern, size_t length,
+                            const char* name, size_t nameLength) {
+   size_t p = 0;
+   size_t n = 0;
+   size_t next;
+   size_t starP = 0;
+   size_t starN = 0;
+   boolean star = FALSE;
+
+   assert(pattern != NULL);
+   assert(name != NULL);
+
+   while(n < nameLength) {
+      if(p < length && pattern[p] == '*') {
+         star = TRUE;
+         starP = ++p;
+         starN = n;
+         continue;
+      }
+      next = p;
+      if(p < length && FT_matchItem(pattern, length, &next, name[n])) {
+         p = next;
+         n++;
+         continue;
+      }
+      /* Lets the last '*' swallow one more character */
+      if(!star)
+         return FALSE;
+      p = starP;
+      n = ++starN;
+   }
+   while(p < length && pattern[p] == '*')
+      p++;
+   return (boolean) (p == length);
+}
+
+/*
+   One component of a glob pattern: its text and length, and the
+   length of the literal prefix before its first special character,
+   which every name it matches starts with.
+*/
+struct ftGlobPart {
+   const char* text;
+   size_t length;
+   size_t literal;
+};
+
+/*
+   Where a glob stands in one directory it matches: the directory,
+   the length of its path, the index of its next child to try, and
+   whether that child is still among the files, which come first.
+*/
+struct ftGlobFrame {
+   Node_T dir;
+   size_t pathLength;
+   size_t next;
+   boolean inFiles;
+};
+
+/*
+   Sets up pFrame to try the children of dir, whose path is
+   pathLength long, against pPart, starting with the files if
+   withFiles is TRUE and with the directories otherwise, and at the
+   first child whose name could start with pPart's literal prefix.
+*/
+static void FT_globEnter(struct ftGlobFrame* pFrame, Node_T dir,
+                         size_t pathLength,
+                         const struct ftGlobPart* pPart,
+                         boolean withFiles) {
+   assert(pFrame != NULL);
+   assert(dir != NULL);
+   assert(pPart != NULL);
+
+   pFrame->dir = dir;
+   pFrame->pathLength = pathLength;
+   pFrame->inFiles = withFiles;
+   (void) Node_hasChild(dir, pPart->text, pPart->literal, withFiles,
+                        &pFrame->next);
+}
+
+/*
+   Returns the next child of pFrame's directory that could match
+   pPart: one that starts with its literal prefix, or, if it has no
+   special characters, that is exactly its text. Binary searches for
+   the directories once past the files. Returns NULL when there are
+   no more.
+*/
+static Node_T FT_globNext(struct ftGlobFrame* pFrame,
+                          const struct ftGlobPart* pPart) {
+   Node_T child;
+
+   assert(pFrame != NULL);
+   assert(pPart != NULL);
+
+   for(;;) {
+      if(pFrame->next < Node_getNumChildren(pFrame->dir)) {
+         child = Node_getChild(pFrame->dir, pFrame->next);
+         if(Node_getStatus(child) == pFrame->inFiles &&
+            Node_getNameLength(child) >= pPart->literal &&
+            !strncmp(Node_getName(child), pPart->text, pPart->literal) &&
+            (pPart->literal < pPart->length ||
+             Node_getNameLength(child) == pPart->length)) {
+            pFrame->next++;
+            return child;
+         }
+      }
+      if(!pFrame->inFiles)
+         return NULL;
+      (void) Node_hasChild(pFrame->dir, pPart->text, pPart->literal,
+                           FALSE, &pFrame->next);
+      pFrame->inFiles = FALSE;
+   }
+}
+
+/*
+  Calls (*pfApply)(path, length, pvExtra) with the path of each node
+  of ft that matches pattern, in the order FT_toStringIn lists them,
+  as FT_glob does. Each component is looked for only among the
+  children whose names start with its part before any special
+  character, found by binary search, and only directories are
+  searched for a component that is not the last.
+  Returns CONFLICTING_PATH if pattern is empty or has an empty
+  component, MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise.
+*/
+
+int FT_globIn(FT_T ft, char *pattern,
+              void (*pfApply)(const char *path, size_t length,
+                              void *pvExtra),
+              void *pvExtra){
+   struct ftCursor cursor;
+   struct ftGlobPart* parts;
+   struct ftGlobFrame* frames = NULL;
+   struct ftGlobFrame* top;
+   struct ftPath path;
+   size_t numParts = 0;
+   size_t depth = 0;
+   size_t length;
+   size_t i;
+   Node_T child;
+   int result = SUCCESS;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(pattern != NULL);
+   assert(pfApply != NULL);
+
+   (void) FT_firstComponent(&cursor, pattern);
+   while(cursor.step == FT_COMPONENT) {
+      numParts++;
+      (void) FT_nextComponent(&cursor);
+   }
+   if(cursor.step == FT_MALFORMED) {
+      FT_STATS_STOP(FT_OP_GLOB);
+      return CONFLICTING_PATH;
+   }
+   parts = malloc(numParts * sizeof(struct ftGlobPart));
+   /* The frames are for the directories above the last component */
+   if(numParts > 1)
+      frames = malloc((numParts - 1) * sizeof(struct ftGlobFrame));
+   if(parts == NULL || (numParts > 1 && frames == NULL)) {
+      free(parts);
+      free(frames);
+      FT_STATS_STOP(FT_OP_GLOB);
+      return MEMORY_ERROR;
+   }
+   (void) FT_firstComponent(&cursor, pattern);
+   for(i = 0; i < numParts; i++) {
+      parts[i].text = cursor.name;
+      parts[i].length = cursor.length;
+      parts[i].literal = strcspn(cursor.name, "*?[\\/");
+      (void) FT_nextComponent(&cursor);
+   }
+   path.string = NULL;
+   path.size = 0;
+
+   FT_lock(ft);
+   child = ft->root;
+   if(child != NULL &&
+      FT_matchName(parts[0].text, parts[0].length, Node_getName(child),
+                   Node_getNameLength(child))) {
+      length = FT_appendName(&path, child, 0);
+      if(length == 0)
+         result = MEMORY_ERROR;
+      else if(numParts == 1)
+         (*pfApply)(path.string, length, pvExtra);
+      else if(Node_getStatus(child) == FALSE) {
+         FT_globEnter(&frames[0], child, length, &parts[1],
+                      numParts == 2);
+         depth = 1;
+      }
+   }
+
+   /* The frame at depth d matches its children against part d */
+   while(result == SUCCESS && depth > 0) {
+      top = &frames[depth - 1];
+      child = FT_globNext(top, &parts[depth]);
+      if(child == NULL) {
+         depth--;
+         continue;
+      }
+      if(!FT_matchName(parts[depth].text, parts[depth].length,
+                       Node_getName(child), Node_getNameLength(child)))
+         continue;
+      length = FT_appendName(&path, child, top->pathLength);
+      if(length == 0)
+         result = MEMORY_ERROR;
+      else if(depth == numParts - 1)
+         (*pfApply)(path.string, length, pvExtra);
+      else {
+         /* Only the last component can match a file */
+         FT_globEnter(&frames[depth], child, length, &parts[depth + 1],
+                      depth + 1 == numParts - 1);
+         depth++;
+      }
+   }
+   FT_unlock(ft);
+
+   free(path.string);
+   free(frames);
+   free(parts);
+   FT_STATS_STOP(FT_OP_GLOB);
+   return result;
+}
+
+/*
+  Calls (*pfApply)(path, length, pvExtra) with the path of each node
+  of ft whose path starts with prefix, in the order FT_toStringIn
+  lists them, as FT_listPrefix does. Goes straight down to the
+  directory the prefix names up to its last slash, and binary
+  searches its children for those that start with the rest.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory, and
+  SUCCESS otherwise.
+*/
+
+int FT_listPrefixIn(FT_T ft, char *prefix,
+                    void (*pfApply)(const char *path, size_t length,
+                                    void *pvExtra),
+                    void *pvExtra){
+   struct ftTraversal traversal;
+   const char* slash;
+   const char* last;
+   size_t dirLength;
+   size_t lastLength;
+   size_t componentLength;
+   size_t i;
+   Node_T curr;
+   Node_T child;
+   boolean status;
+   int result = SUCCESS;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(prefix != NULL);
+   assert(pfApply != NULL);
+
+   traversal.path.string = NULL;
+   traversal.path.size = 0;
+   traversal.pfApply = pfApply;
+   traversal.pvExtra = pvExtra;
+
+   FT_lock(ft);
+   curr = ft->root;
+   slash = strrchr(prefix, '/');
+   if(slash == NULL) {
+      /* The prefix is part of the root's name, or none of it */
+      lastLength = strlen(prefix);
+      if(curr != NULL && Node_getNameLength(curr) >= lastLength &&
+         !strncmp(Node_getName(curr), prefix, lastLength) &&
+         !FT_walk(curr, 0, FT_visitPath, &traversal))
+         result = MEMORY_ERROR;
+      FT_unlock(ft);
+      free(traversal.path.string);
+      FT_STATS_STOP(FT_OP_LIST_PREFIX);
+      return result;
+   }
+
+   /* Finds the directory whose path is the prefix up to its last
+      slash: what follows must start the name of one of its children */
+   dirLength = (size_t) (slash - prefix);
+   last = slash + 1;
+   lastLength = strlen(last);
+   if(dirLength == 0)
+      curr = NULL;
+   for(i = 0; curr != NULL && i <= dirLength;
+       i += componentLength + 1) {
+      componentLength = strcspn(prefix + i, "/");
+      if(i == 0)
+         curr = (componentLength == Node_getNameLength(curr) &&
+                 !strncmp(prefix, Node_getName(curr), componentLength))
+                ? curr : NULL;
+      else if(Node_getStatus(curr) == TRUE)
+         curr = NULL;
+      else
+         curr = Node_findChild(curr, prefix + i, componentLength);
+   }
+
+   if(curr != NULL && Node_getStatus(curr) == FALSE) {
+      if(!FT_reservePath(&traversal.path, dirLength))
+         result = MEMORY_ERROR;
+      else
+         memcpy(traversal.path.string, prefix, dirLength);
+      /* The children that start with last are together among the
+         files, and again among the directories */
+      for(status = TRUE; result == SUCCESS; status = FALSE) {
+         (void) Node_hasChild(curr, last, lastLength, status, &i);
+         for(; i < Node_getNumChildren(curr); i++) {
+            child = Node_getChild(curr, i);
+            if(Node_getStatus(child) != status ||
+               Node_getNameLength(child) < lastLength ||
+               strncmp(Node_getName(child), last, lastLength) != 0)
+               break;
+            if(!FT_walk(child, dirLength, FT_visitPath, &traversal)) {
+               result = MEMORY_ERROR;
+               break;
+            }
+         }
+         if(status == FALSE)
+            break;
+      }
+   }
+   FT_unlock(ft);
+   free(traversal.path.string);
+   FT_STATS_STOP(FT_OP_LIST_PREFIX);
+   return result;
+}
+
+/*
+  Writes the string representation of ft, as returned
+  by FT_toStringIn, to stream, without building the whole string.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise; use ferror on stream to detect write errors.
+*/
+
+int FT_writeToIn(FT_T ft, FILE *stream){
+   int result = SUCCESS;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(stream != NULL);
+
+   FT_lock(ft);
+   if(!FT_traverse(ft, FT_writeAccumulate, stream))
+      result = MEMORY_ERROR;
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_WRITE_TO);
+   return result;
+}
+
+/*
+   A directory a bulk load is still filling: its node, the child most
+   recently created in it, and where its finished subdirectories
+   start in the bulk load's list of them.
+*/
+struct ftOpenDir {
+   Node_T node;
+   Node_T last;
+   size_t firstDone;
+};
+
+/*
+   The state of a bulk load into ft: the stack of open directories,
+   from the root down to the directory of the last record, and the
+   finished directories waiting to be appended to their parents,
+   after the parents' files, when the parents are finished in turn.
+   Neither stack's nodes are linked to their parents yet, so no
+   reader can reach them and each can be destroyed on its own.
+*/
+struct ftLoad {
+   FT_T ft;
+   struct ftOpenDir* open;
+   size_t depth;
+   size_t openSize;
+   Node_T* done;
+   size_t doneCount;
+   size_t doneSize;
+   Node_T root;
+   size_t count;
+};
+
+/*
+   Returns array, which holds *pSize elements of elementSize bytes,
+   reallocated with room for twice as many, or for MIN_FRAMES if it
+   is empty, updating *pSize, or NULL if there is an allocation error,
+   in which case array is unchanged.
+*/
+static void* FT_growArray(void* array, size_t* pSize,
+                          size_t elementSize) {
+   size_t size;
+
+   assert(pSize != NULL);
+
+   size = *pSize == 0 ? MIN_FRAMES : 2 * *pSize;
+   array = realloc(array, size * elementSize);
+   if(array != NULL)
+      *pSize = size;
+   return array;
+}
+
+/*
+   Returns <0, 0 or >0 as the current component of pCursor comes
+   before, is the same as, or comes after n's name, in the order of
+   strcmp.
+*/
+static int FT_compareName(const struct ftCursor* pCursor, Node_T n) {
+   size_t length;
+   int result;
+
+   assert(pCursor != NULL);
+   assert(n != NULL);
+
+   length = Node_getNameLength(n);
+   result = memcmp(pCursor->name, Node_getName(n),
+                   pCursor->length < length ? pCursor->length : length);
+   if(result != 0)
+      return result;
+   if(pCursor->length == length)
+      return 0;
+   return pCursor->length < length ? -1 : 1;
+}
+
+/*
+   Makes dir, just created, the innermost open directory of pLoad.
+   Returns SUCCESS, or MEMORY_ERROR if the stack cannot grow, in
+   which case dir is left to the caller.
+*/
+static int FT_loadOpen(struct ftLoad* pLoad, Node_T dir) {
+   struct ftOpenDir* open;
+
+   assert(pLoad != NULL);
+   assert(dir != NULL);
+
+   if(pLoad->depth == pLoad->openSize) {
+      open = FT_growArray(pLoad->open, &pLoad->openSize,
+                          sizeof(struct ftOpenDir));
+      if(open == NULL)
+         return MEMORY_ERROR;
+      pLoad->open = open;
+   }
+   pLoad->open[pLoad->depth].node = dir;
+   pLoad->open[pLoad->depth].last = NULL;
+   pLoad->open[pLoad->depth].firstDone = pLoad->doneCount;
+   pLoad->depth++;
+   return SUCCESS;
+}
+
+/*
+   Finishes the innermost open directory of pLoad: appends its
+   finished subdirectories to it, after its files, and then passes it
+   to its parent's list of finished subdirectories, or, if it is the
+   root, makes it pLoad's root.
+   Returns SUCCESS, or MEMORY_ERROR if an array cannot grow, in which
+   case every node is still on one of pLoad's stacks.
+*/
+static int FT_loadClose(struct ftLoad* pLoad) {
+   struct ftOpenDir* top;
+   Node_T* done;
+   size_t i;
+
+   assert(pLoad != NULL);
+   assert(pLoad->depth > 0);
+
+   top = &pLoad->open[pLoad->depth - 1];
+   for(i = top->firstDone; i < pLoad->doneCount; i++) {
+      if(Node_appendChild(top->node, pLoad->done[i],
+                          pLoad->ft->pool) != SUCCESS) {
+         /* Keeps on the list only those not appended */
+         memmove(pLoad->done + top->firstDone, pLoad->done + i,
+                 (pLoad->doneCount - i) * sizeof(Node_T));
+         pLoad->doneCount -= i - top->firstDone;
+         return MEMORY_ERROR;
+      }
+      Node_addTotals(top->node, pLoad->done[i]);
+   }
+   pLoad->doneCount = top->firstDone;
+
+   if(pLoad->depth == 1)
+      pLoad->root = top->node;
+   else {
+      if(pLoad->doneCount == pLoad->doneSize) {
+         done = FT_growArray(pLoad->done, &pLoad->doneSize,
+                             sizeof(Node_T));
+         if(done == NULL)
+            return MEMORY_ERROR;
+         pLoad->done = done;
+      }
+      pLoad->done[pLoad->doneCount++] = top->node;
+   }
+   pLoad->depth--;
+   return SUCCESS;
+}
+
+/*
+   Adds the nodes for the record at pRecord to pLoad. The components
+   the record shares with the previous one name directories that are
+   still open; those the previous record went on to are finished, and
+   the rest of the record's components are created, a file for the
+   last if the record is a file, and a directory otherwise.
+   Returns SUCCESS or the error FT_bulkLoadIn reports for the record.
+*/
+static int FT_loadRecord(struct ftLoad* pLoad,
+                         const struct ftRecord* pRecord) {
+   struct ftCursor cursor;
+   struct ftOpenDir* parent;
+   Node_T new;
+   size_t matched = 0;
+   int compare;
+   int result;
+
+   assert(pLoad != NULL);
+   assert(pRecord != NULL);
+   assert(pRecord->path != NULL);
+
+   (void) FT_firstComponent(&cursor, pRecord->path);
+   while(matched < pLoad->depth && cursor.step == FT_COMPONENT &&
+         FT_compareName(&cursor, pLoad->open[matched].node) == 0) {
+      matched++;
+      (void) FT_nextComponent(&cursor);
+   }
+   if(cursor.step == FT_MALFORMED)
+      return CONFLICTING_PATH;
+   if(cursor.step == FT_END)
+      return ALREADY_IN_TREE;
+   /* Only the first record may create the root */
+   if(matched == 0 && (pLoad->depth > 0 || pLoad->count > 0))
+      return CONFLICTING_PATH;
+   while(pLoad->depth > matched)
+      if(FT_loadClose(pLoad) != SUCCESS)
+         return MEMORY_ERROR;
+
+   do {
+      if(pLoad->depth == 0) {
+         /* File cannot be root */
+         if(pRecord->isFile && FT_isLastComponent(&cursor))
+            return CONFLICTING_PATH;
+         new = Node_create(cursor.name, cursor.length, NULL,
+                           pLoad->ft->pool);
+         parent = NULL;
+      }
+      else {
+         parent = &pLoad->open[pLoad->depth - 1];
+         if(parent->last != NULL) {
+            compare = FT_compareName(&cursor, parent->last);
+            if(compare < 0)
+               return CONFLICTING_PATH;
+            /* Only a file can be the same as a child that is not
+               open */
+            if(compare == 0)
+               return FT_isLastComponent(&cursor) ? ALREADY_IN_TREE
+                                                  : NOT_A_DIRECTORY;
+         }
+         if(pRecord->isFile && FT_isLastComponent(&cursor))
+            new = Node_addFile(cursor.name, cursor.length, parent->node,
+                               pRecord->contents, pRecord->length,
+                               pLoad->ft->pool);
+         else
+            new = Node_create(cursor.name, cursor.length, parent->node,
+                              pLoad->ft->pool);
+      }
+      if(new == NULL)
+         return MEMORY_ERROR;
+
+      /* Records the new child before FT_loadOpen can move the
+         stack; after an error the load is abandoned anyway */
+      if(parent != NULL)
+         parent->last = new;
+      /* Files go straight into their directory, since they come
+         before all its subdirectories */
+      if(Node_getStatus(new) == TRUE)
+         result = Node_appendChild(parent->node, new, pLoad->ft->pool);
+      else
+         result = FT_loadOpen(pLoad, new);
+      if(result != SUCCESS) {
+         (void) Node_destroy(new, pLoad->ft->pool);
+         return result;
+      }
+      if(Node_getStatus(new) == TRUE)
+         Node_addTotals(parent->node, new);
+      pLoad->count++;
+   } while(FT_nextComponent(&cursor) == FT_COMPONENT);
+
+   if(cursor.step == FT_MALFORMED)
+      return CONFLICTING_PATH;
+   return SUCCESS;
+}
+
+/*
+  Builds the hierarchy of ft, which must be empty, from the records
+  filled in by successive calls to (*pfNext)(&record, pvStream), up to
+  the first call that returns FALSE, as FT_bulkLoad does, appending
+  each node to its parent directly, with no search from the root.
+  Returns CONFLICTING_PATH, NOT_A_DIRECTORY, ALREADY_IN_TREE or
+  MEMORY_ERROR, as FT_bulkLoad does, leaving ft empty, and
+  SUCCESS otherwise.
+*/
+
+int FT_bulkLoadIn(FT_T ft,
+                  boolean (*pfNext)(struct ftRecord *pRecord,
+                                    void *pvStream),
+                  void *pvStream){
+   struct ftLoad load;
+   struct ftRecord record;
+   int result = SUCCESS;
+   size_t i;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(pfNext != NULL);
+
+   if(ft->source != NULL) {
+      FT_STATS_STOP(FT_OP_BULK_LOAD);
+      return READ_ONLY;
+   }
+   FT_lock(ft);
+   if(ft->root != NULL) {
+      FT_unlock(ft);
+      FT_STATS_STOP(FT_OP_BULK_LOAD);
+      return CONFLICTING_PATH;
+   }
+
+   load.ft = ft;
+   load.open = NULL;
+   load.depth = 0;
+   load.openSize = 0;
+   load.done = NULL;
+   load.doneCount = 0;
+   load.doneSize = 0;
+   load.root = NULL;
+   load.count = 0;
+   while(result == SUCCESS && (*pfNext)(&record, pvStream))
+      result = FT_loadRecord(&load, &record);
+   while(result == SUCCESS && load.depth > 0)
+      result = FT_loadClose(&load);
+
+   if(result != SUCCESS) {
+      /* Each node left on the stacks heads a hierarchy of its own */
+      for(i = 0; i < load.depth; i++)
+         (void) Node_destroy(load.open[i].node, ft->pool);
+      for(i = 0; i < load.doneCount; i++)
+         (void) Node_destroy(load.done[i], ft->pool);
+   }
+   else if(load.root != NULL) {
+      __atomic_store_n(&ft->root, load.root, __ATOMIC_RELEASE);
+      ft->count = load.count;
+      if(ft->index != NULL &&
+         !FT_walk(ft->root, PathIndex_hashStart(), FT_visitIndex,
+                  ft->index))
+         FT_dropIndex(ft);
+      /* The records are not journaled one by one */
+      if(ft->journal != NULL)
+         result = FT_compact(ft);
+   }
+   free(load.open);
+   free(load.done);
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_BULK_LOAD);
+   return result;
+}
+
+/*
+   A snapshot is a struct ftSnapHeader, then a struct ftSnapNode for
+   each node in pre-order, then the names table, holding each node's
+   name followed by a '\0', and then the contents blob, holding the
+   contents of the files back to back. Every field is written in the
+   byte order of the machine that saved the snapshot.
+*/
+
+/* The first bytes of every snapshot: the format's name and version */
+static const char snapMagic[8] = "FTSNAP01";
+
+/* Written as a uint32_t, reads back as the same value only on a
+   machine with the same byte order */
+#define SNAP_BYTE_ORDER 0x01020304UL
+
+/* The contentsOffset of a file whose contents are NULL */
+#define SNAP_NO_CONTENTS UINT64_MAX
+
+/* The number of node records read from a snapshot at a time */
+enum { SNAP_BATCH = 4096 };
+
+struct ftSnapHeader {
+   char magic[8];
+   uint32_t byteOrder;
+   /* sizeof(struct ftSnapNode) where the snapshot was saved */
+   uint32_t nodeSize;
+   uint64_t nodeCount;
+   uint64_t namesSize;
+   uint64_t contentsSize;
+};
+
+/*
+   The record of a node: where its name starts in the names table and
+   how long it is, and for a file, where its contents start in the
+   contents blob and their length; for a directory, the number of its
+   children, whose subtrees follow its record in order.
+*/
+struct ftSnapNode {
+   uint64_t nameOffset;
+   uint64_t contentsOffset;
+   uint64_t length;
+   uint32_t nameLength;
+   uint32_t isFile;
+   uint64_t numChildren;
+};
+
+/*
+   Which of the passes of FT_saveIn a walk makes: one to size the
+   sections, then one to write each of them.
+*/
+enum ftSnapPass { SNAP_SIZE, SNAP_NODES, SNAP_NAMES, SNAP_CONTENTS };
+
+/*
+   The state of FT_saveIn: the pass being made, the stream written to,
+   and the sizes of the sections, or, while the nodes are written, the
+   offsets reached in the names table and the contents blob.
+   ok is FALSE once a write has failed.
+*/
+struct ftSave {
+   enum ftSnapPass pass;
+   FILE* stream;
+   uint64_t nodeCount;
+   uint64_t namesSize;
+   uint64_t contentsSize;
+   boolean ok;
+};
+
+/*
+   Visits n for a pass of FT_saveIn, whose struct ftSave is at
+   pvSave, sizing or writing its part of the pass's section.
+   Returns FALSE if a write fails, TRUE otherwise.
+*/
+static boolean FT_visitSave(Node_T n, unsigned long parentState,
+                            unsigned long* pState, void* pvSave) {
+   struct ftSave* pSave = pvSave;
+   struct ftSnapNode record;
+   boolean isFile;
+   void* contents;
+
+   (void) parentState;
+   (void) pState;
+   assert(n != NULL);
+   assert(pSave != NULL);
+
+   isFile = Node_getStatus(n);
+   contents = isFile ? Node_getFileContents(n) : NULL;
+   switch(pSave->pass) {
+      case SNAP_NODES:
+         record.nameOffset = pSave->namesSize;
+         record.contentsOffset = contents == NULL ? SNAP_NO_CONTENTS
+                                                  : pSave->contentsSize;
+         record.length = isFile ? Node_getFileLength(n) : 0;
+         record.nameLength = (uint32_t) Node_getNameLength(n);
+         record.isFile = isFile;
+         record.numChildren = Node_getNumChildren(n);
+         pSave->ok = (boolean) (fwrite(&record, sizeof(record), 1,
+                                       pSave->stream) == 1);
+         break;
+      case SNAP_NAMES:
+         pSave->ok = (boolean) (fwrite(Node_getName(n), 1,
+                                       Node_getNameLength(n) + 1,
+                                       pSave->stream)
+                                == Node_getNameLength(n) + 1);
+         break;
+      case SNAP_CONTENTS:
+         if(contents != NULL)
+            pSave->ok = (boolean) (fwrite(contents, 1,
+                                          Node_getFileLength(n),
+                                          pSave->stream)
+                                   == Node_getFileLength(n));
+         break;
+      default:
+         break;
+   }
+   pSave->nodeCount++;
+   pSave->namesSize += Node_getNameLength(n) + 1;
+   if(contents != NULL)
+      pSave->contentsSize += Node_getFileLength(n);
+   return pSave->ok;
+}
+
+/*
+   Writes a snapshot of ft to the file named path, as FT_saveIn does,
+   with ft's lock already held.
+*/
+static int FT_saveTo(FT_T ft, const char* path) {
+   struct ftSave save;
+   struct ftSnapHeader header;
+   FILE* stream;
+   int result = SUCCESS;
+
+   assert(ft != NULL);
+   assert(path != NULL);
+
+   stream = fopen(path, "wb");
+   if(stream == NULL)
+      return IO_ERROR;
+
+   save.stream = stream;
+   save.ok = TRUE;
+   for(save.pass = SNAP_SIZE; save.pass <= SNAP_CONTENTS; save.pass++) {
+      if(save.pass == SNAP_NODES) {
+         memcpy(header.magic, snapMagic, sizeof(header.magic));
+         header.byteOrder = (uint32_t) SNAP_BYTE_ORDER;
+         header.nodeSize = (uint32_t) sizeof(struct ftSnapNode);
+         header.nodeCount = save.nodeCount;
+         header.namesSize = save.namesSize;
+         header.contentsSize = save.contentsSize;
+         if(fwrite(&header, sizeof(header), 1, stream) != 1) {
+            save.ok = FALSE;
+            break;
+         }
+      }
+      save.nodeCount = 0;
+      save.namesSize = 0;
+      save.contentsSize = 0;
+      if(!FT_walk(ft->root, 0, FT_visitSave, &save))
+         break;
+   }
+
+   if(!save.ok)
+      result = IO_ERROR;
+   else if(save.pass <= SNAP_CONTENTS)
+      result = MEMORY_ERROR;
+   if(fclose(stream) != 0 && result == SUCCESS)
+      result = IO_ERROR;
+   return result;
+}
+
+/*
+  Writes a snapshot of ft, including the types and contents of its
+  files, to the file named path, as FT_save does.
+  Returns IO_ERROR if the file cannot be written, MEMORY_ERROR if
+  unable to allocate sufficient memory, and SUCCESS otherwise.
+*/
+
+int FT_saveIn(FT_T ft, char *path){
+   int result;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(path != NULL);
+
+   FT_lock(ft);
+   result = FT_saveTo(ft, path);
+   FT_unlock(ft);
+   FT_STATS_STOP(FT_OP_SAVE);
+   return result;
+}
+
+/*
+   A directory FT_loadIn is still filling: its node, the child most
+   recently appended to it, and how many children it has yet to get.
+*/
+struct ftSnapDir {
+   Node_T node;
+   Node_T last;
+   uint64_t remaining;
+};
+
+/*
+   The state of FT_loadIn: the names table and contents blob read
+   from the snapshot, and their sizes, the stack of directories still
+   being filled, the root, once read, and the number of nodes built.
+*/
+struct ftLoadSnap {
+   FT_T ft;
+   char* names;
+   uint64_t namesSize;
+   char* contents;
+   uint64_t contentsSize;
+   struct ftSnapDir* dirs;
+   size_t depth;
+   size_t dirsSize;
+   Node_T root;
+   size_t count;
+};
+
+/*
+   Reads size bytes from stream into pv.
+   Returns TRUE if all of them could be read, FALSE otherwise.
+*/
+static boolean FT_readAll(FILE* stream, void* pv, size_t size) {
+   assert(stream != NULL);
+   return (boolean) (size == 0 || fread(pv, 1, size, stream) == size);
+}
+
+/*
+   Builds the node the snapshot record at pRecord describes, appending
+   it to the innermost directory pLoad is filling, or making it the
+   root if pLoad has none yet. Checks the record against the snapshot
+   and against its siblings, so that a damaged snapshot cannot build
+   a broken tree.
+   Returns SUCCESS, IO_ERROR if the record is not valid, or
+   MEMORY_ERROR if unable to allocate sufficient memory.
+*/
+static int FT_loadSnapNode(struct ftLoadSnap* pLoad,
+                           const struct ftSnapNode* pRecord) {
+   struct ftSnapDir* parent = NULL;
+   struct ftSnapDir* dirs;
+   struct ftCursor name;
+   char* contents = NULL;
+   boolean lastIsFile;
+   Node_T new;
+
+   assert(pLoad != NULL);
+   assert(pRecord != NULL);
+
+   /* The name must be one non-empty path component in the table */
+   if(pRecord->nameLength == 0 ||
+      pRecord->nameOffset >= pLoad->namesSize ||
+      pRecord->nameLength >= pLoad->namesSize - pRecord->nameOffset)
+      return IO_ERROR;
+   name.name = pLoad->names + pRecord->nameOffset;
+   name.length = pRecord->nameLength;
+   name.step = FT_COMPONENT;
+   if(name.name[name.length] != '\0' ||
+      memchr(name.name, '\0', name.length) != NULL ||
+      memchr(name.name, '/', name.length) != NULL)
+      return IO_ERROR;
+   if(pRecord->isFile > 1 || (pRecord->isFile && pRecord->numChildren))
+      return IO_ERROR;
+   if(pRecord->contentsOffset != SNAP_NO_CONTENTS) {
+      if(!pRecord->isFile ||
+         pRecord->contentsOffset > pLoad->contentsSize ||
+         pRecord->length > pLoad->contentsSize - pRecord->contentsOffset)
+         return IO_ERROR;
+      contents = pLoad->contents + pRecord->contentsOffset;
+   }
+
+   if(pLoad->depth == 0) {
+      /* Only the first record may be the root, and not a file */
+      if(pLoad->root != NULL || pRecord->isFile)
+         return IO_ERROR;
+      new = Node_create(name.name, name.length, NULL, pLoad->ft->pool);
+      if(new == NULL)
+         return MEMORY_ERROR;
+      pLoad->root = new;
+   }
+   else {
+      parent = &pLoad->dirs[pLoad->depth - 1];
+      /* Files come before directories, and then names in order */
+      if(parent->last != NULL) {
+         lastIsFile = Node_getStatus(parent->last);
+         if(pRecord->isFile && !lastIsFile)
+            return IO_ERROR;
+         if((boolean) pRecord->isFile == lastIsFile &&
+            FT_compareName(&name, parent->last) <= 0)
+            return IO_ERROR;
+      }
+      if(pRecord->isFile)
+         new = Node_addFile(name.name, name.length, parent->node,
+                            contents, (size_t) pRecord->length,
+                            pLoad->ft->pool);
+      else
+         new = Node_create(name.name, name.length, parent->node,
+                           pLoad->ft->pool);
+      if(new == NULL)
+         return MEMORY_ERROR;
+      if(Node_appendChild(parent->node, new, pLoad->ft->pool)
+         != SUCCESS) {
+         (void) Node_destroy(new, pLoad->ft->pool);
+         return MEMORY_ERROR;
+      }
+      /* A directory with children is totalled once it has them all */
+      if(pRecord->numChildren == 0)
+         Node_addTotals(parent->node, new);
+      parent->last = new;
+      parent->remaining--;
+   }
+   pLoad->count++;
+
+   if(pRecord->numChildren > 0) {
+      if(pLoad->depth == pLoad->dirsSize) {
+         dirs = FT_growArray(pLoad->dirs, &pLoad->dirsSize,
+                             sizeof(struct ftSnapDir));
+         if(dirs == NULL)
+            return MEMORY_ERROR;
+         pLoad->dirs = dirs;
+      }
+      pLoad->dirs[pLoad->depth].node = new;
+      pLoad->dirs[pLoad->depth].last = NULL;
+      pLoad->dirs[pLoad->depth].remaining = pRecord->numChildren;
+      pLoad->depth++;
+   }
+   /* Finishes every directory that has all its children now */
+   while(pLoad->depth > 0 &&
+         pLoad->dirs[pLoad->depth - 1].remaining == 0) {
+      pLoad->depth--;
+      if(pLoad->depth > 0)
+         Node_addTotals(pLoad->dirs[pLoad->depth - 1].node,
+                        pLoad->dirs[pLoad->depth].node);
+   }
+   return SUCCESS;
+}
+
+/*
+   Rebuilds in ft, which must be empty, the tree saved by FT_saveIn to
+   the file named path, as FT_loadIn does, and stores in *pContents
+   and *pContentsSize the block of ft's pool that holds the contents
+   of every file it rebuilt, or NULL and 0 if there is none.
+   Returns as FT_loadIn does.
+*/
+static int FT_loadFrom(FT_T ft, const char* path, char** pContents,
+                       size_t* pContentsSize) {
+   struct ftSnapHeader header;
+   struct ftSnapNode* records;
+   struct ftLoadSnap load;
+   FILE* stream;
+   uint64_t read;
+   size_t batch;
+   size_t i;
+   int result = SUCCESS;
+
+   assert(ft != NULL);
+   assert(path != NULL);
+   assert(pContents != NULL);
+   assert(pContentsSize != NULL);
+
+   *pContents = NULL;
+   *pContentsSize = 0;
+   if(ft->source != NULL)
+      return READ_ONLY;
+   stream = fopen(path, "rb");
+   if(stream == NULL)
+      return IO_ERROR;
+   if(!FT_readAll(stream, &header, sizeof(header)) ||
+      memcmp(header.magic, snapMagic, sizeof(header.magic)) != 0 ||
+      header.byteOrder != (uint32_t) SNAP_BYTE_ORDER ||
+      header.nodeSize != sizeof(struct ftSnapNode) ||
+      header.namesSize > SIZE_MAX || header.contentsSize > SIZE_MAX ||
+      header.nodeCount > (uint64_t) LONG_MAX / sizeof(struct ftSnapNode)) {
+      (void) fclose(stream);
+      return IO_ERROR;
+   }
+   records = malloc(SNAP_BATCH * sizeof(struct ftSnapNode));
+   if(records == NULL) {
+      (void) fclose(stream);
+      return MEMORY_ERROR;
+   }
+
+   FT_lock(ft);
+   load.ft = ft;
+   load.names = NULL;
+   load.namesSize = header.namesSize;
+   load.contents = NULL;
+   load.contentsSize = header.contentsSize;
+   load.dirs = NULL;
+   load.depth = 0;
+   load.dirsSize = 0;
+   load.root = NULL;
+   load.count = 0;
+   if(ft->root != NULL)
+      result = CONFLICTING_PATH;
+
+   /* Reads the names and the contents, which follow the records */
+   if(result == SUCCESS && header.nodeCount > 0) {
+      load.names = malloc((size_t) header.namesSize);
+      if(header.contentsSize > 0)
+         load.contents = Pool_alloc(ft->pool,
+                                    (size_t) header.contentsSize);
+      if(load.names == NULL ||
+         (header.contentsSize > 0 && load.contents == NULL))
+         result = MEMORY_ERROR;
+      else if(fseek(stream, (long) (sizeof(header) + header.nodeCount *
+                                    sizeof(struct ftSnapNode)),
+                    SEEK_SET) != 0 ||
+              !FT_readAll(stream, load.names, (size_t) header.namesSize) ||
+              !FT_readAll(stream, load.contents,
+                          (size_t) header.contentsSize) ||
+              fseek(stream, (long) sizeof(header), SEEK_SET) != 0)
+         result = IO_ERROR;
+   }
+
+   /* Builds the tree from the records, a batch at a time */
+   for(read = 0; result == SUCCESS && read < header.nodeCount;
+       read += batch) {
+      batch = SNAP_BATCH;
+      if(header.nodeCount - read < batch)
+         batch = (size_t) (header.nodeCount - read);
+      if(!FT_readAll(stream, records, batch * sizeof(struct ftSnapNode)))
+         result = IO_ERROR;
+      for(i = 0; result == SUCCESS && i < batch; i++) {
+         /* Records past the end of the root's subtree are an error */
+         if(load.root != NULL && load.depth == 0)
+            result = IO_ERROR;
+         else
+            result = FT_loadSnapNode(&load, &records[i]);
+      }
+   }
+   if(result == SUCCESS && load.depth > 0)
+      result = IO_ERROR;
+
+   if(result == SUCCESS && load.root != NULL) {
+      __atomic_store_n(&ft->root, load.root, __ATOMIC_RELEASE);
+      ft->count = load.count;
+      *pContents = load.contents;
+      *pContentsSize = (size_t) header.contentsSize;
+      if(ft->index != NULL &&
+         !FT_walk(ft->root, PathIndex_hashStart(), FT_visitIndex,
+                  ft->index))
+         FT_dropIndex(ft);
+      if(ft->journal != NULL)
+         result = FT_compact(ft);
+   }
+   else if(result != SUCCESS) {
+      /* Every node built is linked under the root */
+      if(load.root != NULL)
+         (void) Node_destroy(load.root, ft->pool);
+      if(load.contents != NULL)
+         Pool_release(ft->pool, load.contents,
+                      (size_t) header.contentsSize);
+   }
+   FT_unlock(ft);
+
+   free(load.names);
+   free(load.dirs);
+   free(records);
+   (void) fclose(stream);
+   return result;
+}
+
+/*
+  Rebuilds in ft, which must be empty, the tree saved by FT_saveIn to
+  the file named path, as FT_load does.
+  Returns CONFLICTING_PATH if ft is not empty, IO_ERROR if the file
+  cannot be read or is not a valid snapshot, MEMORY_ERROR if unable
+  to allocate sufficient memory, leaving ft empty, and SUCCESS
+  otherwise.
+*/
+
+int FT_loadIn(FT_T ft, char *path){
+   char* contents;
+   size_t contentsSize;
+   int result;
+   FT_STATS_START;
+
+   result = FT_loadFrom(ft, path, &contents, &contentsSize);
+   FT_STATS_STOP(FT_OP_LOAD);
+   return result;
+}
+
+/*
+  Writes an image of ft, which FTImage_open can map, to the file
+  named path, as FT_saveImage does. Unlike a snapshot, an image
+  places the children of each directory next to each other, sorted,
+  so that a lookup can binary search them in place.
+  Returns IO_ERROR if the file cannot be written, MEMORY_ERROR if
+  unable to allocate sufficient memory, and SUCCESS otherwise.
+*/
+
+int FT_saveImageIn(FT_T ft, char *path){
+   struct FTImageHeader header;
+   struct FTImageNode record;
+   Node_T* nodes = NULL;
+   FILE* stream;
+   size_t count = 0;
+   size_t i;
+   size_t j;
+   uint64_t first = 1;
+   uint64_t namesSize = 0;
+   uint64_t contentsSize = 0;
+   boolean ok = TRUE;
+   int result = SUCCESS;
+   FT_STATS_START;
+
+   assert(ft != NULL);
+   assert(path != NULL);
+
+   stream = fopen(path, "wb");
+   if(stream == NULL) {
+      FT_STATS_STOP(FT_OP_SAVE_IMAGE);
+      return IO_ERROR;
+   }
+
+   FT_lock(ft);
+   if(ft->root != NULL) {
+      nodes = malloc(ft->count * sizeof(Node_T));
+      if(nodes == NULL)
+         result = MEMORY_ERROR;
+   }
+
+   /* Lists the nodes breadth first, so that the children of each
+      directory follow one another, sizing the regions on the way */
+   if(nodes != NULL) {
+      nodes[count++] = ft->root;
+      for(i = 0; i < count; i++) {
+         for(j = 0; j < Node_getNumChildren(nodes[i]); j++) {
+            assert(count < ft->count);
+            nodes[count++] = Node_getChild(nodes[i], j);
+         }
+         namesSize += Node_getNameLength(nodes[i]) + 1;
+         if(Node_getStatus(nodes[i]) &&
+            Node_getFileContents(nodes[i]) != NULL)
+            contentsSize += Node_getFileLength(nodes[i]);
+      }
+   }
+
+   if(result == SUCCESS) {
+      memcpy(header.acMagic, FTIMAGE_MAGIC, sizeof(header.acMagic));
+      header.ulByteOrder = (uint32_t) FTIMAGE_BYTE_ORDER;
+      header.ulNodeSize = (uint32_t) sizeof(struct FTImageNode);
+      header.ulNodeCount = count;
+      header.ulNamesSize = namesSize;
+      header.ulContentsSize = contentsSize;
+      ok = (boolean) (fwrite(&header, sizeof(header), 1, stream) == 1);
+   }
+
+   namesSize = 0;
+   contentsSize = 0;
+   for(i = 0; result == SUCCESS && ok && i < count; i++) {
+      record.ulNameOffset = namesSize;
+      record.ulNameLength = (uint32_t) Node_getNameLength(nodes[i]);
+      record.ulIsFile = Node_getStatus(nodes[i]);
+      if(record.ulIsFile) {
+         record.ulFirst = FTIMAGE_NO_CONTENTS;
+         if(Node_getFileContents(nodes[i]) != NULL) {
+            record.ulFirst = contentsSize;
+            contentsSize += Node_getFileLength(nodes[i]);
+         }
+         record.ulCount = Node_getFileLength(nodes[i]);
+         record.ulFiles = 0;
+      }
+      else {
+         record.ulFirst = first;
+         record.ulCount = Node_getNumChildren(nodes[i]);
+         record.ulFiles = 0;
+         for(j = 0; j < record.ulCount; j++)
+            if(Node_getStatus(nodes[first + j]))
+               record.ulFiles++;
+         first += record.ulCount;
+      }
+      namesSize += record.ulNameLength + 1;
+      ok = (boolean) (fwrite(&record, sizeof(record), 1, stream) == 1);
+   }
+   for(i = 0; result == SUCCESS && ok && i < count; i++)
+      ok = (boolean) (fwrite(Node_getName(nodes[i]), 1,
+                             Node_getNameLength(nodes[i]) + 1, stream)
+                      == Node_getNameLength(nodes[i]) + 1);
+   for(i = 0; result == SUCCESS && ok && i < count; i++)
+      if(Node_getStatus(nodes[i]) &&
+         Node_getFileContents(nodes[i]) != NULL)
+         ok = (boolean) (fwrite(Node_getFileContents(nodes[i]), 1,
+                                Node_getFileLength(nodes[i]), stream)
+                         == Node_getFileLength(nodes[i]));
+   FT_unlock(ft);
+
+   free(nodes);
+   if(!ok)
+      result = IO_ERROR;
+   if(fclose(stream) != 0 && result == SUCCESS)
+      result = IO_ERROR;
+   FT_STATS_STOP(FT_OP_SAVE_IMAGE);
+   return result;
+}
+
+/*
+   A journaled tree is kept in three files: the journal, at the path
+   given to FT_openJournalIn, and two snapshot slots next to it, named
+   by appending ".snap0" and ".snap1". A journal of generation g > 0
+   holds the changes made since the snapshot in slot g % 2; one of
+   generation 0 holds every change since the tree was empty.
+   Compacting writes the next generation's snapshot into the other
+   slot, and only then replaces the journal, so a crash at any point
+   leaves a journal and the snapshot it applies to.
+
+   Each change is appended to the journal before it is made, and the
+   record that completes a group of groupSize is synced first, so a
+   crash loses at most the changes of the last unsynced group, and a
+   change whose record cannot be written is not made. Once a write
+   fails, the journal takes no more records. A journal is compacted
+   once it has grown as big as its snapshot, and after FT_bulkLoadIn
+   and FT_loadIn, whose nodes are not journaled one by one.
+*/
+
+/* The size below which a journal is never compacted */
+enum { MIN_COMPACT = 1 << 20 };
+
+/*
+   Returns the path of the snapshot slot of generation, for the
+   journal at journalPath, in memory the caller must free, or NULL if
+   there is an allocation error.
+*/
+static char* FT_slotPath(const char* journalPath,
+                         unsigned long generation) {
+   char* path;
+
+   assert(journalPath != NULL);
+
+   path = malloc(strlen(journalPath) + sizeof(".snap0"));
+   if(path != NULL)
+      sprintf(path, "%s.snap%lu", journalPath, generation % 2);
+   return path;
+}
+
+/*
+   Sets the size at which ft's journal is next compacted to that of
+   the snapshot at path, once synced to disk, so that replaying the
+   journal never costs much more than loading the snapshot, but at
+   least MIN_COMPACT.
+   Returns SUCCESS, or IO_ERROR if the snapshot cannot be synced.
+*/
+static int FT_syncSnapshot(FT_T ft, const char* path) {
+   size_t size;
+   int result;
+
+   assert(ft != NULL);
+   assert(path != NULL);
+
+   result = Journal_syncFile(path, &size);
+   if(result == SUCCESS)
+      ft->compactSize = size < MIN_COMPACT ? MIN_COMPACT : size;
+   return result;
+}
+
+/*
+   Compacts ft's journal: saves ft into the next generation's snapshot
+   slot and restarts the journal, empty, in that generation. Called
+   with ft's lock held.
+   Returns SUCCESS, IO_ERROR if the snapshot or the journal cannot be
+   written, or MEMORY_ERROR if unable to allocate sufficient memory.
+*/
+static int FT_compact(FT_T ft) {
+   unsigned long generation;
+   char* path;
+   int result;
+
+   assert(ft != NULL);
+   assert(ft->journal != NULL);
+
+   result = Journal_sync(ft->journal);
+   if(result != SUCCESS)
+      return result;
+   generation = Journal_getGeneration(ft->journal) + 1;
+   path = FT_slotPath(Journal_getPath(ft->journal), generation);
+   if(path == NULL)
+      return MEMORY_ERROR;
+   result = FT_saveTo(ft, path);
+   if(result == SUCCESS)
+      result = FT_syncSnapshot(ft, path);
+   if(result == SUCCESS)
+      result = Journal_restart(ft->journal, generation);
+   free(path);
+   return result;
+}
+
+/*
+   The state of the replay of a journal into a tree: the tree, whether
+   it held nodes before the journal's snapshot was loaded, and the
+   block holding the contents loaded from that snapshot, which, unlike
+   the copies the replay makes, are not released one file at a time.
+*/
+struct ftReplay {
+   FT_T ft;
+   boolean wasEmpty;
+   const char* loaded;
+   size_t loadedSize;
+};
+
+/* The contents of each file replayed with a non-NULL empty contents,
+   which needs no block of its own */
+static char ftReplayEmpty;
+
+/*
+   Redoes on the tree of the struct ftReplay at pvReplay the change
+   op to path that a journal recorded, with a copy of the length bytes
+   at contents, allocated from the tree's pool, if contents is not
+   NULL, and releases the copy that a replace makes obsolete. Every
+   journaled change succeeded when it was made, and so must again.
+   Returns SUCCESS, CONFLICTING_PATH if the tree was not empty,
+   IO_ERROR if the change fails, or MEMORY_ERROR if unable to
+   allocate sufficient memory.
+*/
+static int FT_replayRecord(enum JournalOp op, const char* path,
+                           const void* contents, size_t length,
+                           void* pvReplay) {
+   struct ftReplay* pReplay = pvReplay;
+   FT_T ft;
+   void* copy = NULL;
+   char* old;
+   boolean isFile;
+   size_t oldLength = 0;
+   int result;
+
+   assert(path != NULL);
+   assert(pReplay != NULL);
+
+   ft = pReplay->ft;
+   if(!pReplay->wasEmpty)
+      return CONFLICTING_PATH;
+   if(op == JOURNAL_RENAME) {
+      /* The contents are the new path, with its '\0' */
+      if(contents == NULL || length == 0 ||
+         memchr(contents, '\0', length) !=
+         (const char*) contents + length - 1)
+         return IO_ERROR;
+      result = FT_renameIn(ft, (char*) path, (char*) contents);
+      return (result == SUCCESS || result == MEMORY_ERROR) ? result
+                                                           : IO_ERROR;
+   }
+   if(contents != NULL && length == 0)
+      copy = &ftReplayEmpty;
+   else if(contents != NULL) {
+      copy = Pool_alloc(ft->pool, length);
+      if(copy == NULL)
+         return MEMORY_ERROR;
+      memcpy(copy, contents, length);
+   }
+   switch(op) {
+      case JOURNAL_INSERT_DIR:
+         result = FT_insertDirIn(ft, (char*) path);
+         break;
+      case JOURNAL_INSERT_FILE:
+         result = FT_insertFileIn(ft, (char*) path, copy, length);
+         break;
+      case JOURNAL_RM_DIR:
+         result = FT_rmDirIn(ft, (char*) path);
+         break;
+      case JOURNAL_RM_FILE:
+         result = FT_rmFileIn(ft, (char*) path);
+         break;
+      default:
+         if(FT_statIn(ft, (char*) path, &isFile, &oldLength) != SUCCESS
+            || !isFile) {
+            result = NO_SUCH_PATH;
+            break;
+         }
+         old = FT_replaceFileContentsIn(ft, (char*) path, copy,
+                                        length);
+         /* Only the contents of an earlier record are the replay's;
+            the addresses are compared as integers, since old need not
+            lie in the loaded block, which a generation 0 lacks */
+         if(oldLength > 0 &&
+            !(pReplay->loadedSize > 0 &&
+              (uintptr_t) old - (uintptr_t) pReplay->loaded
+              < pReplay->loadedSize))
+            Pool_release(ft->pool, old, oldLength);
+         result = SUCCESS;
+         break;
+   }
+   if(result != SUCCESS && copy != &ftReplayEmpty)
+      Pool_release(ft->pool, copy, length);
+   /* The journal does not match its snapshot */
+   if(result != SUCCESS && result != MEMORY_ERROR)
+      result = IO_ERROR;
+   return result;
+}
+
+/*
+  Recovers ft from the journal at path and starts journaling its
+  changes there, as FT_openJournal does.
+  Returns CONFLICTING_PATH, IO_ERROR or MEMORY_ERROR, as
+  FT_openJournal does, and SUCCESS otherwise.
+*/
+
+int FT_openJournalIn(FT_T ft, char *path, size_t groupSize){
+   Journal_T journal;
+   struct ftReplay replay;
+   unsigned long generation;
+   char* slot = NULL;
+   char* loaded = NULL;
+   int result;
+
+   assert(ft != NULL);
+   assert(path != NULL);
+
+   if(ft->source != NULL)
+      return READ_ONLY;
+   if(ft->journal != NULL)
+      return CONFLICTING_PATH;
+   result = Journal_open(path, groupSize, &journal);
+   if(result != SUCCESS)
+      return result;
+
+   /* Loads the snapshot the journal applies to, then redoes it */
+   replay.ft = ft;
+   replay.wasEmpty = (boolean) (ft->root == NULL);
+   replay.loadedSize = 0;
+   ft->compactSize = MIN_COMPACT;
+   generation = Journal_getGeneration(journal);
+   if(generation > 0) {
+      slot = FT_slotPath(path, generation);
+      if(slot == NULL)
+         result = MEMORY_ERROR;
+      if(result == SUCCESS)
+         result = FT_loadFrom(ft, slot, &loaded, &replay.loadedSize);
+      if(result == SUCCESS)
+         result = FT_syncSnapshot(ft, slot);
+      free(slot);
+   }
+   replay.loaded = loaded;
+   if(result == SUCCESS)
+      result = Journal_replay(journal, FT_replayRecord, &replay);
+
+   if(result != SUCCESS) {
+      /* Undoes a partial recovery */
+      if(replay.wasEmpty && ft->root != NULL)
+         (void) FT_rmDirIn(ft, (char*) Node_getName(ft->root));
+      (void) Journal_close(journal);
+      return result;
+   }
+
+   FT_lock(ft);
+   ft->journal = journal;
+   /* A tree the journal does not hold yet starts a new generation */
+   if(!replay.wasEmpty)
+      result = FT_compact(ft);
+   FT_unlock(ft);
+   return result;
+}
+
+/*
+  Writes ft's journaled changes to disk, as FT_syncJournal does.
+  Returns SUCCESS, or the status of a failure, as FT_syncJournal
+  does.
+*/
+
+int FT_syncJournalIn(FT_T ft){
+   int result = SUCCESS;
+
+   assert(ft != NULL);
+
+   FT_lock(ft);
+   if(ft->journal != NULL)
+      result = Journal_sync(ft->journal);
+   FT_unlock(ft);
+   return result;
+}
+
+/*
+  Compacts ft's journal into a snapshot, as FT_compactJournal does.
+  Returns SUCCESS, or the status of a failure, as FT_compactJournal
+  does.
+*/
+
+int FT_compactJournalIn(FT_T ft){
+   int result = SUCCESS;
+
+   assert(ft != NULL);
+
+   FT_lock(ft);
+   if(ft->journal != NULL)
+      result = FT_compact(ft);
+   FT_unlock(ft);
+   return result;
+}
+
+/*
+  Stops journaling ft's changes, as FT_closeJournal does.
+  Returns SUCCESS, or the status of a failure, as FT_closeJournal
+  does.
+*/
+
+int FT_closeJournalIn(FT_T ft){
+   int result = SUCCESS;
+
+   assert(ft != NULL);
+
+   FT_lock(ft);
+   if(ft->journal != NULL) {
+      result = Journal_close(ft->journal);
+      ft->journal = NULL;
+   }
+   FT_unlock(ft);
+   return result;
+}
+
+/*--------------------------------------------------------------------*/
+/* The global API: each function checks that the default tree exists, */
+/* then forwards to the function of the same name for a handle.       */
+/*--------------------------------------------------------------------*/
+
+/* see ft.h for specification */
+FT_T FT_snapshot(void){
+   if(defaultTree == NULL)
+      return NULL;
+   return FT_snapshotIn(defaultTree);
+}
+
+/* see ft.h for specification */
+int FT_insertDir(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_insertDirIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+boolean FT_containsDir(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return FALSE;
+   return FT_containsDirIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+int FT_rmDir(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_rmDirIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+int FT_insertFile(char *path, void *contents, size_t length){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_insertFileIn(defaultTree, path, contents, length);
+}
+
+/* see ft.h for specification */
+boolean FT_containsFile(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return FALSE;
+   return FT_containsFileIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+int FT_rmFile(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_rmFileIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+void *FT_getFileContents(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return NULL;
+   return FT_getFileContentsIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+void *FT_replaceFileContents(char *path, void *newContents,
+                             size_t newLength){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return NULL;
+   return FT_replaceFileContentsIn(defaultTree, path, newContents,
+                                   newLength);
+}
+
+/* see ft.h for specification */
+int FT_rename(char *oldPath, char *newPath){
+   assert(oldPath != NULL);
+   assert(newPath != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_renameIn(defaultTree, oldPath, newPath);
+}
+
+/* see ft.h for specification */
+int FT_stat(char *path, boolean *type, size_t *length){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_statIn(defaultTree, path, type, length);
+}
+
+/* see ft.h for specification */
+int FT_du(char *path, size_t *files, size_t *dirs, size_t *bytes){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_duIn(defaultTree, path, files, dirs, bytes);
+}
+
+/* see ft.h for specification */
+int FT_glob(char *pattern,
+            void (*pfApply)(const char *path, size_t length,
+                            void *pvExtra),
+            void *pvExtra){
+   assert(pattern != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_globIn(defaultTree, pattern, pfApply, pvExtra);
+}
+
+/* see ft.h for specification */
+int FT_listPrefix(char *prefix,
+                  void (*pfApply)(const char *path, size_t length,
+                                  void *pvExtra),
+                  void *pvExtra){
+   assert(prefix != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_listPrefixIn(defaultTree, prefix, pfApply, pvExtra);
+}
+
+/* see ft.h for specification */
+int FT_openDir(char *path, FTDir_T *pDir){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_openDirIn(defaultTree, path, pDir);
+}
+
+/* see ft.h for specification */
+int FT_openTree(char *path, size_t maxDepth, FTDir_T *pDir){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_openTreeIn(defaultTree, path, maxDepth, pDir);
+}
+
+/* see ft.h for specification */
+int FT_init(void){
+   if(defaultTree != NULL)
+      return INITIALIZATION_ERROR;
+   defaultTree = FT_new();
+   if(defaultTree == NULL)
+      return MEMORY_ERROR;
+   return SUCCESS;
+}
+
+/* see ft.h for specification */
+int FT_destroy(void){
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   FT_free(defaultTree);
+   defaultTree = NULL;
+   return SUCCESS;
+}
+
+/* see ft.h for specification */
+int FT_enableIndex(void){
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_enableIndexIn(defaultTree);
+}
+
+/* see ft.h for specification */
+char *FT_toString(void){
+   if(defaultTree == NULL)
+      return NULL;
+   return FT_toStringIn(defaultTree);
+}
+
+/* see ft.h for specification */
+int FT_map(void (*pfApply)(const char *path, size_t length,
+                           void *pvExtra),
+           void *pvExtra){
+   assert(pfApply != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_mapIn(defaultTree, pfApply, pvExtra);
+}
+
+/* see ft.h for specification */
+int FT_writeTo(FILE *stream){
+   assert(stream != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_writeToIn(defaultTree, stream);
+}
+
+/* see ft.h for specification */
+int FT_bulkLoad(boolean (*pfNext)(struct ftRecord *pRecord,
+                                  void *pvStream),
+                void *pvStream){
+   assert(pfNext != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_bulkLoadIn(defaultTree, pfNext, pvStream);
+}
+
+/* see ft.h for specification */
+int FT_save(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_saveIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+int FT_load(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_loadIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+int FT_saveImage(char *path){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_saveImageIn(defaultTree, path);
+}
+
+/* see ft.h for specification */
+int FT_openJournal(char *path, size_t groupSize){
+   assert(path != NULL);
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_openJournalIn(defaultTree, path, groupSize);
+}
+
+/* see ft.h for specification */
+int FT_syncJournal(void){
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_syncJournalIn(defaultTree);
+}
+
+/* see ft.h for specification */
+int FT_compactJournal(void){
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_compactJournalIn(defaultTree);
+}
+
+/* see ft.h for specification */
+int FT_closeJournal(void){
+   if(defaultTree == NULL)
+      return INITIALIZATION_ERROR;
+   return FT_closeJournalIn(defaultTree);
+}
+
+#ifdef FT_STATS
+/* see ft.h for specification */
+void FT_getStats(struct ftStats *pStats){
+   const size_t* from = (const size_t*) &stats;
+   size_t* to = (size_t*) pStats;
+   size_t i;
+
+   assert(pStats != NULL);
+
+   /* struct ftStats is made of nothing but size_t counters, which
+      other threads may be adding to */
+   for(i = 0; i < sizeof(stats) / sizeof(size_t); i++)
+      to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+   pStats->grows = Node_getGrowCount() - growsBefore;
+}
+
+/* see ft.h for specification */
+void FT_resetStats(void){
+   size_t* counters = (size_t*) &stats;
+   size_t i;
+
+   for(i = 0; i < sizeof(stats) / sizeof(size_t); i++)
+      __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+   growsBefore = Node_getGrowCount();
+}
+
+/* see ft.h for specification */
+size_t FT_getPercentile(const struct ftHistogram *pHistogram,
+                        double percent){
+   size_t seen = 0;
+   size_t wanted;
+   size_t largest;
+   size_t b;
+
+   assert(pHistogram != NULL);
+   assert(percent >= 0 && percent <= 100);
+
+   if(pHistogram->count == 0)
+      return 0;
+   wanted = (size_t) (pHistogram->count * percent / 100);
+   if(wanted == 0)
+      wanted = 1;
+   for(b = 0; b < FT_HISTOGRAM_BUCKETS - 1; b++) {
+      seen += pHistogram->buckets[b];
+      if(seen >= wanted)
+         break;
+   }
+   if(b < FT_HISTOGRAM_SUBS)
+      return b;
+   /* Answers with the largest value of the bucket, but no more than
+      the largest value counted */
+   largest = ((b % FT_HISTOGRAM_SUBS + FT_HISTOGRAM_SUBS + 1)
+              << (b / FT_HISTOGRAM_SUBS - 1)) - 1;
+   if(b == FT_HISTOGRAM_BUCKETS - 1 || largest > pHistogram->max)
+      return pHistogram->max;
+   return largest;
+}
+
+/*
+   Writes to stream the line of FT_writeStats for the values counted
+   in *pHistogram, under name.
+*/
+static void FT_writeHistogram(FILE* stream, const char* name,
+                              const struct ftHistogram* pHistogram){
+   assert(stream != NULL);
+   assert(name != NULL);
+   assert(pHistogram != NULL);
+
+   fprintf(stream, "%-20s %10lu %10.0f %10lu %10lu %10lu %10lu\n",
+           name, (unsigned long) pHistogram->count,
+           pHistogram->count > 0
+              ? (double) pHistogram->sum / pHistogram->count : 0.0,
+           (unsigned long) FT_getPercentile(pHistogram, 50),
+           (unsigned long) FT_getPercentile(pHistogram, 90),
+           (unsigned long) FT_getPercentile(pHistogram, 99),
+           (unsigned long) pHistogram->max);
+}
+
+/* see ft.h for specification */
+int FT_writeStats(FILE *stream){
+   struct ftStats* pStats;
+   int op;
+
+   assert(stream != NULL);
+
+   /* Too big to copy onto the stack comfortably */
+   pStats = malloc(sizeof(struct ftStats));
+   if(pStats == NULL)
+      return MEMORY_ERROR;
+   FT_getStats(pStats);
+   fprintf(stream, "%-20s %10s %10s %10s %10s %10s %10s\n",
+           "latency (ns)", "calls", "mean", "p50", "p90", "p99", "max");
+   for(op = 0; op < FT_OPS; op++)
+      if(pStats->latency[op].count > 0)
+         FT_writeHistogram(stream, statsNames[op],
+                           &pStats->latency[op]);
+   fprintf(stream, "%-20s %10s %10s %10s %10s %10s %10s\n",
+           "nodes visited", "walks", "mean", "p50", "p90", "p99", "max");
+   FT_writeHistogram(stream, "path lookups", &pStats->pathVisits);
+   FT_writeHistogram(stream, "subtree walks", &pStats->walkVisits);
+   fprintf(stream, "%-20s %10lu\n", "arrays grown",
+           (unsigned long) pStats->grows);
+   free(pStats);
+   return SUCCESS;
+}
+#endif
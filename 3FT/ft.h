@@ -13,13 +13,35 @@
 */
 
 #include <stddef.h>
+#include <stdio.h>
 #include "a4def.h"
 
+/*
+  An FT_T is a handle to one file tree. The functions ending in "In"
+  act on the tree they are given; the others act on a single default
+  tree, which FT_init creates and FT_destroy frees.
+
+  When ft.c is compiled with -DFT_THREADSAFE, several threads may call
+  these functions on the same tree at once, except while FT_new,
+  FT_free, FT_init or FT_destroy creates or frees it. A lookup that
+  runs during a change sees the tree either before or after it. A
+  cursor may be used by one thread at a time, and the function passed
+  to FT_map, FT_glob or FT_listPrefix must not change the tree.
+*/
+typedef struct ft* FT_T;
+
+/*
+  An FTDir_T is a cursor over the entries under one directory of a
+  file tree, which lists them as they are when each is read.
+*/
+typedef struct ftDir* FTDir_T;
+
 /*
    Inserts a new directory into the tree at path, if possible.
    Returns SUCCESS if the new directory is inserted.
    Returns INITIALIZATION_ERROR if not in an initialized state.
-   Returns CONFLICTING_PATH if path is not underneath existing root.
+   Returns CONFLICTING_PATH if path is not underneath existing root,
+                            or is empty or has an empty component.
    Returns NOT_A_DIRECTORY if a proper prefix of path exists as a file.
    Returns ALREADY_IN_TREE if the path already exists (as dir or file).
    Returns PARENT_CHILD_ERROR if a new child cannot be added in path.
@@ -39,6 +61,7 @@ boolean FT_containsDir(char *path);
   Returns INITIALIZATION_ERROR if not in an initialized state.
   Returns NOT_A_DIRECTORY if path exists but is a file not a directory.
   Returns NO_SUCH_PATH if the path does not exist in the hierarchy.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
 */
 int FT_rmDir(char *path);
 
@@ -48,7 +71,9 @@ int FT_rmDir(char *path);
    Returns SUCCESS if the new file is inserted.
    Returns INITIALIZATION_ERROR if not in an initialized state.
    Returns CONFLICTING_PATH if path is not underneath existing root, 
-                            or if path would be the FT root.
+                            if path would be the FT root,
+                            or if path is empty or has an empty
+                            component.
    Returns NOT_A_DIRECTORY if a proper prefix of path exists as a file.
    Returns ALREADY_IN_TREE if the path already exists (as dir or file).
    Returns PARENT_CHILD_ERROR if a new child cannot be added in path.
@@ -68,6 +93,7 @@ boolean FT_containsFile(char *path);
   Returns INITIALIZATION_ERROR if not in an initialized state.
   Returns NOT_A_FILE if path exists but is a directory not a file.
   Returns NO_SUCH_PATH if the path does not exist in the hierarchy.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
 */
 int FT_rmFile(char *path);
 
@@ -89,6 +115,24 @@ void *FT_getFileContents(char *path);
 void *FT_replaceFileContents(char *path, void *newContents,
                              size_t newLength);
 
+/*
+   Moves the file or directory at oldPath, with everything under it,
+   to newPath, whose parent directory must already exist.
+   Returns SUCCESS if moved.
+   Returns INITIALIZATION_ERROR if not in an initialized state.
+   Returns NO_SUCH_PATH if oldPath does not exist in the hierarchy,
+                        or if the parent of newPath does not.
+   Returns CONFLICTING_PATH if newPath is not underneath existing
+                            root, if newPath is empty or has an empty
+                            component, or if newPath is underneath
+                            oldPath.
+   Returns NOT_A_DIRECTORY if a proper prefix of newPath exists as a
+                           file.
+   Returns ALREADY_IN_TREE if newPath already exists (as dir or file).
+   Returns MEMORY_ERROR if unable to allocate sufficient memory.
+*/
+int FT_rename(char *oldPath, char *newPath);
+
 /*
   Returns SUCCESS if path exists in the hierarchy,
   returns NO_SUCH_PATH if it does not, and
@@ -103,10 +147,77 @@ void *FT_replaceFileContents(char *path, void *newContents,
  */
 int FT_stat(char *path, boolean *type, size_t *length);
 
+/*
+  Returns SUCCESS if path exists in the hierarchy,
+  returns NO_SUCH_PATH if it does not, and
+  returns INITIALIZATION_ERROR if the structure is not initialized.
+
+  When returning SUCCESS, *files and *dirs are set to the number of
+  files and of directories at or under path, path itself included,
+  and *bytes to the total length of those files' contents.
+
+  When returning a non-SUCCESS status, *files, *dirs and *bytes are
+  unchanged.
+ */
+int FT_du(char *path, size_t *files, size_t *dirs, size_t *bytes);
+
+/*
+  Opens in *pDir a cursor over the children of the directory path,
+  which FT_readDir returns in the order FT_toString lists them. Each
+  read returns the entry that comes after the one read last, so an
+  entry present throughout is read once, while one added or removed
+  meanwhile may or may not be. FT_closeDir must come before
+  FT_destroy.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns NO_SUCH_PATH if path is not in the hierarchy.
+  Returns NOT_A_DIRECTORY if path is a file.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_openDir(char *path, FTDir_T *pDir);
+
+/*
+  Opens in *pDir a cursor, as FT_openDir does, over every entry under
+  the directory path down to maxDepth levels below it, or all the way
+  down if maxDepth is 0.
+  Returns as FT_openDir does.
+*/
+int FT_openTree(char *path, size_t maxDepth, FTDir_T *pDir);
+
+/*
+  Reads the next entry of dir: sets *name to its path relative to
+  the directory dir was opened on, *isFile to TRUE if it is a file,
+  and *length to the length of its contents, or 0 for a directory.
+  *name is valid until the next call on dir.
+  Returns NO_SUCH_PATH, leaving the arguments unchanged, once every
+  entry has been read.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory, in
+                       which case the same entry is read next time.
+  Returns SUCCESS otherwise.
+*/
+int FT_readDir(FTDir_T dir, const char **name, boolean *isFile,
+               size_t *length);
+
+/*
+  Moves dir to just after the entry whose relative path is name and
+  which is a file if isFile is TRUE, whether or not that entry is
+  there, so that a listing can resume where an earlier one stopped.
+  Returns CONFLICTING_PATH if name is empty or has an empty component.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_seekDir(FTDir_T dir, const char *name, boolean isFile);
+
+/*
+  Closes dir. Does nothing if dir is NULL.
+*/
+void FT_closeDir(FTDir_T dir);
+
 /*
   Sets the data structure to initialized status.
   The data structure is initially empty.
   Returns INITIALIZATION_ERROR if already initialized,
+  MEMORY_ERROR if unable to allocate memory,
   and SUCCESS otherwise.
 */
 int FT_init(void);
@@ -119,6 +230,16 @@ int FT_init(void);
 */
 int FT_destroy(void);
 
+/*
+  Builds an index from full path to node, kept up to date from then
+  on, so that the lookups of an exact path hash it rather than walk
+  down from the root.
+  Returns INITIALIZATION_ERROR if not in an initialized state,
+  MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise.
+*/
+int FT_enableIndex(void);
+
 /*
   Returns a string representation of the
   data structure, or NULL if the structure is
@@ -129,4 +250,368 @@ int FT_destroy(void);
 */
 char *FT_toString(void);
 
+/*
+  Calls (*pfApply)(path, length, pvExtra) with the path of each node
+  in the hierarchy and that path's length, in the same order that
+  FT_toString lists them, without building the whole listing.
+  The path is only valid during the call.
+  Returns INITIALIZATION_ERROR if not in an initialized state,
+  MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise.
+*/
+int FT_map(void (*pfApply)(const char *path, size_t length,
+                           void *pvExtra),
+           void *pvExtra);
+
+/*
+  Calls (*pfApply)(path, length, pvExtra), as FT_map does, with the
+  path of each node, file or directory, that matches pattern, in the
+  order FT_toString lists them. pattern is matched one component at
+  a time: in a component, '*' matches any run of characters, '?' any
+  one character, a set in brackets such as "[a-c]" or "[!0-9]" any
+  one character in, or not in, the set, and '\' makes the character
+  after it match only itself.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns CONFLICTING_PATH if pattern is empty or has an empty
+                           component.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_glob(char *pattern,
+            void (*pfApply)(const char *path, size_t length,
+                            void *pvExtra),
+            void *pvExtra);
+
+/*
+  Calls (*pfApply)(path, length, pvExtra), as FT_map does, with the
+  path of each node whose path starts with prefix, in the order
+  FT_toString lists them: "a/b" lists a/b, a/bc and everything under
+  them, and "a/b/" only what is under a/b.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_listPrefix(char *prefix,
+                  void (*pfApply)(const char *path, size_t length,
+                                  void *pvExtra),
+                  void *pvExtra);
+
+/*
+  Writes the string representation of the data structure, as returned
+  by FT_toString, to stream, without building the whole string.
+  Returns INITIALIZATION_ERROR if not in an initialized state,
+  MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise; use ferror on stream to detect write errors.
+*/
+int FT_writeTo(FILE *stream);
+
+/*
+  One record of a bulk load: the path of a file or a directory, TRUE
+  in isFile if it is a file, and, for a file, its contents and their
+  length.
+*/
+struct ftRecord {
+   const char *path;
+   boolean isFile;
+   void *contents;
+   size_t length;
+};
+
+/*
+  Builds the hierarchy, which must be empty, from the records filled
+  in by successive calls to (*pfNext)(&record, pvStream), up to the
+  first call that returns FALSE, as inserting them one by one would.
+  The records must be sorted as strcmp would sort their paths if '/'
+  came before every other character. A directory need not have a
+  record of its own before the paths under it. pfNext must not call
+  back into the tree. On any error the hierarchy is left empty.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns CONFLICTING_PATH if the hierarchy is not empty, if a path is
+                           not underneath the first record's root,
+                           would make a file the root, is empty or
+                           has an empty component, or if the records
+                           are out of order.
+  Returns NOT_A_DIRECTORY if a proper prefix of a path is a file.
+  Returns ALREADY_IN_TREE if two records have the same path.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_bulkLoad(boolean (*pfNext)(struct ftRecord *pRecord,
+                                  void *pvStream),
+                void *pvStream);
+
+/*
+  Writes a snapshot of the hierarchy, with the types and contents of
+  its files, to the file named path, replacing anything already
+  there, for FT_load on a machine like this one to rebuild.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns IO_ERROR if the file cannot be written.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_save(char *path);
+
+/*
+  Rebuilds in the hierarchy, which must be empty, the hierarchy saved
+  by FT_save to the file named path. The contents of the loaded files
+  are owned by the hierarchy, not the client, and stay valid until
+  FT_destroy, even once replaced by FT_replaceFileContents, so the
+  client must not free them. On any error the hierarchy is left empty.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns CONFLICTING_PATH if the hierarchy is not empty.
+  Returns IO_ERROR if the file cannot be read, was not written by
+                   FT_save on a machine like this one, or is damaged.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_load(char *path);
+
+/*
+  Writes an image of the hierarchy to the file named path, replacing
+  anything already there, for FTImage_open (see ftimage.h) to map.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns IO_ERROR if the file cannot be written.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_saveImage(char *path);
+
+/*
+  Makes the hierarchy durable in the journal at path: from then on,
+  each change is recorded in the journal before it is made, and
+  synced to disk with every groupSize-th change, or with each one if
+  groupSize is 0 or 1. If path already holds a journal, first
+  rebuilds in the hierarchy, which must then be empty, the state it
+  records, owning the contents as FT_load does. The journal keeps
+  snapshots in files named after path. A change that cannot be
+  journaled is not made: it returns IO_ERROR or MEMORY_ERROR, or
+  NULL for FT_replaceFileContents. Must not run while another thread
+  uses the hierarchy.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns CONFLICTING_PATH if a journal is already open, or if the
+                           hierarchy is not empty but the journal
+                           records any state.
+  Returns IO_ERROR if the journal or its snapshot cannot be read or
+                   written, or if replaying a change fails.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_openJournal(char *path, size_t groupSize);
+
+/*
+  Writes the journaled changes not yet synced to disk, and waits
+  until they are there. Does nothing if no journal is open.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns IO_ERROR if this or an earlier group of changes could not
+                   be written.
+  Returns SUCCESS otherwise.
+*/
+int FT_syncJournal(void);
+
+/*
+  Saves the hierarchy into the journal's snapshot and starts the
+  journal afresh. Does nothing if no journal is open.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns IO_ERROR as FT_syncJournal does, or if the snapshot cannot
+                   be written.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory.
+  Returns SUCCESS otherwise.
+*/
+int FT_compactJournal(void);
+
+/*
+  Syncs and closes the journal. Does nothing if no journal is open.
+  FT_destroy closes it too, but cannot report a failure to sync it.
+  Returns INITIALIZATION_ERROR if not in an initialized state.
+  Returns IO_ERROR as FT_syncJournal does.
+  Returns SUCCESS otherwise.
+*/
+int FT_closeJournal(void);
+
+/*
+  Returns a read-only snapshot of the hierarchy as it is now, taken
+  in constant time, which shares the hierarchy's nodes until they
+  change. Query it with the functions ending in "In"; those that
+  would change it, and FT_enableIndexIn, return READ_ONLY instead,
+  and FT_replaceFileContentsIn returns NULL. The snapshot must be
+  freed with FT_free before FT_destroy.
+  Returns NULL if not in an initialized state, or if unable to
+  allocate memory.
+*/
+FT_T FT_snapshot(void);
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns a new, empty file tree,
+  or NULL if unable to allocate memory.
+*/
+FT_T FT_new(void);
+
+/*
+  Frees ft and all of its contents. Every snapshot of ft, and every
+  cursor opened on it, must be freed or closed first. Freeing a
+  snapshot frees only the nodes it alone still holds.
+*/
+void FT_free(FT_T ft);
+
+/*
+  Each of the following functions behaves as the function of the same
+  name without "In", but on the tree ft, which must not be NULL. Since
+  ft always exists, none returns INITIALIZATION_ERROR.
+*/
+int FT_insertDirIn(FT_T ft, char *path);
+
+boolean FT_containsDirIn(FT_T ft, char *path);
+
+int FT_rmDirIn(FT_T ft, char *path);
+
+int FT_insertFileIn(FT_T ft, char *path, void *contents, size_t length);
+
+boolean FT_containsFileIn(FT_T ft, char *path);
+
+int FT_rmFileIn(FT_T ft, char *path);
+
+void *FT_getFileContentsIn(FT_T ft, char *path);
+
+void *FT_replaceFileContentsIn(FT_T ft, char *path, void *newContents,
+                               size_t newLength);
+
+int FT_renameIn(FT_T ft, char *oldPath, char *newPath);
+
+FT_T FT_snapshotIn(FT_T ft);
+
+int FT_statIn(FT_T ft, char *path, boolean *type, size_t *length);
+
+int FT_duIn(FT_T ft, char *path, size_t *files, size_t *dirs,
+            size_t *bytes);
+
+int FT_openDirIn(FT_T ft, char *path, FTDir_T *pDir);
+
+int FT_openTreeIn(FT_T ft, char *path, size_t maxDepth, FTDir_T *pDir);
+
+char *FT_toStringIn(FT_T ft);
+
+int FT_mapIn(FT_T ft,
+             void (*pfApply)(const char *path, size_t length,
+                             void *pvExtra),
+             void *pvExtra);
+
+int FT_globIn(FT_T ft, char *pattern,
+              void (*pfApply)(const char *path, size_t length,
+                              void *pvExtra),
+              void *pvExtra);
+
+int FT_listPrefixIn(FT_T ft, char *prefix,
+                    void (*pfApply)(const char *path, size_t length,
+                                    void *pvExtra),
+                    void *pvExtra);
+
+int FT_writeToIn(FT_T ft, FILE *stream);
+
+int FT_enableIndexIn(FT_T ft);
+
+int FT_bulkLoadIn(FT_T ft,
+                  boolean (*pfNext)(struct ftRecord *pRecord,
+                                    void *pvStream),
+                  void *pvStream);
+
+int FT_saveIn(FT_T ft, char *path);
+
+int FT_loadIn(FT_T ft, char *path);
+
+int FT_saveImageIn(FT_T ft, char *path);
+
+int FT_openJournalIn(FT_T ft, char *path, size_t groupSize);
+
+int FT_syncJournalIn(FT_T ft);
+
+int FT_compactJournalIn(FT_T ft);
+
+int FT_closeJournalIn(FT_T ft);
+
+/*--------------------------------------------------------------------*/
+
+#ifdef FT_STATS
+
+/*
+  When ft.c and node.c are compiled with -DFT_STATS, the process
+  keeps statistics of its trees: the latencies of the calls to each
+  entry point below, the nodes each path lookup and each walk of a
+  subtree visits, and the number of children arrays grown. A call
+  counts whether made through the global function or the one ending
+  in "In", but not while not in an initialized state. FT_openDir
+  counts as FT_openTree; FT_new, FT_free, FT_enableIndex, FT_closeDir
+  and the journal functions are not counted.
+*/
+enum ftStatsOp { FT_OP_INSERT_DIR, FT_OP_CONTAINS_DIR, FT_OP_RM_DIR,
+                 FT_OP_INSERT_FILE, FT_OP_CONTAINS_FILE, FT_OP_RM_FILE,
+                 FT_OP_GET_CONTENTS, FT_OP_REPLACE, FT_OP_RENAME,
+                 FT_OP_STAT, FT_OP_DU, FT_OP_TO_STRING, FT_OP_MAP,
+                 FT_OP_GLOB, FT_OP_LIST_PREFIX, FT_OP_WRITE_TO,
+                 FT_OP_OPEN_TREE, FT_OP_READ_DIR, FT_OP_SEEK_DIR,
+                 FT_OP_BULK_LOAD, FT_OP_SAVE, FT_OP_LOAD,
+                 FT_OP_SAVE_IMAGE, FT_OP_SNAPSHOT, FT_OPS };
+
+/*
+  A histogram of values: each value below FT_HISTOGRAM_SUBS has a
+  bucket, and each power of two above is split into FT_HISTOGRAM_SUBS
+  buckets, up to 2^40. count is the number of values, sum their total
+  and max the largest.
+*/
+enum { FT_HISTOGRAM_SUBS = 16,
+       FT_HISTOGRAM_BUCKETS = FT_HISTOGRAM_SUBS * 37 };
+
+struct ftHistogram {
+   size_t count;
+   size_t sum;
+   size_t max;
+   size_t buckets[FT_HISTOGRAM_BUCKETS];
+};
+
+/*
+  The statistics: the latencies of each entry point's calls, in
+  nanoseconds, the nodes visited by each walk down a path and by each
+  walk of a whole subtree, and the number of children arrays grown.
+*/
+struct ftStats {
+   struct ftHistogram latency[FT_OPS];
+   struct ftHistogram pathVisits;
+   struct ftHistogram walkVisits;
+   size_t grows;
+};
+
+/*
+  Stores in *pStats the statistics gathered since the process started
+  or FT_resetStats was last called. In the thread-safe build, calls
+  made during FT_getStats may be partly counted.
+*/
+void FT_getStats(struct ftStats *pStats);
+
+/*
+  Starts gathering statistics afresh.
+*/
+void FT_resetStats(void);
+
+/*
+  Returns the least value that at least percent percent of the values
+  counted in *pHistogram are at most, as precisely as its buckets
+  allow, or 0 if it has none: FT_getPercentile(&stats.latency[op],
+  99.0) is the 99th percentile latency of op.
+*/
+size_t FT_getPercentile(const struct ftHistogram *pHistogram,
+                        double percent);
+
+/*
+  Writes the statistics to stream, one line for each entry point that
+  has been called, with its number of calls and its mean, median,
+  90th, 99th percentile and largest latency, then one line for each
+  kind of walk and one for the arrays grown.
+  Returns MEMORY_ERROR if unable to allocate sufficient memory,
+  and SUCCESS otherwise; use ferror on stream to detect write errors.
+*/
+int FT_writeStats(FILE *stream);
+
+#endif
+
 #endif
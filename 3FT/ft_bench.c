@@ -0,0 +1,388 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench.c                                                         */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include "ft.h"
+#include "ftimage.h"
+
+/* Default number of files, files per directory and directory depth */
+enum { DEFAULT_FILES = 100000, DEFAULT_FANOUT = 1000, DEFAULT_DEPTH = 1 };
+
+/* Longest path the bench generates, including the '\0' */
+enum { MAX_PATH = 4096 };
+
+/* The file the tree is saved to and loaded back from */
+static char benchSnapshot[] = "ft_bench.snap";
+
+/* The file the tree's image is written to and mapped from */
+static char benchImage[] = "ft_bench.img";
+
+/*
+   Allocation counters. ft_bench is linked with
+   -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free so that
+   every allocation made by ft.o, node.o and dynarray.o goes through
+   the wrappers below and is counted, along with the heap bytes that
+   are currently live.
+*/
+static size_t allocCount;
+static size_t liveBytes;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+/* Counts and forwards a call to malloc. */
+void *__wrap_malloc(size_t size) {
+   void *ptr = __real_malloc(size);
+
+   allocCount++;
+   if(ptr != NULL)
+      liveBytes += malloc_usable_size(ptr);
+   return ptr;
+}
+
+/* Counts and forwards a call to calloc. */
+void *__wrap_calloc(size_t nmemb, size_t size) {
+   void *ptr = __real_calloc(nmemb, size);
+
+   allocCount++;
+   if(ptr != NULL)
+      liveBytes += malloc_usable_size(ptr);
+   return ptr;
+}
+
+/* Counts and forwards a call to realloc. */
+void *__wrap_realloc(void *ptr, size_t size) {
+   size_t oldBytes = malloc_usable_size(ptr);
+
+   allocCount++;
+   ptr = __real_realloc(ptr, size);
+   if(ptr != NULL)
+      liveBytes += malloc_usable_size(ptr) - oldBytes;
+   return ptr;
+}
+
+/* Forwards a call to free, forgetting the bytes it releases. */
+void __wrap_free(void *ptr) {
+   liveBytes -= malloc_usable_size(ptr);
+   __real_free(ptr);
+}
+
+/*
+   Writes into path the path of the i'th bench file, placing fanout
+   files in each directory, under a chain of depth directories.
+*/
+static void Bench_path(char *path, size_t i, size_t fanout,
+                       size_t depth) {
+   size_t d;
+
+   assert(path != NULL);
+   path += sprintf(path, "bench");
+   for(d = 0; d < depth; d++)
+      path += sprintf(path, "/d%lu", (unsigned long) (i / fanout));
+   sprintf(path, "/f%lu", (unsigned long) i);
+}
+
+/* A bench file, as a record for FT_bulkLoadIn */
+struct benchFile {
+   char *path;
+   size_t length;
+};
+
+/*
+   Compares the paths of the struct benchFile objects at pv1 and pv2
+   as strcmp would if '/' came before every other character, which is
+   the order FT_bulkLoadIn takes records in.
+*/
+static int Bench_compareFiles(const void *pv1, const void *pv2) {
+   const unsigned char *p1 =
+      (const unsigned char *) ((const struct benchFile *) pv1)->path;
+   const unsigned char *p2 =
+      (const unsigned char *) ((const struct benchFile *) pv2)->path;
+
+   while(*p1 != '\0' && *p1 == *p2) {
+      p1++;
+      p2++;
+   }
+   if(*p1 == *p2)
+      return 0;
+   if(*p1 == '/')
+      return *p2 == '\0' ? 1 : -1;
+   if(*p2 == '/')
+      return *p1 == '\0' ? -1 : 1;
+   return (int) *p1 - (int) *p2;
+}
+
+/*
+   Fills in *pRecord with the next of the files that the struct
+   benchFile pointer at pvNext points to, and advances it, until
+   the file with a NULL path.
+   Returns FALSE at that file, TRUE otherwise.
+*/
+static boolean Bench_nextRecord(struct ftRecord *pRecord, void *pvNext) {
+   struct benchFile **ppNext = pvNext;
+
+   if((*ppNext)->path == NULL)
+      return FALSE;
+   pRecord->path = (*ppNext)->path;
+   pRecord->isFile = TRUE;
+   pRecord->contents = NULL;
+   pRecord->length = (*ppNext)->length;
+   (*ppNext)++;
+   return TRUE;
+}
+
+/*
+   Prints one result line for a phase of ops operations that started
+   at clock start and made allocs allocations.
+*/
+static void Bench_report(const char *phase, size_t ops,
+                         clock_t start, size_t allocs) {
+   double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   printf("%-18s %10lu ops %10.3f s %12.0f ops/s %8.2f allocs/op\n",
+          phase, (unsigned long) ops, seconds,
+          seconds > 0 ? ops / seconds : 0.0,
+          ops > 0 ? (double) allocs / ops : 0.0);
+}
+
+/*
+   Builds a tree of argv[1] files with argv[2] files per directory,
+   each directory argv[3] levels below the root,
+   then times inserts, a bulk load of the same files into a second
+   tree, saving a snapshot of the tree and loading it into a third,
+   lookups, duplicate inserts, toString, replacing every file's
+   contents with and without a snapshot, and removals,
+   asserting that lookups and rejected inserts allocate nothing, and
+   reports the heap the tree occupies.
+   Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   size_t files = DEFAULT_FILES;
+   size_t fanout = DEFAULT_FANOUT;
+   size_t depth = DEFAULT_DEPTH;
+   char path[MAX_PATH];
+   size_t i;
+   size_t allocs;
+   boolean type;
+   size_t length;
+   clock_t start;
+   char *temp;
+   char *loaded;
+   struct benchFile *aFiles;
+   struct benchFile *pNext;
+   FT_T ft;
+   FT_T snapshot;
+   size_t bytes;
+   FTImage_T image;
+
+   if(argc > 1)
+      files = (size_t) strtoul(argv[1], NULL, 10);
+   if(argc > 2)
+      fanout = (size_t) strtoul(argv[2], NULL, 10);
+   if(argc > 3)
+      depth = (size_t) strtoul(argv[3], NULL, 10);
+   if(fanout == 0)
+      fanout = 1;
+   if(depth * 24 + 32 > MAX_PATH)
+      depth = (MAX_PATH - 32) / 24;
+
+   assert(FT_init() == SUCCESS);
+   /* A file cannot be the root, so create the root directory first */
+   assert(FT_insertDir("bench") == SUCCESS);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      assert(FT_insertFile(path, NULL, i) == SUCCESS);
+   }
+   Bench_report("insertFile", files, start, allocCount - allocs);
+   printf("%-18s %10lu bytes %8.1f bytes/file\n", "heap",
+          (unsigned long) liveBytes, (double) liveBytes / files);
+
+   /* Loads the same files, sorted, into a second tree in one pass */
+   aFiles = calloc(files + 1, sizeof(struct benchFile));
+   assert(aFiles != NULL);
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      aFiles[i].path = malloc(strlen(path) + 1);
+      assert(aFiles[i].path != NULL);
+      strcpy(aFiles[i].path, path);
+      aFiles[i].length = i;
+   }
+   qsort(aFiles, files, sizeof(struct benchFile), Bench_compareFiles);
+   assert((ft = FT_new()) != NULL);
+   pNext = aFiles;
+   allocs = allocCount;
+   start = clock();
+   assert(FT_bulkLoadIn(ft, Bench_nextRecord, &pNext) == SUCCESS);
+   Bench_report("bulkLoad", files, start, allocCount - allocs);
+   temp = FT_toString();
+   loaded = FT_toStringIn(ft);
+   assert(temp != NULL && loaded != NULL && !strcmp(temp, loaded));
+   free(temp);
+   free(loaded);
+   FT_free(ft);
+   for(i = 0; i < files; i++)
+      free(aFiles[i].path);
+   free(aFiles);
+
+   /* Saves the tree and rebuilds it from the snapshot */
+   start = clock();
+   assert(FT_save(benchSnapshot) == SUCCESS);
+   Bench_report("save", files, start, 0);
+   assert((ft = FT_new()) != NULL);
+   allocs = allocCount;
+   start = clock();
+   assert(FT_loadIn(ft, benchSnapshot) == SUCCESS);
+   Bench_report("load", files, start, allocCount - allocs);
+   temp = FT_toString();
+   loaded = FT_toStringIn(ft);
+   assert(temp != NULL && loaded != NULL && !strcmp(temp, loaded));
+   free(temp);
+   free(loaded);
+   FT_free(ft);
+   assert(remove(benchSnapshot) == 0);
+
+   /* Writes an image of the tree, maps it, and looks up every file */
+   start = clock();
+   assert(FT_saveImage(benchImage) == SUCCESS);
+   Bench_report("saveImage", files, start, 0);
+   allocs = allocCount;
+   start = clock();
+   assert((image = FTImage_open(benchImage)) != NULL);
+   Bench_report("openImage", 1, start, allocCount - allocs);
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      assert(FTImage_stat(image, path, &type, &length) == SUCCESS);
+      assert(type == TRUE && length == i);
+   }
+   Bench_report("image/stat", files, start, allocCount - allocs);
+   temp = FT_toString();
+   loaded = FTImage_toString(image);
+   assert(temp != NULL && loaded != NULL && !strcmp(temp, loaded));
+   free(temp);
+   free(loaded);
+   FTImage_close(image);
+   assert(remove(benchImage) == 0);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      assert(FT_containsFile(path) == TRUE);
+   }
+   Bench_report("containsFile", files, start, allocCount - allocs);
+   assert(allocCount == allocs);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i + files, fanout, depth);
+      assert(FT_containsFile(path) == FALSE);
+   }
+   Bench_report("containsFile/miss", files, start, allocCount - allocs);
+   assert(allocCount == allocs);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      assert(FT_stat(path, &type, &length) == SUCCESS);
+      assert(type == TRUE && length == i);
+   }
+   Bench_report("stat", files, start, allocCount - allocs);
+   assert(allocCount == allocs);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      assert(FT_insertFile(path, NULL, 0) == ALREADY_IN_TREE);
+   }
+   Bench_report("insertFile/dup", files, start, allocCount - allocs);
+   assert(allocCount == allocs);
+
+   start = clock();
+   temp = FT_toString();
+   assert(temp != NULL);
+   Bench_report("toString", 1, start, 0);
+   free(temp);
+
+   /* Replaces every file's contents under a snapshot, which copies
+      each file and directory once, then again with none */
+   allocs = allocCount;
+   start = clock();
+   snapshot = FT_snapshot();
+   assert(snapshot != NULL);
+   Bench_report("snapshot", 1, start, allocCount - allocs);
+   bytes = liveBytes;
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      (void) FT_replaceFileContents(path, NULL, i + 1);
+   }
+   Bench_report("replace/snapshot", files, start, allocCount - allocs);
+   printf("%-18s %10lu bytes %8.1f bytes/file\n", "snapshot heap",
+          (unsigned long) (liveBytes - bytes),
+          (double) (liveBytes - bytes) / files);
+   assert(FT_statIn(snapshot, path, &type, &length) == SUCCESS);
+   assert(type == TRUE && length == files - 1);
+   assert(FT_stat(path, &type, &length) == SUCCESS);
+   assert(type == TRUE && length == files);
+   start = clock();
+   FT_free(snapshot);
+   Bench_report("snapshot/free", 1, start, 0);
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      (void) FT_replaceFileContents(path, NULL, i);
+   }
+   Bench_report("replace", files, start, allocCount - allocs);
+   assert(allocCount == allocs);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 1; i < files; i += 2) {
+      Bench_path(path, i, fanout, depth);
+      assert(FT_rmFile(path) == SUCCESS);
+   }
+   Bench_report("rmFile", files / 2, start, allocCount - allocs);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 1; i < files; i += 2) {
+      Bench_path(path, i, fanout, depth);
+      assert(FT_insertFile(path, NULL, i) == SUCCESS);
+   }
+   Bench_report("insertFile/again", files / 2, start, allocCount - allocs);
+
+   allocs = allocCount;
+   start = clock();
+   for(i = 0; i < files; i += 2 * fanout) {
+      sprintf(path, "bench/d%lu", (unsigned long) (i / fanout));
+      assert(FT_rmDir(path) == SUCCESS);
+   }
+   Bench_report("rmDir", (files + 2 * fanout - 1) / (2 * fanout), start,
+                allocCount - allocs);
+
+   start = clock();
+   assert(FT_destroy() == SUCCESS);
+   Bench_report("destroy", 1, start, 0);
+
+   return 0;
+}
@@ -3,12 +3,42 @@
 /* Author: Christopher Moretti                                        */
 /*--------------------------------------------------------------------*/
 
+/* for SIGXFSZ and setrlimit under -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <signal.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/resource.h>
 #include "ft.h"
+#include "ftimage.h"
+
+/* Fills in *pRecord with the record that the struct ftRecord pointer
+   at pvNext points to, and advances the pointer, unless that record's
+   path is NULL, which ends the records.
+   Returns FALSE at the end of the records, and TRUE otherwise. */
+static boolean nextRecord(struct ftRecord *pRecord, void *pvNext) {
+  struct ftRecord **ppNext = pvNext;
+
+  if ((*ppNext)->path == NULL)
+    return FALSE;
+  *pRecord = **ppNext;
+  (*ppNext)++;
+  return TRUE;
+}
+
+/* Appends path, of length characters, and a newline to the string
+   at pvList, which must have room for them. */
+static void appendPath(const char *path, size_t length, void *pvList) {
+  char *list = pvList;
+
+  assert(strlen(path) == length);
+  strcat(list, path);
+  strcat(list, "\n");
+}
 
 /* Tests the FT implementation with an assortment of checks.
    Prints the status of the data structure along the way to stderr.
@@ -17,7 +47,50 @@ int main(void) {
   char* temp;
   boolean b;
   size_t l;
+  size_t files;
+  size_t dirs;
+  size_t bytes;
   char arr[1000] = {'\0'};
+  char list[1000];
+  FILE* stream;
+  struct rlimit limit;
+  struct rlimit saved;
+  FT_T ft1;
+  FT_T ft2;
+  FT_T ft3;
+  FTImage_T image;
+  FTDir_T dir;
+  const char *name;
+  struct ftRecord *pNext;
+  struct ftRecord sorted[] = {
+    {"a", FALSE, NULL, 0}, {"a/b", FALSE, NULL, 0},
+    {"a/b/x", TRUE, "x", 2}, {"a/b-c", TRUE, NULL, 5},
+    {"a/c/d/e", TRUE, NULL, 0}, {"a/c/z", FALSE, NULL, 0},
+    {"a/f", TRUE, "f", 2}, {NULL, FALSE, NULL, 0}
+  };
+  struct ftRecord unsorted[] = {
+    {"a/c", FALSE, NULL, 0}, {"a/b", FALSE, NULL, 0},
+    {NULL, FALSE, NULL, 0}
+  };
+  struct ftRecord duplicate[] = {
+    {"a/b", FALSE, NULL, 0}, {"a/b", TRUE, NULL, 0},
+    {NULL, FALSE, NULL, 0}
+  };
+  struct ftRecord underFile[] = {
+    {"a/f", TRUE, NULL, 0}, {"a/f/g", TRUE, NULL, 0},
+    {NULL, FALSE, NULL, 0}
+  };
+  struct ftRecord fileRoot[] = {
+    {"a", TRUE, NULL, 0}, {NULL, FALSE, NULL, 0}
+  };
+  struct ftRecord twoRoots[] = {
+    {"a/b", FALSE, NULL, 0}, {"c/d", FALSE, NULL, 0},
+    {NULL, FALSE, NULL, 0}
+  };
+  struct ftRecord malformed[] = {
+    {"a/b", FALSE, NULL, 0}, {"a/c//d", FALSE, NULL, 0},
+    {NULL, FALSE, NULL, 0}
+  };
 
   /* Before the data structure is initialized, insert*, remove*,
      and destroy operations should return INITIALIZATION_ERROR, and
@@ -190,6 +263,14 @@ int main(void) {
   assert(FT_insertDir("a/y/CHILD2DIR/CHILD4DIR") == SUCCESS);
   assert((temp = FT_toString()) != NULL);
   fprintf(stderr, "Checkpoint 5.6:\n%s\n", temp);
+
+  /* writeTo streams exactly what toString returns */
+  assert((stream = tmpfile()) != NULL);
+  assert(FT_writeTo(stream) == SUCCESS);
+  rewind(stream);
+  assert(fread(arr, 1, sizeof(arr), stream) == strlen(temp));
+  assert(!strncmp(arr, temp, strlen(temp)));
+  fclose(stream);
   free(temp);
   
   assert(FT_destroy() == SUCCESS);
@@ -197,7 +278,721 @@ int main(void) {
   assert(FT_containsDir("a") == FALSE);
   assert(FT_containsFile("a") == FALSE);
   assert((temp = FT_toString()) == NULL);
-  
+  assert(FT_writeTo(stderr) == INITIALIZATION_ERROR);
+
+  /* Trees from FT_new are independent of each other and of the
+     default tree, which stays uninitialized */
+  assert((ft1 = FT_new()) != NULL);
+  assert((ft2 = FT_new()) != NULL);
+  assert(FT_insertDirIn(ft1, "a/b") == SUCCESS);
+  assert(FT_insertDirIn(ft2, "a") == SUCCESS);
+  assert(FT_insertFileIn(ft2, "a/b", "hi", 3) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b", NULL, 0) == ALREADY_IN_TREE);
+  assert(FT_containsDirIn(ft1, "a/b") == TRUE);
+  assert(FT_containsFileIn(ft2, "a/b") == TRUE);
+  assert(FT_containsFileIn(ft1, "a/b") == FALSE);
+  assert(FT_containsDir("a") == FALSE);
+  assert(FT_statIn(ft2, "a/b", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 3);
+  assert(!strcmp(FT_getFileContentsIn(ft2, "a/b"), "hi"));
+  assert(FT_rmDirIn(ft1, "a/b") == SUCCESS);
+  assert(FT_rmFileIn(ft2, "a/b") == SUCCESS);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "a\n"));
+  free(temp);
+  FT_free(ft1);
+
+  /* With the index enabled, lookups agree with the tree, and rmDir
+     takes the descendants out of the index too */
+  assert(FT_insertDirIn(ft2, "a/x/y") == SUCCESS);
+  assert(FT_insertFileIn(ft2, "a/x/f", NULL, 0) == SUCCESS);
+  assert(FT_enableIndexIn(ft2) == SUCCESS);
+  assert(FT_enableIndexIn(ft2) == SUCCESS);
+  assert(FT_containsDirIn(ft2, "a/x/y") == TRUE);
+  assert(FT_containsFileIn(ft2, "a/x/f") == TRUE);
+  assert(FT_containsDirIn(ft2, "a/x/y/") == FALSE);
+  assert(FT_containsDirIn(ft2, "a//x") == FALSE);
+  assert(FT_insertFileIn(ft2, "a/z/w/g", NULL, 7) == SUCCESS);
+  assert(FT_containsDirIn(ft2, "a/z/w") == TRUE);
+  assert(FT_statIn(ft2, "a/z/w/g", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 7);
+  assert(FT_rmDirIn(ft2, "a/x") == SUCCESS);
+  assert(FT_containsDirIn(ft2, "a/x/y") == FALSE);
+  assert(FT_containsFileIn(ft2, "a/x/f") == FALSE);
+  assert(FT_rmFileIn(ft2, "a/z/w/g") == SUCCESS);
+  assert(FT_containsFileIn(ft2, "a/z/w/g") == FALSE);
+  assert(FT_rmDirIn(ft2, "a/z") == SUCCESS);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\n"));
+  free(temp);
+
+  /* Empty components are rejected on insert, and leave no trace */
+  assert(FT_insertDirIn(ft2, "a//x") == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft2, "a/x/") == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft2, "a/x//y") == CONFLICTING_PATH);
+  assert(FT_insertFileIn(ft2, "a/x/f/", NULL, 0) == CONFLICTING_PATH);
+  assert(FT_insertFileIn(ft2, "a//f", NULL, 0) == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft2, "a/") == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft2, "") == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft2, "/a/x") == CONFLICTING_PATH);
+  assert(FT_containsDirIn(ft2, "a/x") == FALSE);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\n"));
+  free(temp);
+  FT_free(ft2);
+
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_insertDirIn(ft1, "") == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft1, "/a") == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft1, "a//b") == CONFLICTING_PATH);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, ""));
+  free(temp);
+  FT_free(ft1);
+
+  /* A bulk load builds the same tree as inserting its records one by
+     one, with files ahead of directories, and missing directories
+     created along the way */
+  assert((ft1 = FT_new()) != NULL);
+  assert((ft2 = FT_new()) != NULL);
+  assert(FT_enableIndexIn(ft1) == SUCCESS);
+  pNext = sorted;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == SUCCESS);
+  assert(FT_insertDirIn(ft2, "a/c/z") == SUCCESS);
+  assert(FT_insertFileIn(ft2, "a/f", "f", 2) == SUCCESS);
+  assert(FT_insertFileIn(ft2, "a/c/d/e", NULL, 0) == SUCCESS);
+  assert(FT_insertFileIn(ft2, "a/b-c", NULL, 5) == SUCCESS);
+  assert(FT_insertFileIn(ft2, "a/b/x", "x", 2) == SUCCESS);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "a\na/b-c\na/f\na/b\na/b/x\na/c\na/c/d\n"
+                 "a/c/d/e\na/c/z\n"));
+  free(temp);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\na/b-c\na/f\na/b\na/b/x\na/c\na/c/d\n"
+                 "a/c/d/e\na/c/z\n"));
+  free(temp);
+  assert(FT_containsFileIn(ft1, "a/c/d/e") == TRUE);
+  assert(FT_statIn(ft1, "a/b-c", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 5);
+  assert(!strcmp(FT_getFileContentsIn(ft1, "a/b/x"), "x"));
+  assert(FT_insertFileIn(ft1, "a/c/y", NULL, 0) == SUCCESS);
+  assert(FT_rmDirIn(ft1, "a/c") == SUCCESS);
+  assert(FT_containsFileIn(ft1, "a/c/d/e") == FALSE);
+  pNext = sorted;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == CONFLICTING_PATH);
+  FT_free(ft1);
+  FT_free(ft2);
+
+  /* A bulk load that fails leaves the tree empty */
+  assert((ft1 = FT_new()) != NULL);
+  pNext = unsorted;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == CONFLICTING_PATH);
+  pNext = duplicate;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == ALREADY_IN_TREE);
+  pNext = underFile;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == NOT_A_DIRECTORY);
+  pNext = fileRoot;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == CONFLICTING_PATH);
+  pNext = twoRoots;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == CONFLICTING_PATH);
+  pNext = malformed;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == CONFLICTING_PATH);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, ""));
+  free(temp);
+  pNext = fileRoot + 1;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == SUCCESS);
+  assert(FT_containsDirIn(ft1, "a") == FALSE);
+  FT_free(ft1);
+
+  /* A snapshot loads back into the same tree, contents included */
+  assert(FT_save("ft_client.snap") == INITIALIZATION_ERROR);
+  assert(FT_load("ft_client.snap") == INITIALIZATION_ERROR);
+  assert((ft1 = FT_new()) != NULL);
+  assert((ft2 = FT_new()) != NULL);
+  pNext = sorted;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == SUCCESS);
+  assert(FT_saveIn(ft1, "ft_client.snap") == SUCCESS);
+  assert(FT_enableIndexIn(ft2) == SUCCESS);
+  assert(FT_loadIn(ft2, "ft_client.snap") == SUCCESS);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\na/b-c\na/f\na/b\na/b/x\na/c\na/c/d\n"
+                 "a/c/d/e\na/c/z\n"));
+  free(temp);
+  assert(FT_containsFileIn(ft2, "a/c/d/e") == TRUE);
+  assert(FT_statIn(ft2, "a/b-c", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 5);
+  assert(FT_getFileContentsIn(ft2, "a/b-c") == NULL);
+  assert(!strcmp(FT_getFileContentsIn(ft2, "a/b/x"), "x"));
+  assert(!strcmp(FT_getFileContentsIn(ft2, "a/f"), "f"));
+  assert(FT_loadIn(ft2, "ft_client.snap") == CONFLICTING_PATH);
+  assert(FT_insertFileIn(ft2, "a/c/y", NULL, 0) == SUCCESS);
+  assert(FT_rmDirIn(ft2, "a/c") == SUCCESS);
+  assert(FT_containsFileIn(ft2, "a/c/d/e") == FALSE);
+  FT_free(ft2);
+
+  /* A snapshot that is cut short, or is not a snapshot at all, or
+     does not exist, loads nothing */
+  assert((stream = fopen("ft_client.snap", "rb")) != NULL);
+  l = fread(arr, 1, sizeof(arr), stream);
+  assert(fclose(stream) == 0);
+  assert((stream = fopen("ft_client.snap", "wb")) != NULL);
+  assert(fwrite(arr, 1, l - 1, stream) == l - 1);
+  assert(fclose(stream) == 0);
+  assert((ft2 = FT_new()) != NULL);
+  assert(FT_loadIn(ft2, "ft_client.snap") == IO_ERROR);
+  assert((stream = fopen("ft_client.snap", "wb")) != NULL);
+  assert(fputs("a\na/b\n", stream) >= 0);
+  assert(fclose(stream) == 0);
+  assert(FT_loadIn(ft2, "ft_client.snap") == IO_ERROR);
+  assert(remove("ft_client.snap") == 0);
+  assert(FT_loadIn(ft2, "ft_client.snap") == IO_ERROR);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, ""));
+  free(temp);
+
+  /* So does an empty tree */
+  FT_free(ft1);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_saveIn(ft1, "ft_client.snap") == SUCCESS);
+  assert(FT_loadIn(ft2, "ft_client.snap") == SUCCESS);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, ""));
+  free(temp);
+  assert(remove("ft_client.snap") == 0);
+  FT_free(ft1);
+  FT_free(ft2);
+
+  /* A mapped image answers lookups as the tree it was saved from
+     does */
+  assert(FT_saveImage("ft_client.img") == INITIALIZATION_ERROR);
+  assert((ft1 = FT_new()) != NULL);
+  pNext = sorted;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == SUCCESS);
+  assert(FT_saveImageIn(ft1, "ft_client.img") == SUCCESS);
+  assert((image = FTImage_open("ft_client.img")) != NULL);
+  assert((temp = FTImage_toString(image)) != NULL);
+  assert(!strcmp(temp, "a\na/b-c\na/f\na/b\na/b/x\na/c\na/c/d\n"
+                 "a/c/d/e\na/c/z\n"));
+  free(temp);
+  assert(FTImage_containsDir(image, "a") == TRUE);
+  assert(FTImage_containsDir(image, "a/c/d") == TRUE);
+  assert(FTImage_containsFile(image, "a/c/d") == FALSE);
+  assert(FTImage_containsFile(image, "a/c/d/e") == TRUE);
+  assert(FTImage_containsDir(image, "a/c") == TRUE);
+  assert(FTImage_containsDir(image, "a/c/") == FALSE);
+  assert(FTImage_containsDir(image, "a//c") == FALSE);
+  assert(FTImage_containsDir(image, "") == FALSE);
+  assert(FTImage_containsDir(image, "b") == FALSE);
+  assert(FTImage_containsFile(image, "a/f/g") == FALSE);
+  assert(!strcmp(FTImage_getFileContents(image, "a/b/x"), "x"));
+  assert(!strcmp(FTImage_getFileContents(image, "a/f"), "f"));
+  assert(FTImage_getFileContents(image, "a/b-c") == NULL);
+  assert(FTImage_getFileContents(image, "a/b") == NULL);
+  assert(FTImage_stat(image, "a/b-c", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 5);
+  assert(FTImage_stat(image, "a/b", &b, &l) == SUCCESS);
+  assert(b == FALSE && l == 5);
+  assert(FTImage_stat(image, "a/b/y", &b, &l) == NO_SUCH_PATH);
+  FTImage_close(image);
+  FT_free(ft1);
+
+  /* So does an image of an empty tree, and no image means no tree */
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_saveImageIn(ft1, "ft_client.img") == SUCCESS);
+  assert((image = FTImage_open("ft_client.img")) != NULL);
+  assert((temp = FTImage_toString(image)) != NULL);
+  assert(!strcmp(temp, ""));
+  free(temp);
+  assert(FTImage_containsDir(image, "a") == FALSE);
+  FTImage_close(image);
+  FT_free(ft1);
+  assert((stream = fopen("ft_client.img", "wb")) != NULL);
+  assert(fputs("a\na/b\n", stream) >= 0);
+  assert(fclose(stream) == 0);
+  assert(FTImage_open("ft_client.img") == NULL);
+  assert(remove("ft_client.img") == 0);
+  assert(FTImage_open("ft_client.img") == NULL);
+
+  /* A rename moves a whole subtree under its new parent, re-sorting
+     only the children of the two parents, and fails like insert */
+  assert(FT_rename("a", "b") == INITIALIZATION_ERROR);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_renameIn(ft1, "a", "b") == NO_SUCH_PATH);
+  assert(FT_insertDirIn(ft1, "a/b/c") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b/c/f", "f", 2) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b/g", NULL, 0) == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/d") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/e", NULL, 1) == SUCCESS);
+  assert(FT_renameIn(ft1, "a/x", "a/y") == NO_SUCH_PATH);
+  assert(FT_renameIn(ft1, "a/b", "a/d") == ALREADY_IN_TREE);
+  assert(FT_renameIn(ft1, "a/b", "a/e") == ALREADY_IN_TREE);
+  assert(FT_renameIn(ft1, "a/b", "a/b") == ALREADY_IN_TREE);
+  assert(FT_renameIn(ft1, "a/b", "a/e/b") == NOT_A_DIRECTORY);
+  assert(FT_renameIn(ft1, "a/b", "a/x/b") == NO_SUCH_PATH);
+  assert(FT_renameIn(ft1, "a/b", "a/b/c/b") == CONFLICTING_PATH);
+  assert(FT_renameIn(ft1, "a/b", "x/b") == CONFLICTING_PATH);
+  assert(FT_renameIn(ft1, "a/b", "x") == CONFLICTING_PATH);
+  assert(FT_renameIn(ft1, "a/b", "a/d/") == CONFLICTING_PATH);
+  assert(FT_renameIn(ft1, "a/b", "a//x") == CONFLICTING_PATH);
+  assert(FT_renameIn(ft1, "a/b", "") == CONFLICTING_PATH);
+  assert(FT_renameIn(ft1, "a", "a/d/a") == CONFLICTING_PATH);
+  assert(FT_enableIndexIn(ft1) == SUCCESS);
+  assert(FT_renameIn(ft1, "a/b", "a/d/z") == SUCCESS);
+  assert(FT_renameIn(ft1, "a/e", "a/0") == SUCCESS);
+  assert(FT_renameIn(ft1, "a/d/z/g", "a/d/z/c/0") == SUCCESS);
+  assert(FT_containsDirIn(ft1, "a/b") == FALSE);
+  assert(FT_containsDirIn(ft1, "a/d/z/c") == TRUE);
+  assert(FT_containsFileIn(ft1, "a/b/c/f") == FALSE);
+  assert(FT_containsFileIn(ft1, "a/e") == FALSE);
+  assert(!strcmp(FT_getFileContentsIn(ft1, "a/d/z/c/f"), "f"));
+  assert(FT_statIn(ft1, "a/0", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 1);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "a\na/0\na/d\na/d/z\na/d/z/c\na/d/z/c/0\n"
+                 "a/d/z/c/f\n"));
+  free(temp);
+  assert(FT_renameIn(ft1, "a", "r") == SUCCESS);
+  assert(FT_containsDirIn(ft1, "a") == FALSE);
+  assert(FT_containsFileIn(ft1, "r/d/z/c/f") == TRUE);
+  assert(FT_insertDirIn(ft1, "a/b") == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft1, "r/b") == SUCCESS);
+  assert(FT_rmDirIn(ft1, "r/d") == SUCCESS);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "r\nr/0\nr/b\n"));
+  free(temp);
+  FT_free(ft1);
+
+  /* A snapshot keeps the tree as it was when taken, while the tree
+     copies what it changes; a snapshot cannot change */
+  assert(FT_snapshot() == NULL);
+  assert((ft1 = FT_new()) != NULL);
+  assert((ft2 = FT_snapshotIn(ft1)) != NULL);
+  assert(FT_insertDirIn(ft1, "a/b/c") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b/f", "f", 2) == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/d") == SUCCESS);
+  assert(FT_containsDirIn(ft2, "a") == FALSE);
+  FT_free(ft2);
+  assert(FT_enableIndexIn(ft1) == SUCCESS);
+  assert((ft2 = FT_snapshotIn(ft1)) != NULL);
+  assert(FT_insertFileIn(ft1, "a/b/g", NULL, 0) == SUCCESS);
+  assert(FT_rmDirIn(ft1, "a/d") == SUCCESS);
+  assert(!strcmp(FT_replaceFileContentsIn(ft1, "a/b/f", "F", 2), "f"));
+  assert(FT_renameIn(ft1, "a/b/c", "a/c") == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/x/y") == SUCCESS);
+  assert(FT_containsDirIn(ft1, "a/c") == TRUE);
+  assert(FT_containsDirIn(ft1, "a/x/y") == TRUE);
+  assert(FT_containsFileIn(ft1, "a/b/g") == TRUE);
+  assert(!strcmp(FT_getFileContentsIn(ft1, "a/b/f"), "F"));
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "a\na/b\na/b/f\na/b/g\na/c\na/x\na/x/y\n"));
+  free(temp);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\na/b\na/b/f\na/b/c\na/d\n"));
+  free(temp);
+  assert(FT_containsDirIn(ft2, "a/b/c") == TRUE);
+  assert(FT_containsFileIn(ft2, "a/b/g") == FALSE);
+  assert(!strcmp(FT_getFileContentsIn(ft2, "a/b/f"), "f"));
+  assert(FT_insertDirIn(ft2, "a/e") == READ_ONLY);
+  assert(FT_insertFileIn(ft2, "a/e", NULL, 0) == READ_ONLY);
+  assert(FT_rmDirIn(ft2, "a/d") == READ_ONLY);
+  assert(FT_rmFileIn(ft2, "a/b/f") == READ_ONLY);
+  assert(FT_renameIn(ft2, "a/d", "a/e") == READ_ONLY);
+  assert(FT_replaceFileContentsIn(ft2, "a/b/f", "F", 2) == NULL);
+  assert(FT_enableIndexIn(ft2) == READ_ONLY);
+  assert(FT_loadIn(ft2, "ft_client.snap") == READ_ONLY);
+  assert(FT_openJournalIn(ft2, "ft_client.jnl", 1) == READ_ONLY);
+
+  /* A snapshot of a snapshot, and a saved snapshot, match it, and
+     freeing one leaves the others whole */
+  assert((ft3 = FT_snapshotIn(ft2)) != NULL);
+  FT_free(ft2);
+  assert((ft2 = FT_snapshotIn(ft1)) != NULL);
+  assert(FT_rmDirIn(ft1, "a") == SUCCESS);
+  assert(FT_insertDirIn(ft1, "z") == SUCCESS);
+  assert(FT_saveIn(ft3, "ft_client.snap") == SUCCESS);
+  FT_free(ft3);
+  assert((ft3 = FT_new()) != NULL);
+  assert(FT_loadIn(ft3, "ft_client.snap") == SUCCESS);
+  assert((temp = FT_toStringIn(ft3)) != NULL);
+  assert(!strcmp(temp, "a\na/b\na/b/f\na/b/c\na/d\n"));
+  free(temp);
+  FT_free(ft3);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\na/b\na/b/f\na/b/g\na/c\na/x\na/x/y\n"));
+  free(temp);
+  FT_free(ft2);
+  assert(FT_insertDirIn(ft1, "z/a") == SUCCESS);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "z\nz/a\n"));
+  free(temp);
+  FT_free(ft1);
+  assert(remove("ft_client.snap") == 0);
+
+  /* Every directory keeps the totals of the hierarchy under it
+     through each kind of change, and a snapshot keeps its own */
+  assert(FT_du("a", &files, &dirs, &bytes) == INITIALIZATION_ERROR);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_duIn(ft1, "a", &files, &dirs, &bytes) == NO_SUCH_PATH);
+  pNext = sorted;
+  assert(FT_bulkLoadIn(ft1, nextRecord, &pNext) == SUCCESS);
+  assert(FT_duIn(ft1, "a", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 4 && dirs == 5 && bytes == 9);
+  assert(FT_duIn(ft1, "a/c", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 1 && dirs == 3 && bytes == 0);
+  assert(FT_duIn(ft1, "a/b/x", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 1 && dirs == 0 && bytes == 2);
+  assert(FT_insertFileIn(ft1, "a/c/d/n/o/p", NULL, 10) == SUCCESS);
+  assert(FT_duIn(ft1, "a/c", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 2 && dirs == 5 && bytes == 10);
+  assert(FT_replaceFileContentsIn(ft1, "a/b/x", NULL, 7) != NULL);
+  assert((ft2 = FT_snapshotIn(ft1)) != NULL);
+  assert(FT_renameIn(ft1, "a/c/d", "a/b/d") == SUCCESS);
+  assert(FT_duIn(ft1, "a/c", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 0 && dirs == 2 && bytes == 0);
+  assert(FT_duIn(ft1, "a/b", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 3 && dirs == 4 && bytes == 17);
+  assert(FT_duIn(ft1, "a", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 5 && dirs == 7 && bytes == 24);
+  assert(FT_rmDirIn(ft1, "a/b/d/n") == SUCCESS);
+  assert(FT_rmFileIn(ft1, "a/f") == SUCCESS);
+  assert(FT_duIn(ft1, "a/b", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 2 && dirs == 2 && bytes == 7);
+  assert(FT_duIn(ft1, "a", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 3 && dirs == 5 && bytes == 12);
+  assert(FT_duIn(ft2, "a", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 5 && dirs == 7 && bytes == 24);
+  assert(FT_duIn(ft2, "a/c", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 2 && dirs == 5 && bytes == 10);
+  FT_free(ft2);
+  assert(FT_saveIn(ft1, "ft_client.snap") == SUCCESS);
+  FT_free(ft1);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_loadIn(ft1, "ft_client.snap") == SUCCESS);
+  assert(FT_duIn(ft1, "a", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 3 && dirs == 5 && bytes == 12);
+  assert(FT_duIn(ft1, "a/b/d", &files, &dirs, &bytes) == SUCCESS);
+  assert(files == 1 && dirs == 1 && bytes == 0);
+  FT_free(ft1);
+  assert(remove("ft_client.snap") == 0);
+
+  /* A cursor lists a directory's children, or everything under it
+     to some depth, in the order of FT_toString, as they are when
+     read, and resumes after any name */
+  assert(FT_openDir("a", &dir) == INITIALIZATION_ERROR);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_openDirIn(ft1, "a", &dir) == NO_SUCH_PATH);
+  assert(FT_insertDirIn(ft1, "a/b/c/z") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/f1", "f1", 3) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b/g", NULL, 0) == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/d") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/e", NULL, 1) == SUCCESS);
+  assert(FT_openDirIn(ft1, "a/e", &dir) == NOT_A_DIRECTORY);
+  assert(FT_openDirIn(ft1, "a/x", &dir) == NO_SUCH_PATH);
+  assert(FT_openDirIn(ft1, "a", &dir) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "e") && b == TRUE && l == 1);
+  /* Only the changes after the last entry read show */
+  assert(FT_insertFileIn(ft1, "a/0", NULL, 0) == SUCCESS);
+  assert(FT_rmFileIn(ft1, "a/e") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/g", NULL, 0) == SUCCESS);
+  assert(FT_rmDirIn(ft1, "a/d") == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "f1") && b == TRUE && l == 3);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "g") && b == TRUE && l == 0);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b") && b == FALSE && l == 0);
+  assert(FT_readDir(dir, &name, &b, &l) == NO_SUCH_PATH);
+  assert(FT_readDir(dir, &name, &b, &l) == NO_SUCH_PATH);
+  assert(FT_insertFileIn(ft1, "a/e", NULL, 1) == SUCCESS);
+  assert(FT_rmFileIn(ft1, "a/g") == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/d") == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "d") && b == FALSE);
+  assert(FT_readDir(dir, &name, &b, &l) == NO_SUCH_PATH);
+  assert(FT_seekDir(dir, "b", FALSE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "d"));
+  assert(FT_seekDir(dir, "f1", TRUE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b"));
+  assert(FT_seekDir(dir, "c", FALSE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "d"));
+  assert(FT_seekDir(dir, "zz", TRUE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b"));
+  assert(FT_seekDir(dir, "", FALSE) == CONFLICTING_PATH);
+  assert(FT_seekDir(dir, "b//c", FALSE) == CONFLICTING_PATH);
+  FT_closeDir(dir);
+  assert(FT_openTreeIn(ft1, "a", 0, &dir) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "0"));
+  assert(FT_seekDir(dir, "b", FALSE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b/g") && b == TRUE);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b/c") && b == FALSE);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b/c/z"));
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "d"));
+  assert(FT_readDir(dir, &name, &b, &l) == NO_SUCH_PATH);
+  assert(FT_seekDir(dir, "b/c", FALSE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b/c/z"));
+  assert(FT_seekDir(dir, "b/a/q", FALSE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "b/c"));
+  FT_closeDir(dir);
+  assert(FT_openTreeIn(ft1, "a/b", 2, &dir) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "g"));
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "c"));
+  assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+  assert(!strcmp(name, "c/z"));
+  assert(FT_readDir(dir, &name, &b, &l) == NO_SUCH_PATH);
+  FT_closeDir(dir);
+  assert(FT_openTreeIn(ft1, "a/b", 1, &dir) == SUCCESS);
+  assert(FT_seekDir(dir, "c", FALSE) == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == NO_SUCH_PATH);
+  assert(FT_seekDir(dir, "a", FALSE) == SUCCESS);
+  assert(FT_rmDirIn(ft1, "a/b") == SUCCESS);
+  assert(FT_readDir(dir, &name, &b, &l) == NO_SUCH_PATH);
+  FT_closeDir(dir);
+  FT_closeDir(NULL);
+  FT_free(ft1);
+
+  /* A glob matches each component against the children that could
+     match it, and a prefix lists every path that starts with it, in
+     the order of FT_toString */
+  assert(FT_glob("a", appendPath, list) == INITIALIZATION_ERROR);
+  assert(FT_listPrefix("a", appendPath, list) == INITIALIZATION_ERROR);
+  assert((ft1 = FT_new()) != NULL);
+  list[0] = '\0';
+  assert(FT_globIn(ft1, "a", appendPath, list) == SUCCESS);
+  assert(FT_listPrefixIn(ft1, "", appendPath, list) == SUCCESS);
+  assert(!strcmp(list, ""));
+  assert(FT_insertDirIn(ft1, "a/b1/logs") == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/bz/logs") == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/c/logs") == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/b12/logs") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b1/logs/log.txt", NULL, 0) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b1/logs/log-2.txt", NULL, 0)
+         == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b1/logs/other.txt", NULL, 0)
+         == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/bz/logs/log.txt", NULL, 0) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/c/logs/log.txt", NULL, 0) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b12/logs/log.txt", NULL, 0) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b3", NULL, 0) == SUCCESS);
+  assert(FT_globIn(ft1, "a/b?/logs/log*.txt", appendPath, list)
+         == SUCCESS);
+  assert(!strcmp(list, "a/b1/logs/log-2.txt\na/b1/logs/log.txt\n"
+                 "a/bz/logs/log.txt\n"));
+  list[0] = '\0';
+  assert(FT_globIn(ft1, "a/*/logs", appendPath, list) == SUCCESS);
+  assert(!strcmp(list, "a/b1/logs\na/b12/logs\na/bz/logs\na/c/logs\n"));
+  list[0] = '\0';
+  assert(FT_globIn(ft1, "a/b*", appendPath, list) == SUCCESS);
+  assert(!strcmp(list, "a/b3\na/b1\na/b12\na/bz\n"));
+  list[0] = '\0';
+  assert(FT_globIn(ft1, "?", appendPath, list) == SUCCESS);
+  assert(FT_globIn(ft1, "b", appendPath, list) == SUCCESS);
+  assert(FT_globIn(ft1, "a/[!b]*/logs/*", appendPath, list) == SUCCESS);
+  assert(FT_globIn(ft1, "a/b1/logs/log\\.txt", appendPath, list)
+         == SUCCESS);
+  assert(FT_globIn(ft1, "a/[a-b]1[]/logs", appendPath, list) == SUCCESS);
+  assert(!strcmp(list, "a\na/c/logs/log.txt\na/b1/logs/log.txt\n"));
+  assert(FT_globIn(ft1, "", appendPath, list) == CONFLICTING_PATH);
+  assert(FT_globIn(ft1, "a//b", appendPath, list) == CONFLICTING_PATH);
+  list[0] = '\0';
+  assert(FT_listPrefixIn(ft1, "a/b1", appendPath, list) == SUCCESS);
+  assert(!strcmp(list, "a/b1\na/b1/logs\na/b1/logs/log-2.txt\n"
+                 "a/b1/logs/log.txt\na/b1/logs/other.txt\na/b12\n"
+                 "a/b12/logs\na/b12/logs/log.txt\n"));
+  list[0] = '\0';
+  assert(FT_listPrefixIn(ft1, "a/c/", appendPath, list) == SUCCESS);
+  assert(FT_listPrefixIn(ft1, "/a", appendPath, list) == SUCCESS);
+  assert(FT_listPrefixIn(ft1, "a/q/", appendPath, list) == SUCCESS);
+  assert(FT_listPrefixIn(ft1, "a/b3/", appendPath, list) == SUCCESS);
+  assert(FT_listPrefixIn(ft1, "a//", appendPath, list) == SUCCESS);
+  assert(!strcmp(list, "a/c/logs\na/c/logs/log.txt\n"));
+  list[0] = '\0';
+  assert(FT_listPrefixIn(ft1, "", appendPath, list) == SUCCESS);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(list, temp));
+  free(temp);
+  FT_free(ft1);
+
+  /* A journal replays every change made since it was opened, and
+     later ones, after compaction, on top of the snapshot */
+  assert(FT_openJournal("ft_client.jnl", 1) == INITIALIZATION_ERROR);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_openJournalIn(ft1, "ft_client.jnl", 1) == SUCCESS);
+  assert(FT_openJournalIn(ft1, "ft_client.jnl", 1) == CONFLICTING_PATH);
+  assert(FT_insertDirIn(ft1, "a/b") == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/b/f", "hi", 3) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/g", NULL, 2) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/g", NULL, 2) == ALREADY_IN_TREE);
+  assert(FT_replaceFileContentsIn(ft1, "a/b/f", "yo!", 4) != NULL);
+  assert(FT_insertDirIn(ft1, "a/c/d") == SUCCESS);
+  assert(FT_rmDirIn(ft1, "a/c") == SUCCESS);
+  assert(FT_rmFileIn(ft1, "a/g") == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/m") == SUCCESS);
+  assert(FT_renameIn(ft1, "a/m", "a/b/m") == SUCCESS);
+  assert(FT_rmDirIn(ft1, "a/b/m") == SUCCESS);
+  assert(FT_syncJournalIn(ft1) == SUCCESS);
+  assert((ft2 = FT_new()) != NULL);
+  assert(FT_openJournalIn(ft2, "ft_client.jnl", 1) == SUCCESS);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\na/b\na/b/f\n"));
+  free(temp);
+  assert(FT_statIn(ft2, "a/b/f", &b, &l) == SUCCESS);
+  assert(b == TRUE && l == 4);
+  assert(!strcmp(FT_getFileContentsIn(ft2, "a/b/f"), "yo!"));
+  assert(FT_closeJournalIn(ft2) == SUCCESS);
+  FT_free(ft2);
+  assert(FT_compactJournalIn(ft1) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/h", "h", 2) == SUCCESS);
+  assert(FT_closeJournalIn(ft1) == SUCCESS);
+  assert(FT_closeJournalIn(ft1) == SUCCESS);
+  assert(FT_insertFileIn(ft1, "a/i", NULL, 0) == SUCCESS);
+
+  /* A record cut short by a crash is dropped, and a tree that is not
+     empty cannot take on a journal's state */
+  assert((stream = fopen("ft_client.jnl", "ab")) != NULL);
+  assert(fputs("torn", stream) >= 0);
+  assert(fclose(stream) == 0);
+  assert((ft2 = FT_new()) != NULL);
+  assert(FT_insertDirIn(ft2, "a") == SUCCESS);
+  assert(FT_openJournalIn(ft2, "ft_client.jnl", 8) == CONFLICTING_PATH);
+  FT_free(ft2);
+  assert((ft2 = FT_new()) != NULL);
+  assert(FT_openJournalIn(ft2, "ft_client.jnl", 8) == SUCCESS);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\na/h\na/b\na/b/f\n"));
+  free(temp);
+  assert(!strcmp(FT_getFileContentsIn(ft2, "a/h"), "h"));
+
+  /* Changes in a group not yet synced are written when the tree is
+     freed, and a tree that already has nodes is compacted into the
+     journal it opens */
+  assert(FT_rmFileIn(ft2, "a/h") == SUCCESS);
+  FT_free(ft2);
+  assert((ft2 = FT_new()) != NULL);
+  assert(FT_openJournalIn(ft2, "ft_client.jnl", 1) == SUCCESS);
+  assert((temp = FT_toStringIn(ft2)) != NULL);
+  assert(!strcmp(temp, "a\na/b\na/b/f\n"));
+  free(temp);
+  FT_free(ft2);
+  assert(remove("ft_client.jnl") == 0);
+  assert(FT_openJournalIn(ft1, "ft_client.jnl", 1) == SUCCESS);
+  FT_free(ft1);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_openJournalIn(ft1, "ft_client.jnl", 1) == SUCCESS);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "a\na/h\na/i\na/b\na/b/f\n"));
+  free(temp);
+  FT_free(ft1);
+  assert(remove("ft_client.jnl") == 0);
+  assert(remove("ft_client.jnl.snap1") == 0);
+
+  /* A change whose record cannot be synced is not made, and every
+     later one that would succeed fails too, as on a full disk */
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_openJournalIn(ft1, "ft_client.jnl", 1) == SUCCESS);
+  assert(FT_insertDirIn(ft1, "a/b") == SUCCESS);
+  assert((stream = fopen("ft_client.jnl", "rb")) != NULL);
+  assert(fseek(stream, 0, SEEK_END) == 0);
+  assert(getrlimit(RLIMIT_FSIZE, &saved) == 0);
+  limit = saved;
+  limit.rlim_cur = (rlim_t)ftell(stream);
+  fclose(stream);
+  assert(signal(SIGXFSZ, SIG_IGN) != SIG_ERR);
+  assert(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+  assert(FT_insertFileIn(ft1, "a/f", "hi", 3) == IO_ERROR);
+  assert(setrlimit(RLIMIT_FSIZE, &saved) == 0);
+  assert(signal(SIGXFSZ, SIG_DFL) != SIG_ERR);
+  assert(FT_containsFileIn(ft1, "a/f") == FALSE);
+  assert(FT_insertDirIn(ft1, "a/c") == IO_ERROR);
+  assert(FT_containsDirIn(ft1, "a/c") == FALSE);
+  /* An insert that cannot succeed says why, not IO_ERROR */
+  assert(FT_insertDirIn(ft1, "a/b") == ALREADY_IN_TREE);
+  assert(FT_insertFileIn(ft1, "a//f", NULL, 0) == CONFLICTING_PATH);
+  assert(FT_insertFileIn(ft1, "x", NULL, 0) == CONFLICTING_PATH);
+  assert(FT_syncJournalIn(ft1) == IO_ERROR);
+  assert(FT_closeJournalIn(ft1) == IO_ERROR);
+  FT_free(ft1);
+  assert((ft1 = FT_new()) != NULL);
+  assert(FT_openJournalIn(ft1, "ft_client.jnl", 1) == SUCCESS);
+  assert((temp = FT_toStringIn(ft1)) != NULL);
+  assert(!strcmp(temp, "a\na/b\n"));
+  free(temp);
+  FT_free(ft1);
+  assert(remove("ft_client.jnl") == 0);
+
+#ifdef FT_STATS
+  /* Every call is counted under its entry point, snapshots' refusals
+     included, with the nodes each lookup and walk visits */
+  {
+    struct ftStats *pStats = malloc(sizeof(struct ftStats));
+
+    assert(pStats != NULL);
+    FT_resetStats();
+    assert((ft1 = FT_new()) != NULL);
+    assert(FT_insertDirIn(ft1, "s") == SUCCESS);
+    assert(FT_insertFileIn(ft1, "s/a", NULL, 3) == SUCCESS);
+    assert(FT_insertFileIn(ft1, "s/b", NULL, 4) == SUCCESS);
+    assert(FT_containsFileIn(ft1, "s/a") == TRUE);
+    assert(FT_rmFileIn(ft1, "s/x") == NO_SUCH_PATH);
+    assert((ft2 = FT_snapshotIn(ft1)) != NULL);
+    assert(FT_insertDirIn(ft2, "s/c") == READ_ONLY);
+    assert((temp = FT_toStringIn(ft1)) != NULL);
+    free(temp);
+    FT_getStats(pStats);
+    assert(pStats->latency[FT_OP_INSERT_DIR].count == 2);
+    assert(pStats->latency[FT_OP_INSERT_FILE].count == 2);
+    assert(pStats->latency[FT_OP_CONTAINS_FILE].count == 1);
+    assert(pStats->latency[FT_OP_RM_FILE].count == 1);
+    assert(pStats->latency[FT_OP_TO_STRING].count == 1);
+    assert(pStats->latency[FT_OP_STAT].count == 0);
+    assert(FT_getPercentile(&pStats->latency[FT_OP_INSERT_FILE], 100)
+           == pStats->latency[FT_OP_INSERT_FILE].max);
+    /* The first insert finds no root; the others walk down from it */
+    assert(pStats->pathVisits.count == 5);
+    assert(pStats->pathVisits.sum == 5 && pStats->pathVisits.max == 2);
+    assert(FT_getPercentile(&pStats->pathVisits, 50) == 1);
+    assert(FT_getPercentile(&pStats->pathVisits, 100) == 2);
+    /* toString walks the tree twice */
+    assert(pStats->walkVisits.count == 2);
+    assert(pStats->walkVisits.sum == 6);
+    assert(pStats->grows >= 1);
+    assert(pStats->latency[FT_OP_SNAPSHOT].count == 1);
+    /* FT_openDir counts as FT_openTree */
+    assert(FT_openDirIn(ft1, "s", &dir) == SUCCESS);
+    assert(FT_readDir(dir, &name, &b, &l) == SUCCESS);
+    FT_closeDir(dir);
+    FT_getStats(pStats);
+    assert(pStats->latency[FT_OP_OPEN_TREE].count == 1);
+    assert(pStats->latency[FT_OP_READ_DIR].count == 1);
+    assert((stream = tmpfile()) != NULL);
+    assert(FT_writeStats(stream) == SUCCESS);
+    assert(!ferror(stream));
+    fclose(stream);
+    FT_free(ft2);
+    FT_free(ft1);
+
+    FT_resetStats();
+    FT_getStats(pStats);
+    assert(pStats->latency[FT_OP_INSERT_DIR].count == 0);
+    assert(pStats->pathVisits.count == 0 && pStats->grows == 0);
+    free(pStats);
+  }
+#endif
+
   return 0;
 }
 
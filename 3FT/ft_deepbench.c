@@ -0,0 +1,197 @@
+/*--------------------------------------------------------------------*/
+/* ft_deepbench.c                                                     */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "ft.h"
+
+/* Default number of nodes in each shape of tree */
+enum { DEFAULT_NODES = 1000000 };
+
+/* Longest path of a file in the wide tree, including the '\0' */
+enum { MAX_PATH = 64 };
+
+/* Number of times the whole of each tree is moved and moved back */
+enum { RENAMES = 1000 };
+
+/* Number of entries in each page of a paged listing */
+enum { PAGE = 100 };
+
+/*
+   Prints one result line for a phase over nodes nodes that started at
+   clock start.
+*/
+static void Bench_report(const char *shape, const char *phase,
+                         size_t nodes, clock_t start) {
+   double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   printf("%-6s %-12s %10lu nodes %10.3f s %12.0f nodes/s\n", shape,
+          phase, (unsigned long) nodes, seconds,
+          seconds > 0 ? nodes / seconds : 0.0);
+}
+
+/* Counts one node for FT_mapIn into the size_t at pvCount. */
+static void Bench_count(const char *path, size_t length, void *pvCount) {
+   (void) length;
+   assert(path != NULL);
+   assert(pvCount != NULL);
+   (*(size_t *) pvCount)++;
+}
+
+/*
+   Times a walk over ft with FT_mapIn, moving top, which holds nodes
+   nodes, away and back RENAMES times, reading the totals of top as
+   many times, the indexing of ft, and the removal of top; shape names
+   the tree.
+*/
+static void Bench_walkAndDestroy(FT_T ft, const char *shape,
+                                 char *top, size_t nodes) {
+   char moved[MAX_PATH];
+   clock_t start;
+   double seconds;
+   size_t count = 0;
+   size_t files;
+   size_t dirs;
+   size_t bytes;
+   size_t i;
+
+   start = clock();
+   assert(FT_mapIn(ft, Bench_count, &count) == SUCCESS);
+   assert(count == nodes + 1);
+   Bench_report(shape, "map", count, start);
+
+   /* Without the index, a move costs the same at any size of tree */
+   sprintf(moved, "%s-moved", top);
+   start = clock();
+   for(i = 0; i < RENAMES; i++) {
+      assert(FT_renameIn(ft, top, moved) == SUCCESS);
+      assert(FT_renameIn(ft, moved, top) == SUCCESS);
+   }
+   seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+   printf("%-6s %-12s %10lu moves %10.3f s %12.0f moves/s\n", shape,
+          "rename", (unsigned long) (2 * RENAMES), seconds,
+          seconds > 0 ? 2 * RENAMES / seconds : 0.0);
+
+   /* The totals are kept as the tree changes, so reading them does
+      not depend on the size of the tree either */
+   start = clock();
+   for(i = 0; i < RENAMES; i++)
+      assert(FT_duIn(ft, top, &files, &dirs, &bytes) == SUCCESS);
+   seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+   assert(files + dirs == nodes && bytes == 0);
+   printf("%-6s %-12s %10lu calls %10.3f s %12.0f calls/s\n", shape,
+          "du", (unsigned long) RENAMES, seconds,
+          seconds > 0 ? RENAMES / seconds : 0.0);
+
+   start = clock();
+   assert(FT_enableIndexIn(ft) == SUCCESS);
+   Bench_report(shape, "enableIndex", count, start);
+
+   start = clock();
+   assert(FT_rmDirIn(ft, top) == SUCCESS);
+   Bench_report(shape, "rmDir", nodes, start);
+}
+
+/*
+   Times listing the entries of dir, of which there are nodes, in ft
+   with one cursor, and then a page of PAGE entries at a time, each
+   from a newly opened cursor moved past the last entry of the page
+   before, as a client that holds no cursor between pages would.
+*/
+static void Bench_list(FT_T ft, char *dir, size_t nodes) {
+   char last[MAX_PATH];
+   const char *name;
+   boolean isFile;
+   size_t length;
+   FTDir_T cursor;
+   clock_t start;
+   size_t count = 0;
+   size_t page;
+
+   start = clock();
+   assert(FT_openDirIn(ft, dir, &cursor) == SUCCESS);
+   while(FT_readDir(cursor, &name, &isFile, &length) == SUCCESS)
+      count++;
+   FT_closeDir(cursor);
+   assert(count == nodes);
+   Bench_report("wide", "readDir", count, start);
+
+   start = clock();
+   count = 0;
+   do {
+      assert(FT_openDirIn(ft, dir, &cursor) == SUCCESS);
+      if(count > 0)
+         assert(FT_seekDir(cursor, last, TRUE) == SUCCESS);
+      for(page = 0; page < PAGE &&
+          FT_readDir(cursor, &name, &isFile, &length) == SUCCESS; page++)
+         count++;
+      if(page > 0)
+         strcpy(last, name);
+      FT_closeDir(cursor);
+   } while(page == PAGE);
+   assert(count == nodes);
+   Bench_report("wide", "pagedRead", count, start);
+}
+
+/*
+   Builds two trees of argv[1] nodes below a root directory: a chain
+   of directories each inside the last, and one directory holding
+   that many files. For each, times the insert, a walk over the tree,
+   moving all of it with FT_renameIn, reading its totals with FT_duIn,
+   building its path index, and removing all of it with FT_rmDirIn,
+   then frees it. Also times listing the files, whole and in pages.
+   Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   size_t nodes = DEFAULT_NODES;
+   char path[MAX_PATH];
+   char *chain;
+   clock_t start;
+   size_t i;
+   FT_T ft;
+
+   if(argc > 1)
+      nodes = (size_t) strtoul(argv[1], NULL, 10);
+   if(nodes == 0)
+      nodes = 1;
+
+   /* The chain "deep/d/d/.../d", inserted in one call */
+   chain = malloc(sizeof("deep") + 2 * nodes);
+   assert(chain != NULL);
+   strcpy(chain, "deep");
+   for(i = 0; i < nodes; i++)
+      memcpy(chain + sizeof("deep") - 1 + 2 * i, "/d", 2);
+   chain[sizeof("deep") - 1 + 2 * nodes] = '\0';
+
+   assert((ft = FT_new()) != NULL);
+   start = clock();
+   assert(FT_insertDirIn(ft, chain) == SUCCESS);
+   Bench_report("chain", "insertDir", nodes, start);
+   start = clock();
+   assert(FT_containsDirIn(ft, chain) == TRUE);
+   Bench_report("chain", "containsDir", nodes, start);
+   Bench_walkAndDestroy(ft, "chain", "deep/d", nodes);
+   FT_free(ft);
+   free(chain);
+
+   /* The files "wide/w/f0000000" on, named so that each is appended */
+   assert((ft = FT_new()) != NULL);
+   assert(FT_insertDirIn(ft, "wide/w") == SUCCESS);
+   start = clock();
+   for(i = 0; i < nodes; i++) {
+      sprintf(path, "wide/w/f%07lu", (unsigned long) i);
+      assert(FT_insertFileIn(ft, path, NULL, 0) == SUCCESS);
+   }
+   Bench_report("wide", "insertFile", nodes, start);
+   Bench_list(ft, "wide/w", nodes);
+   Bench_walkAndDestroy(ft, "wide", "wide/w", nodes + 1);
+   FT_free(ft);
+
+   return 0;
+}
@@ -0,0 +1,470 @@
+/*--------------------------------------------------------------------*/
+/* ft_fuzz.c                                                          */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for popen, pclose, getopt and getpid under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "a4def.h"
+#include "trace.h"
+
+/*
+   Paths have up to MAX_DEPTH components, each one of the first NAMES
+   letters, so that random calls keep meeting the same few nodes, and
+   contents are up to MAX_CONTENTS bytes long.
+*/
+enum { MAX_DEPTH = 3, NAMES = 3, MAX_CONTENTS = 16 };
+
+/* The number of paths there are of that shape: 3 + 9 + 27 */
+enum { PATHS = NAMES + NAMES * NAMES + NAMES * NAMES * NAMES };
+
+/* A line of ft_replay -p output is never longer than this */
+enum { MAX_LINE = 128 };
+
+/*
+   How often each operation is generated, in the order of enum
+   TraceOp. init and destroy are rare so that the trees grow, but
+   they do come, so that calls on a tree that is not initialized are
+   compared too.
+*/
+static const unsigned weights[TRACE_OPS] = {
+   2, 1, 20, 6, 8, 20, 6, 8, 6, 6, 10, 6
+};
+
+static char paths[PATHS][2 * MAX_DEPTH];
+
+/* What one call returned, as a line of ft_replay -p output */
+struct fuzzResult {
+   int result;
+   int isFile;
+   unsigned long length;
+   unsigned long hash;
+};
+
+/*
+   What running a trace in one implementation gave: the results of
+   its calls, how many there were, the time they took, and whether
+   the program failed or was cut short.
+*/
+struct fuzzRun {
+   struct fuzzResult *results;
+   size_t calls;
+   unsigned long ns;
+   boolean failed;
+};
+
+/* The programs that run traces against each implementation, and the
+   file the traces are written to for them */
+static const char *reference;
+static const char *tested;
+static char scratch[64];
+
+/* Returns a pseudo-random number from 0 to 32767, and advances the
+   generator whose state is *pState. */
+static unsigned Fuzz_random(unsigned long *pState) {
+   assert(pState != NULL);
+
+   *pState = (*pState * 1103515245UL + 12345UL) & 0xffffffffUL;
+   return (unsigned) (*pState >> 16) & 0x7fff;
+}
+
+/* Fills paths with every path of up to MAX_DEPTH components. */
+static void Fuzz_makePaths(void) {
+   size_t p = 0;
+   size_t depth;
+   size_t i;
+   size_t n;
+   size_t k;
+   size_t count = NAMES;
+
+   for(depth = 1; depth <= MAX_DEPTH; depth++) {
+      for(i = 0; i < count; i++) {
+         n = i;
+         for(k = depth; k > 0; k--) {
+            paths[p][2 * k - 2] = (char) ('a' + n % NAMES);
+            paths[p][2 * k - 1] = k == depth ? '\0' : '/';
+            n /= NAMES;
+         }
+         p++;
+      }
+      count *= NAMES;
+   }
+   assert(p == PATHS);
+}
+
+/*
+   Fills the calls records with a random sequence of calls drawn with
+   the generator whose state is *pState, the first of which is
+   FT_init.
+*/
+static void Fuzz_generate(struct TraceRecord *records, size_t calls,
+                          unsigned long *pState) {
+   unsigned total = 0;
+   unsigned pick;
+   size_t i;
+   int op;
+
+   assert(records != NULL);
+   assert(pState != NULL);
+
+   for(op = 0; op < TRACE_OPS; op++)
+      total += weights[op];
+
+   for(i = 0; i < calls; i++) {
+      memset(&records[i], 0, sizeof(records[i]));
+      pick = Fuzz_random(pState) % total;
+      for(op = 0; pick >= weights[op]; op++)
+         pick -= weights[op];
+      records[i].eOp = i == 0 ? TRACE_INIT : (enum TraceOp) op;
+
+      if(records[i].eOp != TRACE_INIT &&
+         records[i].eOp != TRACE_DESTROY &&
+         records[i].eOp != TRACE_TO_STRING)
+         records[i].pcPath = paths[Fuzz_random(pState) % PATHS];
+      if(records[i].eOp == TRACE_INSERT_FILE ||
+         records[i].eOp == TRACE_REPLACE) {
+         records[i].bHasContents = Fuzz_random(pState) % 8 != 0;
+         records[i].uLength = Fuzz_random(pState) % (MAX_CONTENTS + 1);
+      }
+   }
+}
+
+/* Writes the calls records to a trace in the file named file.
+   Returns TRUE if it was written, and FALSE otherwise. */
+static boolean Fuzz_write(const char *file,
+                          const struct TraceRecord *records,
+                          size_t calls) {
+   Trace_T trace;
+   size_t i;
+   int status;
+
+   assert(file != NULL);
+   assert(records != NULL);
+
+   if(Trace_create(file, &trace) != SUCCESS)
+      return FALSE;
+   for(i = 0; i < calls; i++)
+      (void) Trace_append(trace, &records[i]);
+   status = Trace_close(trace);
+   return status == SUCCESS;
+}
+
+/*
+   Runs the trace in scratch through program, which is ft_replay -p
+   linked with one implementation, and stores what it printed into
+   *pRun.
+*/
+static void Fuzz_run(const char *program, struct fuzzRun *pRun) {
+   char line[MAX_LINE];
+   char *command;
+   struct fuzzResult result;
+   struct fuzzResult *grown;
+   size_t size = 0;
+   FILE *output;
+
+   assert(program != NULL);
+   assert(pRun != NULL);
+
+   pRun->results = NULL;
+   pRun->calls = 0;
+   pRun->ns = 0;
+   pRun->failed = TRUE;
+
+   command = malloc(strlen(program) + strlen(scratch) + 5);
+   assert(command != NULL);
+   sprintf(command, "%s -p %s", program, scratch);
+   output = popen(command, "r");
+   free(command);
+   if(output == NULL)
+      return;
+
+   while(fgets(line, sizeof(line), output) != NULL) {
+      if(sscanf(line, "time %lu", &pRun->ns) == 1)
+         pRun->failed = FALSE;
+      else if(sscanf(line, "%d %d %lu %lx", &result.result,
+                     &result.isFile, &result.length,
+                     &result.hash) == 4) {
+         if(pRun->calls == size) {
+            size = size == 0 ? 64 : 2 * size;
+            grown = realloc(pRun->results, size * sizeof(*grown));
+            assert(grown != NULL);
+            pRun->results = grown;
+         }
+         pRun->results[pRun->calls++] = result;
+      }
+   }
+   if(pclose(output) != 0)
+      pRun->failed = TRUE;
+}
+
+/* Returns TRUE if pA and pB are the same result, and FALSE
+   otherwise. */
+static boolean Fuzz_same(const struct fuzzResult *pA,
+                         const struct fuzzResult *pB) {
+   assert(pA != NULL);
+   assert(pB != NULL);
+
+   return pA->result == pB->result && pA->isFile == pB->isFile &&
+          pA->length == pB->length && pA->hash == pB->hash;
+}
+
+/*
+   Returns the index of the first of calls calls whose results in
+   *pReference and *pTested differ, 0 if either program failed, or
+   calls if they agree on every call.
+*/
+static size_t Fuzz_firstDifference(const struct fuzzRun *pReference,
+                                   const struct fuzzRun *pTested,
+                                   size_t calls) {
+   size_t i;
+
+   assert(pReference != NULL);
+   assert(pTested != NULL);
+
+   if(pReference->failed || pTested->failed ||
+      pReference->calls != calls || pTested->calls != calls)
+      return 0;
+   for(i = 0; i < calls; i++)
+      if(!Fuzz_same(&pReference->results[i], &pTested->results[i]))
+         return i;
+   return calls;
+}
+
+/*
+   Runs the calls records through both programs, storing what they
+   printed into *pReference and *pTested, whose results the caller
+   must free.
+   Returns TRUE if the implementations disagree, and FALSE otherwise.
+*/
+static boolean Fuzz_diverges(const struct TraceRecord *records,
+                             size_t calls, struct fuzzRun *pReference,
+                             struct fuzzRun *pTested) {
+   assert(records != NULL);
+   assert(pReference != NULL);
+   assert(pTested != NULL);
+
+   if(!Fuzz_write(scratch, records, calls)) {
+      fprintf(stderr, "ft_fuzz: cannot write %s\n", scratch);
+      exit(EXIT_FAILURE);
+   }
+   Fuzz_run(reference, pReference);
+   Fuzz_run(tested, pTested);
+   return Fuzz_firstDifference(pReference, pTested, calls) < calls;
+}
+
+/*
+   Shrinks the *pCalls calls records, on which the implementations
+   disagree, to a sequence on which they still do and from which no
+   single call can be removed: drops the calls after the first
+   difference, then tries removing runs of calls, halving the length
+   of the runs each time none of them can be removed.
+*/
+static void Fuzz_minimize(struct TraceRecord *records, size_t *pCalls) {
+   struct TraceRecord *candidate;
+   struct fuzzRun ref;
+   struct fuzzRun test;
+   size_t calls = *pCalls;
+   size_t chunk;
+   size_t start;
+   size_t end;
+   size_t first;
+   boolean removed;
+
+   assert(records != NULL);
+   assert(pCalls != NULL);
+
+   (void) Fuzz_diverges(records, calls, &ref, &test);
+   first = Fuzz_firstDifference(&ref, &test, calls);
+   if(!ref.failed && !test.failed && first + 1 < calls)
+      calls = first + 1;
+   free(ref.results);
+   free(test.results);
+
+   candidate = calloc(calls, sizeof(struct TraceRecord));
+   assert(candidate != NULL);
+
+   for(chunk = calls / 2; chunk > 0; chunk /= 2) {
+      do {
+         removed = FALSE;
+         for(start = 0; start < calls; ) {
+            end = start + chunk < calls ? start + chunk : calls;
+            memcpy(candidate, records, start * sizeof(*records));
+            memcpy(candidate + start, records + end,
+                   (calls - end) * sizeof(*records));
+            if(calls - (end - start) > 0 &&
+               Fuzz_diverges(candidate, calls - (end - start), &ref,
+                             &test)) {
+               calls -= end - start;
+               memcpy(records, candidate, calls * sizeof(*records));
+               removed = TRUE;
+            }
+            else
+               start = end;
+            free(ref.results);
+            free(test.results);
+         }
+      } while(removed && chunk == 1);
+   }
+   free(candidate);
+   *pCalls = calls;
+}
+
+/*
+   Writes the calls records, with what the reference returned from
+   each, to a trace in the file named file that ft_replay can replay,
+   and prints them with what each implementation returned.
+*/
+static void Fuzz_report(struct TraceRecord *records, size_t calls,
+                        const char *file) {
+   struct fuzzRun ref;
+   struct fuzzRun test;
+   size_t i;
+
+   assert(records != NULL);
+   assert(file != NULL);
+
+   (void) Fuzz_diverges(records, calls, &ref, &test);
+   for(i = 0; i < calls && i < ref.calls; i++) {
+      records[i].iResult = ref.results[i].result;
+      if(records[i].eOp == TRACE_STAT ||
+         records[i].eOp == TRACE_TO_STRING) {
+         records[i].bIsFile = (boolean) ref.results[i].isFile;
+         records[i].uLength = (size_t) ref.results[i].length;
+      }
+   }
+
+   printf("ft_fuzz: %s and %s disagree on these %lu calls, "
+          "written to %s\n", reference, tested, (unsigned long) calls,
+          file);
+   if(ref.failed)
+      printf("ft_fuzz: %s failed\n", reference);
+   if(test.failed)
+      printf("ft_fuzz: %s failed\n", tested);
+   for(i = 0; i < calls; i++) {
+      printf("%4lu %s(%s", (unsigned long) i,
+             Trace_getName(records[i].eOp),
+             records[i].pcPath != NULL ? records[i].pcPath : "");
+      if(records[i].eOp == TRACE_INSERT_FILE ||
+         records[i].eOp == TRACE_REPLACE)
+         printf("%s%s, %lu", records[i].pcPath != NULL ? ", " : "",
+                records[i].bHasContents ? "contents" : "NULL",
+                (unsigned long) records[i].uLength);
+      printf(")");
+      if(i < ref.calls && i < test.calls) {
+         printf(" returned %d and %d", ref.results[i].result,
+                test.results[i].result);
+         if(!Fuzz_same(&ref.results[i], &test.results[i]))
+            printf(", results differ");
+      }
+      printf("\n");
+   }
+   free(ref.results);
+   free(test.results);
+
+   if(!Fuzz_write(file, records, calls))
+      fprintf(stderr, "ft_fuzz: cannot write %s\n", file);
+}
+
+/* Prints how to run ft_fuzz to stderr and exits with failure. */
+static void Fuzz_usage(const char *program) {
+   fprintf(stderr, "usage: %s [-s seed] [-r runs] [-n calls] "
+           "[-o repro] reference tested\n", program);
+   exit(EXIT_FAILURE);
+}
+
+/*
+   Differential fuzzing of two implementations of the file tree. The
+   last two arguments are ft_replay linked with each of them, such as
+   sampleft_replay and ft_replay; the symbols of two implementations
+   clash, so each runs in a process of its own. Each of the runs, 100
+   by default, generates a random sequence of calls, 1000 by default,
+   starting with seed, 1 by default, for the first run and counting
+   up, and runs it through both. Their results and FT_toString's
+   strings must match. At the first divergence, the sequence is
+   shrunk to a short one that still diverges, which is printed and
+   written as a trace to repro, ft_fuzz.trace by default, for
+   ft_replay to replay. Prints the throughput of each implementation
+   over the runs that agreed.
+   Returns 0 if every run agreed, and exits with failure otherwise.
+*/
+int main(int argc, char *argv[]) {
+   const char *repro = "ft_fuzz.trace";
+   struct TraceRecord *records;
+   struct fuzzRun ref;
+   struct fuzzRun test;
+   unsigned long seed = 1;
+   unsigned long state;
+   unsigned long refNs = 0;
+   unsigned long testNs = 0;
+   unsigned long done = 0;
+   size_t runs = 100;
+   size_t calls = 1000;
+   size_t run;
+   boolean diverged = FALSE;
+   int c;
+
+   while((c = getopt(argc, argv, "s:r:n:o:")) != -1) {
+      switch(c) {
+         case 's':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+         case 'r':
+            runs = (size_t) strtoul(optarg, NULL, 10);
+            break;
+         case 'n':
+            calls = (size_t) strtoul(optarg, NULL, 10);
+            break;
+         case 'o':
+            repro = optarg;
+            break;
+         default:
+            Fuzz_usage(argv[0]);
+      }
+   }
+   if(optind != argc - 2 || calls == 0)
+      Fuzz_usage(argv[0]);
+   reference = argv[optind];
+   tested = argv[optind + 1];
+   sprintf(scratch, "ft_fuzz.%ld.tmp", (long) getpid());
+
+   Fuzz_makePaths();
+   records = calloc(calls, sizeof(struct TraceRecord));
+   assert(records != NULL);
+
+   for(run = 0; run < runs && !diverged; run++) {
+      state = seed + run;
+      Fuzz_generate(records, calls, &state);
+      diverged = Fuzz_diverges(records, calls, &ref, &test);
+      if(!diverged) {
+         refNs += ref.ns;
+         testNs += test.ns;
+         done += calls;
+      }
+      free(ref.results);
+      free(test.results);
+      if(diverged) {
+         printf("ft_fuzz: run with seed %lu diverges\n", seed + run);
+         Fuzz_minimize(records, &calls);
+         Fuzz_report(records, calls, repro);
+      }
+   }
+   (void) remove(scratch);
+   free(records);
+
+   printf("%-18s %lu calls in %.3f s, %.0f calls/s\n", reference, done,
+          (double) refNs / 1e9,
+          refNs > 0 ? (double) done * 1e9 / (double) refNs : 0.0);
+   printf("%-18s %lu calls in %.3f s, %.0f calls/s\n", tested, done,
+          (double) testNs / 1e9,
+          testNs > 0 ? (double) done * 1e9 / (double) testNs : 0.0);
+   if(diverged)
+      exit(EXIT_FAILURE);
+   return 0;
+}
@@ -0,0 +1,146 @@
+/*--------------------------------------------------------------------*/
+/* ft_globbench.c                                                     */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for fnmatch under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <fnmatch.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "ft.h"
+
+/* Default number of top directories, and files in each of their two
+   subdirectories, which makes about a million nodes */
+enum { DEFAULT_DIRS = 1000, FILES = 500 };
+
+/* Longest path the bench generates, including the '\0' */
+enum { MAX_PATH = 64 };
+
+/* Number of times each query is run */
+enum { REPEATS = 5 };
+
+/* The queries: a glob pattern, or a prefix if isPrefix is TRUE */
+static const struct {
+   const char *query;
+   boolean isPrefix;
+} queries[] = {
+   { "bench/d0042/logs/*.txt", FALSE },
+   { "bench/d00*/logs/f00?.txt", FALSE },
+   { "bench/*/logs/f000.txt", FALSE },
+   { "bench/*/*/f[0-4]99.*", FALSE },
+   { "bench/d0042/", TRUE },
+   { "bench/d01", TRUE }
+};
+
+/* Counts one match into the size_t at pvCount. */
+static void Bench_count(const char *path, size_t length, void *pvCount) {
+   (void) length;
+   assert(path != NULL);
+   assert(pvCount != NULL);
+   (*(size_t *) pvCount)++;
+}
+
+/*
+   Returns the number of lines of listing, as FT_toStringIn writes
+   it, that match query, a glob pattern, or a prefix if isPrefix is
+   TRUE, as a client would find them without FT_globIn. Changes the
+   newlines of listing to '\0's.
+*/
+static size_t Bench_filter(char *listing, const char *query,
+                           boolean isPrefix) {
+   size_t count = 0;
+   size_t length = strlen(query);
+   char *line;
+   char *end;
+
+   assert(listing != NULL);
+   assert(query != NULL);
+
+   for(line = listing; *line != '\0'; line = end + 1) {
+      end = strchr(line, '\n');
+      assert(end != NULL);
+      *end = '\0';
+      if(isPrefix ? !strncmp(line, query, length)
+                  : !fnmatch(query, line, FNM_PATHNAME))
+         count++;
+   }
+   return count;
+}
+
+/*
+   Builds a tree of argv[1] directories, each holding a logs and a
+   data directory of FILES files, and times each query run with
+   FT_globIn or FT_listPrefixIn against dumping the tree with
+   FT_toStringIn and filtering the lines, checking that both find
+   the same paths.
+   Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   size_t dirs = DEFAULT_DIRS;
+   char path[MAX_PATH];
+   char *listing;
+   clock_t start;
+   double direct;
+   double dumped;
+   size_t matches;
+   size_t filtered;
+   size_t q;
+   size_t d;
+   size_t f;
+   size_t r;
+   FT_T ft;
+
+   if(argc > 1)
+      dirs = (size_t) strtoul(argv[1], NULL, 10);
+
+   assert((ft = FT_new()) != NULL);
+   assert(FT_insertDirIn(ft, "bench") == SUCCESS);
+   for(d = 0; d < dirs; d++)
+      for(f = 0; f < FILES; f++) {
+         sprintf(path, "bench/d%04lu/logs/f%03lu.txt", (unsigned long) d,
+                 (unsigned long) f);
+         assert(FT_insertFileIn(ft, path, NULL, 0) == SUCCESS);
+         sprintf(path, "bench/d%04lu/data/f%03lu.bin", (unsigned long) d,
+                 (unsigned long) f);
+         assert(FT_insertFileIn(ft, path, NULL, 0) == SUCCESS);
+      }
+   printf("%lu nodes\n", (unsigned long) (1 + dirs * (3 + 2 * FILES)));
+
+   for(q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+      start = clock();
+      for(r = 0; r < REPEATS; r++) {
+         matches = 0;
+         if(queries[q].isPrefix)
+            assert(FT_listPrefixIn(ft, (char *) queries[q].query,
+                                   Bench_count, &matches) == SUCCESS);
+         else
+            assert(FT_globIn(ft, (char *) queries[q].query,
+                             Bench_count, &matches) == SUCCESS);
+      }
+      direct = (double) (clock() - start) / CLOCKS_PER_SEC / REPEATS;
+
+      start = clock();
+      for(r = 0; r < REPEATS; r++) {
+         listing = FT_toStringIn(ft);
+         assert(listing != NULL);
+         filtered = Bench_filter(listing, queries[q].query,
+                                 queries[q].isPrefix);
+         free(listing);
+      }
+      dumped = (double) (clock() - start) / CLOCKS_PER_SEC / REPEATS;
+      assert(filtered == matches);
+
+      printf("%-28s %8lu matches %10.6f s %10.6f s dumped %10.0fx\n",
+             queries[q].query, (unsigned long) matches, direct, dumped,
+             direct > 0 ? dumped / direct : 0.0);
+   }
+
+   FT_free(ft);
+   return 0;
+}
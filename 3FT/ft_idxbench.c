@@ -0,0 +1,102 @@
+/*--------------------------------------------------------------------*/
+/* ft_idxbench.c                                                      */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "ft.h"
+
+/* Default number of files and files per directory */
+enum { DEFAULT_FILES = 100000, DEFAULT_FANOUT = 100 };
+
+/* Shallowest and deepest paths measured, in components */
+enum { MIN_DEPTH = 2, MAX_DEPTH = 32 };
+
+/* Longest path the bench generates, including the '\0' */
+enum { MAX_PATH = 1024 };
+
+/*
+   Writes into path the path of the i'th bench file, placing fanout
+   files in each directory, so that the path has depth components.
+*/
+static void Bench_path(char *path, size_t i, size_t fanout,
+                       size_t depth) {
+   size_t d;
+
+   assert(path != NULL);
+   assert(depth >= MIN_DEPTH);
+   path += sprintf(path, "bench");
+   for(d = 2; d < depth; d++)
+      path += sprintf(path, "/d%lu", (unsigned long) (i / fanout));
+   sprintf(path, "/f%lu", (unsigned long) i);
+}
+
+/*
+   Looks up each of the files files of ft with FT_containsFileIn and
+   FT_statIn, and returns the lookups per second.
+*/
+static double Bench_lookups(FT_T ft, size_t files, size_t fanout,
+                            size_t depth) {
+   char path[MAX_PATH];
+   clock_t start;
+   double seconds;
+   boolean type;
+   size_t length;
+   size_t i;
+
+   start = clock();
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i, fanout, depth);
+      assert(FT_containsFileIn(ft, path) == TRUE);
+      assert(FT_statIn(ft, path, &type, &length) == SUCCESS);
+   }
+   seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+   return seconds > 0 ? 2 * files / seconds : 0.0;
+}
+
+/*
+   For paths of 2, 4, 8, 16 and 32 components, builds a tree of argv[1]
+   files with argv[2] files per directory, then times exact lookups
+   walking down from the root, and again through the path index.
+   Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   size_t files = DEFAULT_FILES;
+   size_t fanout = DEFAULT_FANOUT;
+   char path[MAX_PATH];
+   size_t depth;
+   size_t i;
+   FT_T ft;
+   double walk;
+   double index;
+
+   if(argc > 1)
+      files = (size_t) strtoul(argv[1], NULL, 10);
+   if(argc > 2)
+      fanout = (size_t) strtoul(argv[2], NULL, 10);
+   if(fanout == 0)
+      fanout = 1;
+
+   printf("%5s %14s %14s %8s\n", "depth", "walk ops/s", "index ops/s",
+          "speedup");
+   for(depth = MIN_DEPTH; depth <= MAX_DEPTH; depth *= 2) {
+      assert((ft = FT_new()) != NULL);
+      assert(FT_insertDirIn(ft, "bench") == SUCCESS);
+      for(i = 0; i < files; i++) {
+         Bench_path(path, i, fanout, depth);
+         assert(FT_insertFileIn(ft, path, NULL, i) == SUCCESS);
+      }
+
+      walk = Bench_lookups(ft, files, fanout, depth);
+      assert(FT_enableIndexIn(ft) == SUCCESS);
+      index = Bench_lookups(ft, files, fanout, depth);
+      printf("%5lu %14.0f %14.0f %7.2fx\n", (unsigned long) depth, walk,
+             index, walk > 0 ? index / walk : 0.0);
+      FT_free(ft);
+   }
+   return 0;
+}
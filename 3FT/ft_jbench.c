@@ -0,0 +1,121 @@
+/*--------------------------------------------------------------------*/
+/* ft_jbench.c                                                        */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for clock_gettime under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "ft.h"
+
+/* Default number of journaled inserts in each run */
+enum { DEFAULT_OPS = 20000 };
+
+/* Files per directory, and the longest path, including the '\0' */
+enum { FANOUT = 1000, MAX_PATH = 64 };
+
+/* The journal the runs write, and its two snapshot slots */
+static char benchJournal[] = "ft_jbench.jnl";
+static const char *benchFiles[] = {
+   "ft_jbench.jnl", "ft_jbench.jnl.snap0", "ft_jbench.jnl.snap1"
+};
+
+/* The number of changes per fsync in each run */
+static const size_t groupSizes[] = { 1, 8, 64, 1024 };
+
+/*
+   Returns the wall-clock time in seconds. A sync spends its time
+   waiting for the disk, not on the CPU, so clock() would miss it.
+*/
+static double Bench_now(void) {
+   struct timespec now;
+
+   assert(clock_gettime(CLOCK_MONOTONIC, &now) == 0);
+   return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* Writes into path the path of the i-th file of a run. */
+static void Bench_path(char *path, size_t i) {
+   sprintf(path, "bench/d%04lu/f%07lu", (unsigned long) (i / FANOUT),
+           (unsigned long) i);
+}
+
+/*
+   For each group size, inserts argv[1] files into a journaled tree,
+   replacing the contents of every other one, and reports the changes
+   per second, then times recovering the tree from the journal and
+   checks that it matches.
+   Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   size_t ops = DEFAULT_OPS;
+   char path[MAX_PATH];
+   static char contents[] = "0123456789abcdef";
+   double start;
+   double seconds;
+   size_t run;
+   size_t changes;
+   size_t i;
+   char *before;
+   char *after;
+   FT_T ft;
+
+   if(argc > 1)
+      ops = (size_t) strtoul(argv[1], NULL, 10);
+
+   for(run = 0; run < sizeof(groupSizes) / sizeof(groupSizes[0]);
+       run++) {
+      for(i = 0; i < sizeof(benchFiles) / sizeof(benchFiles[0]); i++)
+         (void) remove(benchFiles[i]);
+
+      assert((ft = FT_new()) != NULL);
+      assert(FT_openJournalIn(ft, benchJournal, groupSizes[run])
+             == SUCCESS);
+      start = Bench_now();
+      /* A file cannot be the root, so create the root directory first */
+      assert(FT_insertDirIn(ft, "bench") == SUCCESS);
+      changes = 1;
+      for(i = 0; i < ops; i++) {
+         Bench_path(path, i);
+         assert(FT_insertFileIn(ft, path, contents, sizeof(contents))
+                == SUCCESS);
+         changes++;
+         if(i % 2 == 1) {
+            (void) FT_replaceFileContentsIn(ft, path, contents, i % 16);
+            changes++;
+         }
+      }
+      assert(FT_syncJournalIn(ft) == SUCCESS);
+      seconds = Bench_now() - start;
+      printf("group %5lu %8lu changes %9.3f s %10.0f changes/s\n",
+             (unsigned long) groupSizes[run], (unsigned long) changes,
+             seconds, seconds > 0 ? changes / seconds : 0.0);
+      before = FT_toStringIn(ft);
+      assert(before != NULL);
+      assert(FT_closeJournalIn(ft) == SUCCESS);
+      FT_free(ft);
+
+      assert((ft = FT_new()) != NULL);
+      start = Bench_now();
+      assert(FT_openJournalIn(ft, benchJournal, 1) == SUCCESS);
+      seconds = Bench_now() - start;
+      printf("recover %11lu nodes   %9.3f s\n",
+             (unsigned long) (ops + (ops + FANOUT - 1) / FANOUT + 1),
+             seconds);
+      after = FT_toStringIn(ft);
+      assert(after != NULL && !strcmp(before, after));
+      free(before);
+      free(after);
+      FT_free(ft);
+   }
+
+   for(i = 0; i < sizeof(benchFiles) / sizeof(benchFiles[0]); i++)
+      (void) remove(benchFiles[i]);
+   return 0;
+}
@@ -0,0 +1,155 @@
+/*--------------------------------------------------------------------*/
+/* ft_mtbench.c                                                       */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for pthreads and clock_gettime under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "ft.h"
+
+/* Default number of files, operations per thread and most threads */
+enum { DEFAULT_FILES = 100000, DEFAULT_OPS = 1000000,
+       DEFAULT_THREADS = 8 };
+
+/* Files per directory, and reads per write */
+enum { FANOUT = 1000, READS_PER_WRITE = 50 };
+
+/* Longest path the bench generates, including the '\0' */
+enum { MAX_PATH = 64 };
+
+/* The tree all threads work on, and the number of files in it */
+static FT_T ft;
+static size_t files;
+
+/* Number of operations each thread performs */
+static size_t ops;
+
+/*
+   Writes into path the path of the i'th bench file.
+*/
+static void Bench_path(char *path, size_t i) {
+   assert(path != NULL);
+   sprintf(path, "bench/d%lu/f%lu", (unsigned long) (i / FANOUT),
+           (unsigned long) i);
+}
+
+/*
+   Performs ops operations on random files, READS_PER_WRITE lookups
+   (FT_containsFileIn, FT_statIn and FT_getFileContentsIn in turn)
+   for each FT_replaceFileContentsIn. pvSeed points to the thread's
+   unsigned long seed. Returns NULL.
+*/
+static void *Bench_run(void *pvSeed) {
+   unsigned long seed = *(unsigned long *) pvSeed;
+   char path[MAX_PATH];
+   size_t i;
+   size_t f;
+   boolean type;
+   size_t length;
+
+   for(i = 0; i < ops; i++) {
+      seed = seed * 1103515245UL + 12345UL;
+      f = (size_t) (seed >> 8) % files;
+      Bench_path(path, f);
+      switch(i % (READS_PER_WRITE + 1)) {
+         case 0:
+            (void) FT_replaceFileContentsIn(ft, path, NULL, f);
+            break;
+         case 1:
+            assert(FT_statIn(ft, path, &type, &length) == SUCCESS);
+            break;
+         case 2:
+            (void) FT_getFileContentsIn(ft, path);
+            break;
+         default:
+            assert(FT_containsFileIn(ft, path) == TRUE);
+            break;
+      }
+   }
+   return NULL;
+}
+
+/*
+   Returns the seconds elapsed on the monotonic clock since start.
+*/
+static double Bench_elapsed(const struct timespec *start) {
+   struct timespec now;
+
+   assert(start != NULL);
+   (void) clock_gettime(CLOCK_MONOTONIC, &now);
+   return (double) (now.tv_sec - start->tv_sec) +
+          (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+   Builds a tree of argv[1] files, then for 1, 2, 4, ... up to argv[3]
+   threads, has each thread perform argv[2] operations, 50 lookups for
+   each write, and reports the total throughput and the speedup over
+   one thread. Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   size_t maxThreads = DEFAULT_THREADS;
+   pthread_t *aThreads;
+   unsigned long *aSeeds;
+   char path[MAX_PATH];
+   struct timespec start;
+   double seconds;
+   double rate;
+   double baseRate = 0.0;
+   size_t threads;
+   size_t t;
+   size_t i;
+
+   files = DEFAULT_FILES;
+   ops = DEFAULT_OPS;
+   if(argc > 1)
+      files = (size_t) strtoul(argv[1], NULL, 10);
+   if(argc > 2)
+      ops = (size_t) strtoul(argv[2], NULL, 10);
+   if(argc > 3)
+      maxThreads = (size_t) strtoul(argv[3], NULL, 10);
+   if(files == 0)
+      files = 1;
+
+   assert((ft = FT_new()) != NULL);
+   assert(FT_insertDirIn(ft, "bench") == SUCCESS);
+   for(i = 0; i < files; i++) {
+      Bench_path(path, i);
+      assert(FT_insertFileIn(ft, path, NULL, i) == SUCCESS);
+   }
+
+   aThreads = calloc(maxThreads, sizeof(pthread_t));
+   aSeeds = calloc(maxThreads, sizeof(unsigned long));
+   assert(aThreads != NULL && aSeeds != NULL);
+
+   for(threads = 1; threads <= maxThreads; threads *= 2) {
+      (void) clock_gettime(CLOCK_MONOTONIC, &start);
+      for(t = 0; t < threads; t++) {
+         aSeeds[t] = 2 * t + 1;
+         assert(pthread_create(&aThreads[t], NULL, Bench_run,
+                               &aSeeds[t]) == 0);
+      }
+      for(t = 0; t < threads; t++)
+         assert(pthread_join(aThreads[t], NULL) == 0);
+      seconds = Bench_elapsed(&start);
+
+      rate = seconds > 0 ? threads * ops / seconds : 0.0;
+      if(threads == 1)
+         baseRate = rate;
+      printf("%3lu threads %12lu ops %10.3f s %12.0f ops/s %6.2fx\n",
+             (unsigned long) threads, (unsigned long) (threads * ops),
+             seconds, rate, baseRate > 0 ? rate / baseRate : 0.0);
+   }
+
+   free(aSeeds);
+   free(aThreads);
+   FT_free(ft);
+   return 0;
+}
@@ -0,0 +1,367 @@
+/*--------------------------------------------------------------------*/
+/* ft_replay.c                                                        */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for clock_gettime, nanosleep and getopt under -std=c99 */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ft.h"
+#include "trace.h"
+
+/* Number of mismatches printed in full before they are only
+   counted */
+enum { MAX_REPORTED = 10 };
+
+/*
+   Latencies are counted in a histogram whose buckets each cover a
+   sixteenth of a power of two of nanoseconds, as in treebench.
+*/
+enum { SUB_BITS = 4, SUBS = 1 << SUB_BITS,
+       BUCKETS = SUBS + (64 - SUB_BITS) * SUBS };
+
+/*
+   What the replay knows of one operation: how many times the trace
+   calls it, how many of those returned something else this time, and
+   the histograms of the latencies the trace recorded and of those of
+   the replay.
+*/
+struct replayOp {
+   size_t calls;
+   size_t mismatches;
+   size_t traced[BUCKETS];
+   size_t replayed[BUCKETS];
+};
+
+static struct replayOp ops[TRACE_OPS];
+
+/*
+   What one call returned, as struct TraceRecord describes it, and,
+   for FT_toString, a hash of the string, kept by -p until the calls
+   are done so that printing them is not timed.
+*/
+struct replayResult {
+   int result;
+   boolean isFile;
+   size_t length;
+   unsigned long hash;
+};
+
+/* Returns the current time in nanoseconds. */
+static unsigned long Replay_now(void) {
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (unsigned long) now.tv_sec * 1000000000UL +
+          (unsigned long) now.tv_nsec;
+}
+
+/* Returns the histogram bucket of a latency of ns nanoseconds. */
+static size_t Replay_bucket(unsigned long ns) {
+   size_t shift = 0;
+
+   while((ns >> shift) >= 2 * SUBS)
+      shift++;
+   if(ns < SUBS)
+      return (size_t) ns;
+   return SUBS + shift * SUBS + (size_t) ((ns >> shift) - SUBS);
+}
+
+/* Returns the latency, in nanoseconds, below which percent percent
+   of the calls counted in counts finished, or 0 if there are none. */
+static unsigned long Replay_percentile(const size_t *counts,
+                                       size_t calls, size_t percent) {
+   size_t seen = 0;
+   size_t b;
+
+   assert(counts != NULL);
+
+   for(b = 0; b < BUCKETS; b++) {
+      seen += counts[b];
+      if(seen * 100 >= calls * percent && seen > 0)
+         return b < SUBS ? (unsigned long) b
+                         : (unsigned long) (SUBS + (b - SUBS) % SUBS) <<
+                           ((b - SUBS) / SUBS);
+   }
+   return 0;
+}
+
+/* Sleeps until the time is at least ns nanoseconds. */
+static void Replay_waitUntil(unsigned long ns) {
+   struct timespec delay;
+   unsigned long now;
+
+   while((now = Replay_now()) < ns) {
+      delay.tv_sec = (time_t) ((ns - now) / 1000000000UL);
+      delay.tv_nsec = (long) ((ns - now) % 1000000000UL);
+      nanosleep(&delay, NULL);
+   }
+}
+
+/* Returns the FNV-1a hash of string. */
+static unsigned long Replay_hash(const char *string) {
+   unsigned long hash = 2166136261UL;
+
+   assert(string != NULL);
+
+   for(; *string != '\0'; string++)
+      hash = ((hash ^ (unsigned char) *string) * 16777619UL) &
+             0xffffffffUL;
+   return hash;
+}
+
+/*
+   Calls the function of pRecord with its path, passing contents, the
+   first pRecord->uLength bytes of which are the contents if the
+   record has any, and stores what the call returned, as struct
+   TraceRecord describes it, into pResult, and the hash of the string
+   FT_toString returns, or 0, into *pHash. Frees that string.
+*/
+static void Replay_call(const struct TraceRecord *pRecord,
+                        char *contents, struct TraceRecord *pResult,
+                        unsigned long *pHash) {
+   char *path = (char *) pRecord->pcPath;
+   void *passed = pRecord->bHasContents ? contents : NULL;
+   char *string;
+
+   assert(pRecord != NULL);
+   assert(pResult != NULL);
+   assert(pHash != NULL);
+
+   *pHash = 0;
+   pResult->bIsFile = FALSE;
+   pResult->uLength = 0;
+   switch(pRecord->eOp) {
+      case TRACE_INIT:
+         pResult->iResult = FT_init();
+         break;
+      case TRACE_DESTROY:
+         pResult->iResult = FT_destroy();
+         break;
+      case TRACE_INSERT_DIR:
+         pResult->iResult = FT_insertDir(path);
+         break;
+      case TRACE_CONTAINS_DIR:
+         pResult->iResult = FT_containsDir(path);
+         break;
+      case TRACE_RM_DIR:
+         pResult->iResult = FT_rmDir(path);
+         break;
+      case TRACE_INSERT_FILE:
+         pResult->iResult = FT_insertFile(path, passed,
+                                          pRecord->uLength);
+         break;
+      case TRACE_CONTAINS_FILE:
+         pResult->iResult = FT_containsFile(path);
+         break;
+      case TRACE_RM_FILE:
+         pResult->iResult = FT_rmFile(path);
+         break;
+      case TRACE_GET_CONTENTS:
+         pResult->iResult = FT_getFileContents(path) != NULL;
+         break;
+      case TRACE_REPLACE:
+         pResult->iResult = FT_replaceFileContents(path, passed,
+                               pRecord->uLength) != NULL;
+         break;
+      case TRACE_STAT:
+         pResult->iResult = FT_stat(path, &pResult->bIsFile,
+                                    &pResult->uLength);
+         if(pResult->iResult != SUCCESS || !pResult->bIsFile) {
+            pResult->bIsFile = pResult->iResult == SUCCESS &&
+                               pResult->bIsFile;
+            pResult->uLength = 0;
+         }
+         break;
+      case TRACE_TO_STRING:
+         string = FT_toString();
+         pResult->iResult = string != NULL;
+         if(string != NULL) {
+            pResult->uLength = strlen(string);
+            *pHash = Replay_hash(string);
+         }
+         free(string);
+         break;
+      default:
+         assert(FALSE);
+   }
+}
+
+/*
+   Returns TRUE if pResult, what a call returned in the replay,
+   matches pRecord, what it returned when it was traced.
+*/
+static boolean Replay_matches(const struct TraceRecord *pRecord,
+                              const struct TraceRecord *pResult) {
+   assert(pRecord != NULL);
+   assert(pResult != NULL);
+
+   if(pResult->iResult != pRecord->iResult)
+      return FALSE;
+   if(pRecord->eOp == TRACE_STAT || pRecord->eOp == TRACE_TO_STRING)
+      return pResult->bIsFile == pRecord->bIsFile &&
+             pResult->uLength == pRecord->uLength;
+   return TRUE;
+}
+
+/* Prints how to run ft_replay to stderr and exits with failure. */
+static void Replay_usage(const char *program) {
+   fprintf(stderr, "usage: %s [-t] [-p] [-l label] trace\n", program);
+   exit(EXIT_FAILURE);
+}
+
+/*
+   Replays the trace in the file named by the last argument, written
+   by a client linked with fttrace.o, against the file tree ft_replay
+   is linked with: at full speed, or, with -t, starting each call as
+   long after the one before as it was traced. Checks that each call
+   returns what it did when traced, and prints, for each operation,
+   its number of calls and mismatches and the median and 99th
+   percentile latencies of the trace and of the replay. The label,
+   which defaults to the program's name, tells apart the
+   implementations it is linked with.
+   With -p, instead of checking the calls and printing the report,
+   prints what each call returned, one line per call, as its result,
+   whether it found a file, the length and the hash of FT_toString's
+   string, and then a line with the time the calls took in
+   nanoseconds, for ft_fuzz to compare.
+   Returns 0 if every call matched, and exits with failure otherwise.
+*/
+int main(int argc, char *argv[]) {
+   const char *label;
+   boolean timed = FALSE;
+   boolean print = FALSE;
+   struct TraceRecord record;
+   struct TraceRecord result;
+   struct replayResult *results = NULL;
+   unsigned long hash;
+   Trace_T trace;
+   char *contents;
+   size_t maxLength = 0;
+   size_t records = 0;
+   size_t r;
+   size_t mismatches = 0;
+   unsigned long offset = 0;
+   unsigned long begin;
+   unsigned long start;
+   unsigned long elapsed;
+   int status;
+   int op;
+   int c;
+
+   label = strrchr(argv[0], '/') != NULL ? strrchr(argv[0], '/') + 1
+                                         : argv[0];
+   while((c = getopt(argc, argv, "tpl:")) != -1) {
+      switch(c) {
+         case 't':
+            timed = TRUE;
+            break;
+         case 'p':
+            print = TRUE;
+            break;
+         case 'l':
+            label = optarg;
+            break;
+         default:
+            Replay_usage(argv[0]);
+      }
+   }
+   if(optind != argc - 1)
+      Replay_usage(argv[0]);
+
+   /* The trees keep the contents they are given, so one buffer as
+      long as the longest contents stands in for all of them */
+   if(Trace_open(argv[optind], &trace) != SUCCESS) {
+      fprintf(stderr, "%s: cannot open trace %s\n", label,
+              argv[optind]);
+      exit(EXIT_FAILURE);
+   }
+   while((status = Trace_next(trace, &record)) == SUCCESS) {
+      if(record.bHasContents && record.uLength > maxLength)
+         maxLength = record.uLength;
+      records++;
+   }
+   assert(Trace_close(trace) == SUCCESS);
+   if(status != NO_SUCH_PATH) {
+      fprintf(stderr, "%s: trace %s is damaged\n", label, argv[optind]);
+      exit(EXIT_FAILURE);
+   }
+   contents = calloc(maxLength + 1, 1);
+   assert(contents != NULL);
+   if(print) {
+      results = calloc(records + 1, sizeof(struct replayResult));
+      assert(results != NULL);
+   }
+   records = 0;
+
+   assert(Trace_open(argv[optind], &trace) == SUCCESS);
+   begin = Replay_now();
+   while(Trace_next(trace, &record) == SUCCESS) {
+      offset += record.ulGap;
+      if(timed)
+         Replay_waitUntil(begin + offset);
+      start = Replay_now();
+      Replay_call(&record, contents, &result, &hash);
+      elapsed = Replay_now() - start;
+
+      if(print) {
+         results[records].result = result.iResult;
+         results[records].isFile = result.bIsFile;
+         results[records].length = result.uLength;
+         results[records].hash = hash;
+         records++;
+         continue;
+      }
+
+      ops[record.eOp].calls++;
+      ops[record.eOp].traced[Replay_bucket(record.ulDuration)]++;
+      ops[record.eOp].replayed[Replay_bucket(elapsed)]++;
+      if(!Replay_matches(&record, &result)) {
+         if(mismatches++ < MAX_REPORTED)
+            fprintf(stderr, "%s: call %lu, %s(%s) returned %d, "
+                    "traced %d\n", label, (unsigned long) records,
+                    Trace_getName(record.eOp),
+                    record.pcPath != NULL ? record.pcPath : "",
+                    result.iResult, record.iResult);
+         ops[record.eOp].mismatches++;
+      }
+      records++;
+   }
+   elapsed = Replay_now() - begin;
+   assert(Trace_close(trace) == SUCCESS);
+   free(contents);
+
+   if(print) {
+      for(r = 0; r < records; r++)
+         printf("%d %d %lu %lx\n", results[r].result,
+                (int) results[r].isFile,
+                (unsigned long) results[r].length, results[r].hash);
+      printf("time %lu\n", elapsed);
+      free(results);
+      return 0;
+   }
+   printf("%-18s %lu calls in %.3f s%s, %lu mismatches\n", label,
+          (unsigned long) records, (double) elapsed / 1e9,
+          timed ? " at traced timing" : "", (unsigned long) mismatches);
+   for(op = 0; op < TRACE_OPS; op++)
+      if(ops[op].calls > 0)
+         printf("%-18s %-19s %9lu calls %6lu bad  traced p50 %8lu "
+                "p99 %8lu ns  replayed p50 %8lu p99 %8lu ns\n",
+                label, Trace_getName((enum TraceOp) op),
+                (unsigned long) ops[op].calls,
+                (unsigned long) ops[op].mismatches,
+                Replay_percentile(ops[op].traced, ops[op].calls, 50),
+                Replay_percentile(ops[op].traced, ops[op].calls, 99),
+                Replay_percentile(ops[op].replayed, ops[op].calls, 50),
+                Replay_percentile(ops[op].replayed, ops[op].calls, 99));
+   if(mismatches > 0)
+      exit(EXIT_FAILURE);
+   return 0;
+}
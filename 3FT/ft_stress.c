@@ -0,0 +1,268 @@
+/*--------------------------------------------------------------------*/
+/* ft_stress.c                                                        */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for pthreads under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ft.h"
+
+/* Default number of threads and of iterations per thread */
+enum { DEFAULT_THREADS = 8, DEFAULT_ITERATIONS = 20000 };
+
+/* Number of files shared by all threads, and of files each thread
+   owns */
+enum { SHARED_FILES = 64, OWN_FILES = 32 };
+
+/* Longest path the stress test generates, including the '\0' */
+enum { MAX_PATH = 64 };
+
+/* The two contents a shared file may hold: the same length, so that
+   FT_statIn always reports SHARED_LENGTH */
+static char sharedA[] = "contents A";
+static char sharedB[] = "contents B";
+enum { SHARED_LENGTH = sizeof(sharedA) };
+
+/* The tree all threads work on */
+static FT_T ft;
+
+/* Number of iterations each thread performs */
+static size_t iterations;
+
+/*
+   The work of one thread: id is the thread's number, and own[f] is
+   TRUE if the thread's file f is in the tree. Only the thread itself
+   changes its directory, so own is an exact model of it.
+*/
+struct stressThread {
+   pthread_t thread;
+   size_t id;
+   boolean own[OWN_FILES];
+};
+
+/*
+   Writes into path the path of file f of the directory of thread id.
+*/
+static void Stress_ownPath(char *path, size_t id, size_t f) {
+   assert(path != NULL);
+   sprintf(path, "root/t%lu/f%lu", (unsigned long) id, (unsigned long) f);
+}
+
+/*
+   Mixes lookups of the shared files with inserts, removals, renames,
+   replacements, snapshots and cursors in its own directory and the
+   shared directory, checking every answer against what the thread
+   knows must hold.
+   pvThread is the thread's struct stressThread. Returns NULL.
+*/
+static void *Stress_run(void *pvThread) {
+   struct stressThread *pThread = pvThread;
+   char path[MAX_PATH];
+   char moved[MAX_PATH];
+   size_t i;
+   size_t j;
+   size_t f;
+   boolean type;
+   size_t length;
+   size_t files;
+   size_t dirs;
+   size_t bytes;
+   void *contents;
+   unsigned long seed;
+   char *temp;
+   FT_T snapshot;
+   FTDir_T cursor;
+   const char *name;
+   char last[MAX_PATH];
+
+   assert(pThread != NULL);
+   seed = 2 * pThread->id + 1;
+
+   for(i = 0; i < iterations; i++) {
+      seed = seed * 1103515245UL + 12345UL;
+      f = (size_t) (seed >> 8);
+      switch(f % 8) {
+         case 0:
+            /* Toggles one of the thread's own files */
+            Stress_ownPath(path, pThread->id, f / 8 % OWN_FILES);
+            if(pThread->own[f / 8 % OWN_FILES]) {
+               assert(FT_rmFileIn(ft, path) == SUCCESS);
+               pThread->own[f / 8 % OWN_FILES] = FALSE;
+            }
+            else {
+               assert(FT_insertFileIn(ft, path, NULL, f) == SUCCESS);
+               pThread->own[f / 8 % OWN_FILES] = TRUE;
+            }
+            break;
+         case 1:
+            /* Swaps the contents of a shared file */
+            sprintf(path, "root/shared/s%lu",
+                    (unsigned long) (f / 8 % SHARED_FILES));
+            contents = FT_replaceFileContentsIn(ft, path,
+                          (f & 1024) ? sharedA : sharedB, SHARED_LENGTH);
+            assert(contents == sharedA || contents == sharedB);
+            break;
+         case 2:
+            /* Now and then drops the thread's whole directory */
+            if(f / 8 % 64 == 0) {
+               sprintf(path, "root/t%lu", (unsigned long) pThread->id);
+               assert(FT_rmDirIn(ft, path) == SUCCESS);
+               assert(FT_insertDirIn(ft, path) == SUCCESS);
+               memset(pThread->own, 0, sizeof(pThread->own));
+            }
+            else if(f / 8 % 64 == 2) {
+               /* Moves the directory away and back, re-sorting the
+                  root's children under the other threads' lookups */
+               sprintf(path, "root/t%lu", (unsigned long) pThread->id);
+               sprintf(moved, "root/u%lu", (unsigned long) pThread->id);
+               assert(FT_renameIn(ft, path, moved) == SUCCESS);
+               assert(FT_containsDirIn(ft, path) == FALSE);
+               assert(FT_renameIn(ft, moved, path) == SUCCESS);
+            }
+            else if(f / 8 % 64 == 3) {
+               /* Only this thread changes its directory, so a
+                  snapshot of it matches the model while the other
+                  threads change the tree under it */
+               snapshot = FT_snapshotIn(ft);
+               assert(snapshot != NULL);
+               for(j = 0; j < OWN_FILES; j++) {
+                  Stress_ownPath(path, pThread->id, j);
+                  assert(FT_containsFileIn(snapshot, path) ==
+                         pThread->own[j]);
+               }
+               FT_free(snapshot);
+            }
+            else if(f / 8 % 64 == 4) {
+               /* A cursor holds nothing between reads, so it lists
+                  the shared files once each, in order, while the
+                  other threads copy their directory */
+               assert(FT_openDirIn(ft, "root/shared", &cursor)
+                      == SUCCESS);
+               last[0] = '\0';
+               for(j = 0; FT_readDir(cursor, &name, &type, &length)
+                          == SUCCESS; j++) {
+                  assert(type == TRUE && length == SHARED_LENGTH);
+                  assert(strcmp(last, name) < 0);
+                  strcpy(last, name);
+               }
+               assert(j == SHARED_FILES);
+               FT_closeDir(cursor);
+            }
+            else if(f / 8 % 64 == 1) {
+               temp = FT_toStringIn(ft);
+               assert(temp != NULL);
+               assert(!strncmp(temp, "root\n", 5));
+               free(temp);
+            }
+            break;
+         case 3:
+         case 4:
+            /* Checks one of the thread's own files against the model */
+            Stress_ownPath(path, pThread->id, f / 8 % OWN_FILES);
+            assert(FT_containsFileIn(ft, path) ==
+                   pThread->own[f / 8 % OWN_FILES]);
+            break;
+         default:
+            /* Looks up a shared file, which is always present */
+            sprintf(path, "root/shared/s%lu",
+                    (unsigned long) (f / 8 % SHARED_FILES));
+            assert(FT_containsFileIn(ft, path) == TRUE);
+            assert(FT_statIn(ft, path, &type, &length) == SUCCESS);
+            assert(type == TRUE && length == SHARED_LENGTH);
+            contents = FT_getFileContentsIn(ft, path);
+            assert(contents == sharedA || contents == sharedB);
+            /* Replacing a shared file keeps its length, so the totals
+               of their directory never change */
+            assert(FT_duIn(ft, "root/shared", &files, &dirs, &bytes)
+                   == SUCCESS);
+            assert(files == SHARED_FILES && dirs == 1 &&
+                   bytes == SHARED_FILES * SHARED_LENGTH);
+            break;
+      }
+   }
+   return NULL;
+}
+
+/*
+   Runs argv[1] threads for argv[2] iterations each against one tree
+   built with FT_THREADSAFE, asserting that every lookup agrees with
+   what the threads' own changes imply, then checks the final tree,
+   and the totals of each directory, against each thread's model.
+   Does so twice: once walking the tree, and once enabling the path
+   index while the threads run.
+   Returns 0.
+*/
+int main(int argc, char *argv[]) {
+   size_t threads = DEFAULT_THREADS;
+   struct stressThread *aThreads;
+   char path[MAX_PATH];
+   size_t t;
+   size_t f;
+   size_t count;
+   size_t total;
+   size_t files;
+   size_t dirs;
+   size_t bytes;
+   int pass;
+
+   iterations = DEFAULT_ITERATIONS;
+   if(argc > 1)
+      threads = (size_t) strtoul(argv[1], NULL, 10);
+   if(argc > 2)
+      iterations = (size_t) strtoul(argv[2], NULL, 10);
+
+   for(pass = 0; pass < 2; pass++) {
+      assert((ft = FT_new()) != NULL);
+      assert(FT_insertDirIn(ft, "root/shared") == SUCCESS);
+      for(f = 0; f < SHARED_FILES; f++) {
+         sprintf(path, "root/shared/s%lu", (unsigned long) f);
+         assert(FT_insertFileIn(ft, path, sharedA, SHARED_LENGTH)
+                == SUCCESS);
+      }
+
+      aThreads = calloc(threads, sizeof(struct stressThread));
+      assert(aThreads != NULL);
+      for(t = 0; t < threads; t++) {
+         aThreads[t].id = t;
+         sprintf(path, "root/t%lu", (unsigned long) t);
+         assert(FT_insertDirIn(ft, path) == SUCCESS);
+      }
+      for(t = 0; t < threads; t++)
+         assert(pthread_create(&aThreads[t].thread, NULL, Stress_run,
+                               &aThreads[t]) == 0);
+      if(pass == 1)
+         assert(FT_enableIndexIn(ft) == SUCCESS);
+      for(t = 0; t < threads; t++)
+         assert(pthread_join(aThreads[t].thread, NULL) == 0);
+
+      total = SHARED_FILES;
+      for(t = 0; t < threads; t++) {
+         count = 0;
+         for(f = 0; f < OWN_FILES; f++) {
+            Stress_ownPath(path, t, f);
+            assert(FT_containsFileIn(ft, path) == aThreads[t].own[f]);
+            count += aThreads[t].own[f];
+         }
+         sprintf(path, "root/t%lu", (unsigned long) t);
+         assert(FT_duIn(ft, path, &files, &dirs, &bytes) == SUCCESS);
+         assert(files == count && dirs == 1);
+         total += count;
+      }
+      assert(FT_duIn(ft, "root", &files, &dirs, &bytes) == SUCCESS);
+      assert(files == total && dirs == threads + 2);
+
+      free(aThreads);
+      FT_free(ft);
+      fprintf(stderr, "%lu threads x %lu iterations%s: ok\n",
+              (unsigned long) threads, (unsigned long) iterations,
+              pass == 1 ? ", indexed" : "");
+   }
+   return 0;
+}
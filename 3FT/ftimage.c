@@ -0,0 +1,485 @@
+/*--------------------------------------------------------------------*/
+/* ftimage.c                                                          */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for mmap, fstat and open under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include "ftimage.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*--------------------------------------------------------------------*/
+
+/* FTImage_toString starts with room for MIN_FRAMES open
+   directories, and doubles it as needed. */
+
+enum { MIN_FRAMES = 16 };
+
+/* Which kinds of node a lookup of the last component accepts. */
+
+enum Want { WANT_DIR, WANT_FILE, WANT_EITHER };
+
+/*--------------------------------------------------------------------*/
+
+/* An FTImage is the mapping of an image and its size, and where each
+   of the image's regions starts within it, and how big it is. */
+
+struct FTImage
+{
+   void *pvMap;
+   size_t uMapSize;
+   const struct FTImageNode *psNodes;
+   uint64_t ulNodeCount;
+   const char *pcNames;
+   uint64_t ulNamesSize;
+   const char *pcContents;
+   uint64_t ulContentsSize;
+};
+
+/* A frame of FTImage_toString: a directory whose children are being
+   listed, the next and the end of its range of children, and where
+   its own line starts in the string and how long its path is. */
+
+struct Frame
+{
+   uint64_t ulNext;
+   uint64_t ulEnd;
+   size_t uStart;
+   size_t uLength;
+};
+
+/*--------------------------------------------------------------------*/
+
+FTImage_T FTImage_open(const char *pcPath)
+{
+   FTImage_T oImage;
+   const struct FTImageHeader *psHeader;
+   struct stat sStat;
+   void *pvMap;
+   size_t uRest;
+   int iFd;
+
+   assert(pcPath != NULL);
+
+   iFd = open(pcPath, O_RDONLY);
+   if (iFd < 0)
+      return NULL;
+   if (fstat(iFd, &sStat) != 0 ||
+       sStat.st_size < (off_t)sizeof(struct FTImageHeader))
+   {
+      (void)close(iFd);
+      return NULL;
+   }
+   pvMap = mmap(NULL, (size_t)sStat.st_size, PROT_READ, MAP_SHARED,
+                iFd, 0);
+   (void)close(iFd);
+   if (pvMap == MAP_FAILED)
+      return NULL;
+
+   /* The regions must fill the rest of the file exactly */
+   psHeader = (const struct FTImageHeader*)pvMap;
+   uRest = (size_t)sStat.st_size - sizeof(struct FTImageHeader);
+   if (memcmp(psHeader->acMagic, FTIMAGE_MAGIC,
+              sizeof(psHeader->acMagic)) != 0 ||
+       psHeader->ulByteOrder != (uint32_t)FTIMAGE_BYTE_ORDER ||
+       psHeader->ulNodeSize != sizeof(struct FTImageNode) ||
+       psHeader->ulNodeCount > uRest / sizeof(struct FTImageNode) ||
+       psHeader->ulNamesSize >
+          uRest - psHeader->ulNodeCount * sizeof(struct FTImageNode) ||
+       psHeader->ulContentsSize !=
+          uRest - psHeader->ulNodeCount * sizeof(struct FTImageNode)
+          - psHeader->ulNamesSize)
+   {
+      (void)munmap(pvMap, (size_t)sStat.st_size);
+      return NULL;
+   }
+
+   oImage = (FTImage_T)malloc(sizeof(struct FTImage));
+   if (oImage == NULL)
+   {
+      (void)munmap(pvMap, (size_t)sStat.st_size);
+      return NULL;
+   }
+   oImage->pvMap = pvMap;
+   oImage->uMapSize = (size_t)sStat.st_size;
+   oImage->psNodes = (const struct FTImageNode*)(psHeader + 1);
+   oImage->ulNodeCount = psHeader->ulNodeCount;
+   oImage->pcNames = (const char*)(oImage->psNodes
+                                   + psHeader->ulNodeCount);
+   oImage->ulNamesSize = psHeader->ulNamesSize;
+   oImage->pcContents = oImage->pcNames + psHeader->ulNamesSize;
+   oImage->ulContentsSize = psHeader->ulContentsSize;
+   return oImage;
+}
+
+/*--------------------------------------------------------------------*/
+
+void FTImage_close(FTImage_T oImage)
+{
+   assert(oImage != NULL);
+
+   (void)munmap(oImage->pvMap, oImage->uMapSize);
+   free(oImage);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the name of psNode in oImage, storing its length in
+   *puLength, or NULL if the name lies outside the names region. */
+
+static const char *FTImage_getName(FTImage_T oImage,
+                                   const struct FTImageNode *psNode,
+                                   size_t *puLength)
+{
+   assert(oImage != NULL);
+   assert(psNode != NULL);
+   assert(puLength != NULL);
+
+   if (psNode->ulNameOffset > oImage->ulNamesSize ||
+       psNode->ulNameLength > oImage->ulNamesSize - psNode->ulNameOffset)
+      return NULL;
+   *puLength = psNode->ulNameLength;
+   return oImage->pcNames + psNode->ulNameOffset;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if psNode is a directory whose range of children lies
+   inside oImage's nodes, and FALSE otherwise. */
+
+static boolean FTImage_hasChildren(FTImage_T oImage,
+                                   const struct FTImageNode *psNode)
+{
+   assert(oImage != NULL);
+   assert(psNode != NULL);
+
+   return (boolean)(!psNode->ulIsFile &&
+                    psNode->ulFirst <= oImage->ulNodeCount &&
+                    psNode->ulCount <= oImage->ulNodeCount
+                                       - psNode->ulFirst &&
+                    psNode->ulFiles <= psNode->ulCount);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return <0, 0 or >0 as the uLength characters at pcName come before,
+   are the same as, or come after psNode's name, in the order of
+   strcmp. Store FALSE in *pbValid if psNode's name is damaged. */
+
+static int FTImage_compare(FTImage_T oImage, const char *pcName,
+                           size_t uLength,
+                           const struct FTImageNode *psNode,
+                           boolean *pbValid)
+{
+   const char *pcNodeName;
+   size_t uNodeLength;
+   int iResult;
+
+   assert(pbValid != NULL);
+
+   pcNodeName = FTImage_getName(oImage, psNode, &uNodeLength);
+   if (pcNodeName == NULL)
+   {
+      *pbValid = FALSE;
+      return 0;
+   }
+   iResult = memcmp(pcName, pcNodeName,
+                    uLength < uNodeLength ? uLength : uNodeLength);
+   if (iResult != 0)
+      return iResult;
+   if (uLength == uNodeLength)
+      return 0;
+   return uLength < uNodeLength ? -1 : 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node among nodes ulLow up to but not including ulHigh of
+   oImage, which are sorted by name, whose name is the uLength
+   characters at pcName, or NULL if there is none. */
+
+static const struct FTImageNode *FTImage_search(FTImage_T oImage,
+                                                uint64_t ulLow,
+                                                uint64_t ulHigh,
+                                                const char *pcName,
+                                                size_t uLength)
+{
+   const struct FTImageNode *psNode;
+   boolean bValid = TRUE;
+   uint64_t ulMid;
+   int iCompare;
+
+   while (ulLow < ulHigh)
+   {
+      ulMid = ulLow + (ulHigh - ulLow) / 2;
+      psNode = &oImage->psNodes[ulMid];
+      iCompare = FTImage_compare(oImage, pcName, uLength, psNode,
+                                 &bValid);
+      if (!bValid)
+         return NULL;
+      if (iCompare == 0)
+         return psNode;
+      if (iCompare < 0)
+         ulHigh = ulMid;
+      else
+         ulLow = ulMid + 1;
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node of oImage with path pcPath, which must be a
+   directory if eWant is WANT_DIR and a file if it is WANT_FILE, or
+   NULL if there is none. A path that is empty, or has an empty
+   component, names no node. */
+
+static const struct FTImageNode *FTImage_find(FTImage_T oImage,
+                                              const char *pcPath,
+                                              enum Want eWant)
+{
+   const struct FTImageNode *psNode;
+   const struct FTImageNode *psChild;
+   const char *pcEnd;
+   size_t uLength;
+   boolean bValid = TRUE;
+
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+
+   if (oImage->ulNodeCount == 0)
+      return NULL;
+   psNode = &oImage->psNodes[0];
+   pcEnd = strchr(pcPath, '/');
+   uLength = pcEnd == NULL ? strlen(pcPath) : (size_t)(pcEnd - pcPath);
+   if (uLength == 0 ||
+       FTImage_compare(oImage, pcPath, uLength, psNode, &bValid) != 0 ||
+       !bValid)
+      return NULL;
+
+   /* Each pass looks up the component after pcEnd among the children
+      of psNode, in the files only if it is the last and a file is
+      wanted, and in the directories only if it is not the last or a
+      directory is wanted */
+   while (pcEnd != NULL)
+   {
+      pcPath = pcEnd + 1;
+      pcEnd = strchr(pcPath, '/');
+      uLength = pcEnd == NULL ? strlen(pcPath)
+                              : (size_t)(pcEnd - pcPath);
+      if (uLength == 0 || !FTImage_hasChildren(oImage, psNode))
+         return NULL;
+      psChild = NULL;
+      if (pcEnd == NULL && eWant != WANT_DIR)
+         psChild = FTImage_search(oImage, psNode->ulFirst,
+                                  psNode->ulFirst + psNode->ulFiles,
+                                  pcPath, uLength);
+      if (psChild == NULL && (pcEnd != NULL || eWant != WANT_FILE))
+         psChild = FTImage_search(oImage,
+                                  psNode->ulFirst + psNode->ulFiles,
+                                  psNode->ulFirst + psNode->ulCount,
+                                  pcPath, uLength);
+      if (psChild == NULL)
+         return NULL;
+      psNode = psChild;
+   }
+
+   if ((eWant == WANT_DIR && psNode->ulIsFile) ||
+       (eWant == WANT_FILE && !psNode->ulIsFile))
+      return NULL;
+   return psNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean FTImage_containsDir(FTImage_T oImage, const char *pcPath)
+{
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+
+   return (boolean)(FTImage_find(oImage, pcPath, WANT_DIR) != NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean FTImage_containsFile(FTImage_T oImage, const char *pcPath)
+{
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+
+   return (boolean)(FTImage_find(oImage, pcPath, WANT_FILE) != NULL);
+}
+
+/*--------------------------------------------------------------------*/
+
+const void *FTImage_getFileContents(FTImage_T oImage,
+                                    const char *pcPath)
+{
+   const struct FTImageNode *psNode;
+
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+
+   psNode = FTImage_find(oImage, pcPath, WANT_FILE);
+   if (psNode == NULL || psNode->ulFirst == FTIMAGE_NO_CONTENTS ||
+       psNode->ulFirst > oImage->ulContentsSize ||
+       psNode->ulCount > oImage->ulContentsSize - psNode->ulFirst)
+      return NULL;
+   return oImage->pcContents + psNode->ulFirst;
+}
+
+/*--------------------------------------------------------------------*/
+
+int FTImage_stat(FTImage_T oImage, const char *pcPath,
+                 boolean *pbIsFile, size_t *puLength)
+{
+   const struct FTImageNode *psNode;
+
+   assert(oImage != NULL);
+   assert(pcPath != NULL);
+   assert(pbIsFile != NULL);
+   assert(puLength != NULL);
+
+   psNode = FTImage_find(oImage, pcPath, WANT_EITHER);
+   if (psNode == NULL)
+      return NO_SUCH_PATH;
+   if (psNode->ulIsFile)
+   {
+      *pbIsFile = TRUE;
+      *puLength = (size_t)psNode->ulCount;
+   }
+   else
+      *pbIsFile = FALSE;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* List the paths of oImage in pre-order, each followed by a newline,
+   into pcString if it is not NULL, and store the length of the list
+   in *puLength. Each path is copied from its parent's line earlier
+   in pcString, so no path is built separately. Return FALSE if
+   insufficient memory is available or the image is damaged, in which
+   case pcString is partly written. */
+
+static boolean FTImage_list(FTImage_T oImage, char *pcString,
+                            size_t *puLength)
+{
+   struct Frame *psFrames = NULL;
+   struct Frame *psGrown;
+   struct Frame *psTop;
+   const struct FTImageNode *psNode;
+   const char *pcName;
+   size_t uNameLength;
+   size_t uFrames = 0;
+   size_t uDepth = 0;
+   size_t uEnd = 0;
+   size_t uLength;
+   uint64_t ulVisited = 0;
+   uint64_t ulIndex = 0;
+   boolean bResult = TRUE;
+
+   assert(oImage != NULL);
+   assert(puLength != NULL);
+
+   /* Node ulIndex is the root on the first pass, and then the next
+      child of the innermost directory with children left */
+   while (ulVisited < oImage->ulNodeCount)
+   {
+      psNode = &oImage->psNodes[ulIndex];
+      pcName = FTImage_getName(oImage, psNode, &uNameLength);
+      if (pcName == NULL)
+      {
+         bResult = FALSE;
+         break;
+      }
+      psTop = uDepth == 0 ? NULL : &psFrames[uDepth - 1];
+      uLength = psTop == NULL ? uNameLength
+                              : psTop->uLength + 1 + uNameLength;
+      if (pcString != NULL)
+      {
+         if (psTop != NULL)
+         {
+            memcpy(pcString + uEnd, pcString + psTop->uStart,
+                   psTop->uLength);
+            pcString[uEnd + psTop->uLength] = '/';
+         }
+         memcpy(pcString + uEnd + uLength - uNameLength, pcName,
+                uNameLength);
+         pcString[uEnd + uLength] = '\n';
+      }
+      ulVisited++;
+
+      if (!psNode->ulIsFile && psNode->ulCount > 0)
+      {
+         if (!FTImage_hasChildren(oImage, psNode))
+         {
+            bResult = FALSE;
+            break;
+         }
+         if (uDepth == uFrames)
+         {
+            uFrames = uFrames == 0 ? MIN_FRAMES : 2 * uFrames;
+            psGrown = (struct Frame*)realloc(psFrames,
+                                             uFrames
+                                             * sizeof(struct Frame));
+            if (psGrown == NULL)
+            {
+               bResult = FALSE;
+               break;
+            }
+            psFrames = psGrown;
+         }
+         psFrames[uDepth].ulNext = psNode->ulFirst;
+         psFrames[uDepth].ulEnd = psNode->ulFirst + psNode->ulCount;
+         psFrames[uDepth].uStart = uEnd;
+         psFrames[uDepth].uLength = uLength;
+         uDepth++;
+      }
+      uEnd += uLength + 1;
+
+      while (uDepth > 0 &&
+             psFrames[uDepth - 1].ulNext == psFrames[uDepth - 1].ulEnd)
+         uDepth--;
+      if (uDepth == 0)
+         break;
+      ulIndex = psFrames[uDepth - 1].ulNext++;
+   }
+
+   /* A sound image lists each node exactly once */
+   if (uDepth > 0 || ulVisited != oImage->ulNodeCount)
+      bResult = FALSE;
+   free(psFrames);
+   *puLength = uEnd;
+   return bResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+char *FTImage_toString(FTImage_T oImage)
+{
+   char *pcString;
+   size_t uLength;
+
+   assert(oImage != NULL);
+
+   if (!FTImage_list(oImage, NULL, &uLength))
+      return NULL;
+   pcString = (char*)malloc(uLength + 1);
+   if (pcString == NULL)
+      return NULL;
+   if (!FTImage_list(oImage, pcString, &uLength))
+   {
+      free(pcString);
+      return NULL;
+   }
+   pcString[uLength] = '\0';
+   return pcString;
+}
@@ -0,0 +1,126 @@
+/*--------------------------------------------------------------------*/
+/* ftimage.h                                                          */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#ifndef FTIMAGE_INCLUDED
+#define FTIMAGE_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include "a4def.h"
+
+/* An FTImage_T object is a read-only file tree answered straight from
+   an image file that FT_saveImage wrote and that is mapped into
+   memory. Opening one reads and allocates nothing per node, so it is
+   ready at once, and processes that map the same image share its
+   pages. Lookups follow the semantics of the functions of the same
+   name in ft.h. An image is never changed, so any number of threads
+   may query one at once. */
+
+typedef struct FTImage *FTImage_T;
+
+/*--------------------------------------------------------------------*/
+
+/* The layout of an image, which ft.c writes and ftimage.c reads.
+   Every field is in the byte order of the machine that wrote it.
+
+   An image is a struct FTImageHeader, then a struct FTImageNode for
+   each node, then the names, each followed by a '\0', then the
+   contents of the files back to back. The nodes are in breadth-first
+   order, so the root is node 0 and the children of each directory
+   are consecutive: files first, then directories, each sorted by
+   name as strcmp would sort them. */
+
+#define FTIMAGE_MAGIC "FTIMG001"
+#define FTIMAGE_BYTE_ORDER 0x01020304UL
+
+/* The ulFirst of a file whose contents are NULL. */
+
+#define FTIMAGE_NO_CONTENTS UINT64_MAX
+
+struct FTImageHeader
+{
+   char acMagic[8];
+   uint32_t ulByteOrder;
+   /* sizeof(struct FTImageNode) */
+   uint32_t ulNodeSize;
+   uint64_t ulNodeCount;
+   uint64_t ulNamesSize;
+   uint64_t ulContentsSize;
+};
+
+/* For a directory, ulFirst is the index of its first child, ulCount
+   is its number of children and ulFiles how many of them are files.
+   For a file, ulFirst is the offset of its contents in the contents
+   region, or FTIMAGE_NO_CONTENTS, ulCount is their length and ulFiles
+   is 0. */
+
+struct FTImageNode
+{
+   uint64_t ulNameOffset;
+   uint64_t ulFirst;
+   uint64_t ulCount;
+   uint64_t ulFiles;
+   uint32_t ulNameLength;
+   uint32_t ulIsFile;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Map the image file named pcPath and return it as a new FTImage_T
+   object, or NULL if the file cannot be mapped or is not an image
+   written on a machine like this one. Only the header and the sizes
+   of the regions are checked here; a damaged node makes the lookups
+   that reach it fail, rather than read outside the image. */
+
+FTImage_T FTImage_open(const char *pcPath);
+
+/*--------------------------------------------------------------------*/
+
+/* Unmap oImage and free it. The contents it returned become invalid. */
+
+void FTImage_close(FTImage_T oImage);
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if oImage has a directory with path pcPath, and FALSE
+   otherwise. */
+
+boolean FTImage_containsDir(FTImage_T oImage, const char *pcPath);
+
+/*--------------------------------------------------------------------*/
+
+/* Return TRUE if oImage has a file with path pcPath, and FALSE
+   otherwise. */
+
+boolean FTImage_containsFile(FTImage_T oImage, const char *pcPath);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the contents of the file with path pcPath in oImage, which
+   point into the mapped image and must not be written, or NULL if
+   there is no such file or its contents are NULL. */
+
+const void *FTImage_getFileContents(FTImage_T oImage,
+                                    const char *pcPath);
+
+/*--------------------------------------------------------------------*/
+
+/* Return SUCCESS if pcPath exists in oImage, setting *pbIsFile to
+   TRUE and *puLength to the length of its contents for a file, and
+   *pbIsFile to FALSE for a directory; return NO_SUCH_PATH, leaving
+   both unchanged, otherwise. */
+
+int FTImage_stat(FTImage_T oImage, const char *pcPath,
+                 boolean *pbIsFile, size_t *puLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the paths in oImage in the format of FT_toString, in memory
+   that the caller owns, or NULL if insufficient memory is available
+   or the image is damaged. */
+
+char *FTImage_toString(FTImage_T oImage);
+
+#endif
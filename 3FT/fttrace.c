@@ -0,0 +1,282 @@
+/*--------------------------------------------------------------------*/
+/* fttrace.c                                                          */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for clock_gettime under -std=c99 */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ft.h"
+#include "trace.h"
+
+/*
+   The tracing shim. A client linked with fttrace.o and with
+   -Wl,--wrap=FT_init,--wrap=FT_destroy and so on for each function
+   of enum TraceOp calls the wrappers below instead of the functions
+   of the file tree, which they forward to and record. The shim uses
+   nothing but the interface every implementation of ft.h shares, so
+   it traces sampleft.o as well as ft.o. The trace is written to the
+   file named by the environment variable FT_TRACE, and nothing is
+   traced if it is not set. The shim is not thread-safe.
+*/
+
+/*--------------------------------------------------------------------*/
+
+/* The environment variable that names the trace file. */
+
+#define TRACE_VARIABLE "FT_TRACE"
+
+/* Whether the shim has yet to look at TRACE_VARIABLE, is tracing, or
+   is not, because the variable is not set or the trace failed. */
+
+enum TraceState { STATE_UNSTARTED, STATE_TRACING, STATE_OFF };
+
+static enum TraceState eState = STATE_UNSTARTED;
+
+/* The trace being written, and when the last call recorded began. */
+
+static Trace_T oTrace;
+static unsigned long ulLastStart;
+
+int __real_FT_init(void);
+int __real_FT_destroy(void);
+int __real_FT_insertDir(char *pcPath);
+boolean __real_FT_containsDir(char *pcPath);
+int __real_FT_rmDir(char *pcPath);
+int __real_FT_insertFile(char *pcPath, void *pvContents,
+                         size_t uLength);
+boolean __real_FT_containsFile(char *pcPath);
+int __real_FT_rmFile(char *pcPath);
+void *__real_FT_getFileContents(char *pcPath);
+void *__real_FT_replaceFileContents(char *pcPath, void *pvContents,
+                                    size_t uLength);
+int __real_FT_stat(char *pcPath, boolean *pbIsFile, size_t *puLength);
+char *__real_FT_toString(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the current time in nanoseconds. */
+
+static unsigned long FTTrace_now(void)
+{
+   struct timespec sNow;
+
+   clock_gettime(CLOCK_MONOTONIC, &sNow);
+   return (unsigned long)sNow.tv_sec * 1000000000UL +
+          (unsigned long)sNow.tv_nsec;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Close the trace, at exit. */
+
+static void FTTrace_finish(void)
+{
+   if (eState != STATE_TRACING)
+      return;
+   eState = STATE_OFF;
+   if (Trace_close(oTrace) != SUCCESS)
+      fprintf(stderr, "fttrace: cannot write %s\n",
+              getenv(TRACE_VARIABLE));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record a call of eOp on pcPath, which began at ulStart, returned
+   iResult and passed or got back bHasContents, bIsFile and uLength
+   as struct TraceRecord describes. Start the trace on the first
+   call, and stop tracing for good if it cannot be written. */
+
+static void FTTrace_record(enum TraceOp eOp, const char *pcPath,
+                           unsigned long ulStart, int iResult,
+                           boolean bHasContents, boolean bIsFile,
+                           size_t uLength)
+{
+   struct TraceRecord sRecord;
+   unsigned long ulEnd = FTTrace_now();
+   const char *pcFile;
+
+   if (eState == STATE_UNSTARTED)
+   {
+      pcFile = getenv(TRACE_VARIABLE);
+      eState = STATE_OFF;
+      if (pcFile == NULL)
+         return;
+      if (Trace_create(pcFile, &oTrace) != SUCCESS)
+      {
+         fprintf(stderr, "fttrace: cannot create %s\n", pcFile);
+         return;
+      }
+      eState = STATE_TRACING;
+      ulLastStart = ulStart;
+      atexit(FTTrace_finish);
+   }
+   if (eState != STATE_TRACING)
+      return;
+
+   sRecord.eOp = eOp;
+   sRecord.iResult = iResult;
+   sRecord.pcPath = pcPath;
+   sRecord.bHasContents = bHasContents;
+   sRecord.bIsFile = bIsFile;
+   sRecord.uLength = uLength;
+   sRecord.ulGap = ulStart - ulLastStart;
+   sRecord.ulDuration = ulEnd - ulStart;
+   ulLastStart = ulStart;
+   if (Trace_append(oTrace, &sRecord) != SUCCESS)
+      FTTrace_finish();
+}
+
+/*--------------------------------------------------------------------*/
+
+int __wrap_FT_init(void)
+{
+   unsigned long ulStart = FTTrace_now();
+   int iResult = __real_FT_init();
+
+   FTTrace_record(TRACE_INIT, NULL, ulStart, iResult, FALSE, FALSE, 0);
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int __wrap_FT_destroy(void)
+{
+   unsigned long ulStart = FTTrace_now();
+   int iResult = __real_FT_destroy();
+
+   FTTrace_record(TRACE_DESTROY, NULL, ulStart, iResult, FALSE, FALSE,
+                  0);
+   /* The end of a tree is a natural point to get the trace to disk */
+   if (eState == STATE_TRACING && Trace_flush(oTrace) != SUCCESS)
+      FTTrace_finish();
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int __wrap_FT_insertDir(char *pcPath)
+{
+   unsigned long ulStart = FTTrace_now();
+   int iResult = __real_FT_insertDir(pcPath);
+
+   FTTrace_record(TRACE_INSERT_DIR, pcPath, ulStart, iResult, FALSE,
+                  FALSE, 0);
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean __wrap_FT_containsDir(char *pcPath)
+{
+   unsigned long ulStart = FTTrace_now();
+   boolean bResult = __real_FT_containsDir(pcPath);
+
+   FTTrace_record(TRACE_CONTAINS_DIR, pcPath, ulStart, (int)bResult,
+                  FALSE, FALSE, 0);
+   return bResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int __wrap_FT_rmDir(char *pcPath)
+{
+   unsigned long ulStart = FTTrace_now();
+   int iResult = __real_FT_rmDir(pcPath);
+
+   FTTrace_record(TRACE_RM_DIR, pcPath, ulStart, iResult, FALSE, FALSE,
+                  0);
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int __wrap_FT_insertFile(char *pcPath, void *pvContents, size_t uLength)
+{
+   unsigned long ulStart = FTTrace_now();
+   int iResult = __real_FT_insertFile(pcPath, pvContents, uLength);
+
+   FTTrace_record(TRACE_INSERT_FILE, pcPath, ulStart, iResult,
+                  (boolean)(pvContents != NULL), FALSE, uLength);
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+boolean __wrap_FT_containsFile(char *pcPath)
+{
+   unsigned long ulStart = FTTrace_now();
+   boolean bResult = __real_FT_containsFile(pcPath);
+
+   FTTrace_record(TRACE_CONTAINS_FILE, pcPath, ulStart, (int)bResult,
+                  FALSE, FALSE, 0);
+   return bResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int __wrap_FT_rmFile(char *pcPath)
+{
+   unsigned long ulStart = FTTrace_now();
+   int iResult = __real_FT_rmFile(pcPath);
+
+   FTTrace_record(TRACE_RM_FILE, pcPath, ulStart, iResult, FALSE,
+                  FALSE, 0);
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *__wrap_FT_getFileContents(char *pcPath)
+{
+   unsigned long ulStart = FTTrace_now();
+   void *pvResult = __real_FT_getFileContents(pcPath);
+
+   FTTrace_record(TRACE_GET_CONTENTS, pcPath, ulStart,
+                  pvResult != NULL, FALSE, FALSE, 0);
+   return pvResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *__wrap_FT_replaceFileContents(char *pcPath, void *pvContents,
+                                    size_t uLength)
+{
+   unsigned long ulStart = FTTrace_now();
+   void *pvResult = __real_FT_replaceFileContents(pcPath, pvContents,
+                                                  uLength);
+
+   FTTrace_record(TRACE_REPLACE, pcPath, ulStart, pvResult != NULL,
+                  (boolean)(pvContents != NULL), FALSE, uLength);
+   return pvResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int __wrap_FT_stat(char *pcPath, boolean *pbIsFile, size_t *puLength)
+{
+   unsigned long ulStart = FTTrace_now();
+   int iResult = __real_FT_stat(pcPath, pbIsFile, puLength);
+
+   FTTrace_record(TRACE_STAT, pcPath, ulStart, iResult, FALSE,
+                  iResult == SUCCESS ? *pbIsFile : FALSE,
+                  iResult == SUCCESS && *pbIsFile ? *puLength : 0);
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+char *__wrap_FT_toString(void)
+{
+   unsigned long ulStart = FTTrace_now();
+   char *pcResult = __real_FT_toString();
+
+   FTTrace_record(TRACE_TO_STRING, NULL, ulStart, pcResult != NULL,
+                  FALSE, FALSE, pcResult != NULL ? strlen(pcResult) : 0);
+   return pcResult;
+}
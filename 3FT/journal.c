@@ -0,0 +1,594 @@
+/*--------------------------------------------------------------------*/
+/* journal.c                                                          */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for pread, fsync and ftruncate under -std=c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "journal.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The buffer of records starts with MIN_BUFFER bytes, and doubles as
+   needed. */
+
+enum { MIN_BUFFER = 4096 };
+
+/* The first bytes of every journal, and the value that reads back the
+   same only on a machine with the byte order of the writer. */
+
+#define JOURNAL_MAGIC "FTJRNL01"
+#define JOURNAL_BYTE_ORDER 0x01020304UL
+
+/* The 64-bit FNV-1a offset basis and prime, for the checksums. */
+
+#define FNV_OFFSET 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
+
+/*--------------------------------------------------------------------*/
+
+/* The header at the start of the file. */
+
+struct Header
+{
+   char acMagic[8];
+   uint32_t ulByteOrder;
+   uint32_t ulReserved;
+   uint64_t ulGeneration;
+};
+
+/* A record is an Entry, then the path and a '\0', then the contents,
+   if it has any. The checksum covers everything after itself. */
+
+struct Entry
+{
+   uint64_t ulChecksum;
+   uint32_t ulOp;
+   uint32_t ulHasContents;
+   uint64_t ulPathLength;
+   uint64_t ulLength;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A Journal consists of its open file and the file's path, its
+   generation, the records buffered since the last sync and how many
+   of them are committed, how many make a group, the size of the last
+   record if it is not committed yet, or 0, the size of the file with
+   the buffer, and the status of the first write or sync that
+   failed. */
+
+struct Journal
+{
+   int iFd;
+   char *pcPath;
+   unsigned long ulGeneration;
+   char *pcBuffer;
+   size_t uBufferLength;
+   size_t uBufferSize;
+   size_t uPending;
+   size_t uGroupSize;
+   size_t uLast;
+   size_t uSize;
+   int iStatus;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the checksum whose running value is ulSum continued over
+   the uLength bytes at pv. */
+
+static uint64_t Journal_checksum(uint64_t ulSum, const void *pv,
+                                 size_t uLength)
+{
+   const unsigned char *puc = pv;
+   size_t u;
+
+   for (u = 0; u < uLength; u++)
+   {
+      ulSum ^= puc[u];
+      ulSum *= FNV_PRIME;
+   }
+   return ulSum;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the uLength bytes at pv to iFd, however many calls it takes.
+   Return TRUE if all were written, and FALSE otherwise. */
+
+static boolean Journal_writeAll(int iFd, const void *pv, size_t uLength)
+{
+   const char *pc = pv;
+   ssize_t iWritten;
+
+   while (uLength > 0)
+   {
+      iWritten = write(iFd, pc, uLength);
+      if (iWritten < 0 && errno == EINTR)
+         continue;
+      if (iWritten <= 0)
+         return FALSE;
+      pc += iWritten;
+      uLength -= (size_t)iWritten;
+   }
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sync the directory holding the file named pcPath, so that a file
+   created or renamed there survives a crash. Return TRUE if it could
+   be synced, and FALSE otherwise. */
+
+static boolean Journal_syncDir(const char *pcPath)
+{
+   const char *pcSlash;
+   char *pcDir;
+   size_t uLength;
+   int iFd;
+   boolean bResult;
+
+   assert(pcPath != NULL);
+
+   pcSlash = strrchr(pcPath, '/');
+   uLength = pcSlash == NULL ? 1 : (size_t)(pcSlash - pcPath) + 1;
+   pcDir = (char*)malloc(uLength + 1);
+   if (pcDir == NULL)
+      return FALSE;
+   if (pcSlash == NULL)
+      strcpy(pcDir, ".");
+   else
+   {
+      memcpy(pcDir, pcPath, uLength);
+      pcDir[uLength] = '\0';
+   }
+   iFd = open(pcDir, O_RDONLY);
+   free(pcDir);
+   if (iFd < 0)
+      return FALSE;
+   bResult = (boolean)(fsync(iFd) == 0);
+   (void)close(iFd);
+   return bResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Create the file named pcPath, or empty it, holding only the header
+   of a journal of generation ulGeneration, sync it, and return its
+   descriptor, or -1 if that fails, removing the file. */
+
+static int Journal_create(const char *pcPath,
+                          unsigned long ulGeneration)
+{
+   struct Header sHeader;
+   int iFd;
+
+   assert(pcPath != NULL);
+
+   iFd = open(pcPath, O_RDWR | O_CREAT | O_TRUNC, 0666);
+   if (iFd < 0)
+      return -1;
+   memset(&sHeader, 0, sizeof(sHeader));
+   memcpy(sHeader.acMagic, JOURNAL_MAGIC, sizeof(sHeader.acMagic));
+   sHeader.ulByteOrder = (uint32_t)JOURNAL_BYTE_ORDER;
+   sHeader.ulGeneration = ulGeneration;
+   if (!Journal_writeAll(iFd, &sHeader, sizeof(sHeader)) ||
+       fsync(iFd) != 0)
+   {
+      (void)close(iFd);
+      (void)unlink(pcPath);
+      return -1;
+   }
+   return iFd;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the buffered records of oJournal and wait until they are on
+   disk, whether or not a record is awaiting Journal_commit. Return
+   SUCCESS, or IO_ERROR if this or an earlier write or sync failed. */
+
+static int Journal_flush(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   if (oJournal->iStatus != SUCCESS || oJournal->uBufferLength == 0)
+      return oJournal->iStatus;
+   if (!Journal_writeAll(oJournal->iFd, oJournal->pcBuffer,
+                         oJournal->uBufferLength) ||
+       fsync(oJournal->iFd) != 0)
+      oJournal->iStatus = IO_ERROR;
+   oJournal->uBufferLength = 0;
+   oJournal->uPending = 0;
+   return oJournal->iStatus;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_open(const char *pcPath, size_t uGroupSize,
+                 Journal_T *poJournal)
+{
+   Journal_T oJournal;
+   struct Header sHeader;
+   struct stat sStat;
+   int iFd;
+
+   assert(pcPath != NULL);
+   assert(poJournal != NULL);
+
+   oJournal = (Journal_T)malloc(sizeof(struct Journal));
+   if (oJournal == NULL)
+      return MEMORY_ERROR;
+   oJournal->pcPath = (char*)malloc(strlen(pcPath) + 1);
+   if (oJournal->pcPath == NULL)
+   {
+      free(oJournal);
+      return MEMORY_ERROR;
+   }
+   strcpy(oJournal->pcPath, pcPath);
+
+   iFd = open(pcPath, O_RDWR);
+   if (iFd < 0 && errno == ENOENT)
+   {
+      iFd = Journal_create(pcPath, 0);
+      if (iFd >= 0 && !Journal_syncDir(pcPath))
+      {
+         (void)close(iFd);
+         iFd = -1;
+      }
+      memset(&sHeader, 0, sizeof(sHeader));
+   }
+   else if (iFd >= 0 &&
+            (read(iFd, &sHeader, sizeof(sHeader))
+                != (ssize_t)sizeof(sHeader) ||
+             memcmp(sHeader.acMagic, JOURNAL_MAGIC,
+                    sizeof(sHeader.acMagic)) != 0 ||
+             sHeader.ulByteOrder != (uint32_t)JOURNAL_BYTE_ORDER))
+   {
+      (void)close(iFd);
+      iFd = -1;
+   }
+   if (iFd < 0 || fstat(iFd, &sStat) != 0)
+   {
+      if (iFd >= 0)
+         (void)close(iFd);
+      free(oJournal->pcPath);
+      free(oJournal);
+      return IO_ERROR;
+   }
+
+   oJournal->iFd = iFd;
+   oJournal->ulGeneration = (unsigned long)sHeader.ulGeneration;
+   oJournal->pcBuffer = NULL;
+   oJournal->uBufferLength = 0;
+   oJournal->uBufferSize = 0;
+   oJournal->uPending = 0;
+   oJournal->uGroupSize = uGroupSize == 0 ? 1 : uGroupSize;
+   oJournal->uLast = 0;
+   oJournal->uSize = (size_t)sStat.st_size;
+   oJournal->iStatus = SUCCESS;
+   *poJournal = oJournal;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *Journal_getPath(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   return oJournal->pcPath;
+}
+
+/*--------------------------------------------------------------------*/
+
+unsigned long Journal_getGeneration(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   return oJournal->ulGeneration;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Journal_getSize(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+
+   return oJournal->uSize;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_replay(Journal_T oJournal,
+                   int (*pfApply)(enum JournalOp eOp,
+                                  const char *pcPath,
+                                  const void *pvContents,
+                                  size_t uLength, void *pvExtra),
+                   void *pvExtra)
+{
+   char *pcFile;
+   struct Entry sEntry;
+   size_t uOffset = sizeof(struct Header);
+   size_t uRest;
+   size_t uRecord;
+   const char *pcPath;
+   const char *pcContents;
+   uint64_t ulSum;
+   ssize_t iRead;
+   size_t uRead = 0;
+   int iResult = SUCCESS;
+
+   assert(oJournal != NULL);
+   assert(pfApply != NULL);
+   assert(oJournal->uBufferLength == 0);
+
+   /* The journal is compacted as it grows, so read it whole */
+   pcFile = (char*)malloc(oJournal->uSize);
+   if (pcFile == NULL)
+      return MEMORY_ERROR;
+   while (uRead < oJournal->uSize)
+   {
+      iRead = pread(oJournal->iFd, pcFile + uRead,
+                    oJournal->uSize - uRead, (off_t)uRead);
+      if (iRead < 0 && errno == EINTR)
+         continue;
+      if (iRead <= 0)
+      {
+         free(pcFile);
+         return IO_ERROR;
+      }
+      uRead += (size_t)iRead;
+   }
+
+   while (iResult == SUCCESS)
+   {
+      uRest = oJournal->uSize - uOffset;
+      if (uRest < sizeof(sEntry))
+         break;
+      memcpy(&sEntry, pcFile + uOffset, sizeof(sEntry));
+      if (sEntry.ulPathLength >= uRest - sizeof(sEntry) ||
+          sEntry.ulHasContents > 1 ||
+          (sEntry.ulHasContents &&
+           sEntry.ulLength > uRest - sizeof(sEntry)
+                             - sEntry.ulPathLength - 1))
+         break;
+      uRecord = sizeof(sEntry) + (size_t)sEntry.ulPathLength + 1;
+      if (sEntry.ulHasContents)
+         uRecord += (size_t)sEntry.ulLength;
+      ulSum = Journal_checksum(FNV_OFFSET, pcFile + uOffset
+                               + sizeof(sEntry.ulChecksum),
+                               uRecord - sizeof(sEntry.ulChecksum));
+      pcPath = pcFile + uOffset + sizeof(sEntry);
+      if (ulSum != sEntry.ulChecksum ||
+          sEntry.ulOp > JOURNAL_RENAME ||
+          pcPath[sEntry.ulPathLength] != '\0')
+         break;
+      pcContents = sEntry.ulHasContents ?
+         pcPath + sEntry.ulPathLength + 1 : NULL;
+      iResult = (*pfApply)((enum JournalOp)sEntry.ulOp, pcPath,
+                           pcContents, (size_t)sEntry.ulLength,
+                           pvExtra);
+      uOffset += uRecord;
+   }
+   free(pcFile);
+
+   /* Drops the torn tail, if any, and appends after the sound part */
+   if (iResult == SUCCESS && uOffset < oJournal->uSize)
+   {
+      if (ftruncate(oJournal->iFd, (off_t)uOffset) != 0 ||
+          fsync(oJournal->iFd) != 0)
+         iResult = IO_ERROR;
+      else
+         oJournal->uSize = uOffset;
+   }
+   if (iResult == SUCCESS &&
+       lseek(oJournal->iFd, 0, SEEK_END) != (off_t)oJournal->uSize)
+      iResult = IO_ERROR;
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_append(Journal_T oJournal, enum JournalOp eOp,
+                   const char *pcPath, const void *pvContents,
+                   size_t uLength)
+{
+   struct Entry sEntry;
+   size_t uPathLength;
+   size_t uRecord;
+   size_t uSize;
+   char *pcGrown;
+   char *pcRecord;
+
+   assert(oJournal != NULL);
+   assert(pcPath != NULL);
+   assert(oJournal->uLast == 0);
+
+   if (oJournal->iStatus != SUCCESS)
+      return oJournal->iStatus;
+
+   uPathLength = strlen(pcPath);
+   uRecord = sizeof(sEntry) + uPathLength + 1;
+   if (pvContents != NULL)
+      uRecord += uLength;
+   if (oJournal->uBufferLength + uRecord > oJournal->uBufferSize)
+   {
+      uSize = oJournal->uBufferSize == 0 ? MIN_BUFFER
+                                         : oJournal->uBufferSize;
+      while (uSize < oJournal->uBufferLength + uRecord)
+         uSize *= 2;
+      /* Nothing is lost if the record cannot be buffered */
+      pcGrown = (char*)realloc(oJournal->pcBuffer, uSize);
+      if (pcGrown == NULL)
+         return MEMORY_ERROR;
+      oJournal->pcBuffer = pcGrown;
+      oJournal->uBufferSize = uSize;
+   }
+
+   pcRecord = oJournal->pcBuffer + oJournal->uBufferLength;
+   sEntry.ulChecksum = 0;
+   sEntry.ulOp = (uint32_t)eOp;
+   sEntry.ulHasContents = pvContents != NULL;
+   sEntry.ulPathLength = uPathLength;
+   sEntry.ulLength = uLength;
+   memcpy(pcRecord, &sEntry, sizeof(sEntry));
+   memcpy(pcRecord + sizeof(sEntry), pcPath, uPathLength + 1);
+   if (pvContents != NULL)
+      memcpy(pcRecord + sizeof(sEntry) + uPathLength + 1, pvContents,
+             uLength);
+   sEntry.ulChecksum = Journal_checksum(FNV_OFFSET,
+                                        pcRecord
+                                        + sizeof(sEntry.ulChecksum),
+                                        uRecord
+                                        - sizeof(sEntry.ulChecksum));
+   memcpy(pcRecord, &sEntry.ulChecksum, sizeof(sEntry.ulChecksum));
+   oJournal->uBufferLength += uRecord;
+   oJournal->uSize += uRecord;
+   oJournal->uPending++;
+   /* A record that completes a group is on disk before its change */
+   if (oJournal->uPending >= oJournal->uGroupSize &&
+       Journal_flush(oJournal) != SUCCESS)
+      return oJournal->iStatus;
+   oJournal->uLast = uRecord;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Journal_commit(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+   assert(oJournal->uLast != 0);
+
+   oJournal->uLast = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Journal_cancel(Journal_T oJournal)
+{
+   off_t iOffset;
+
+   assert(oJournal != NULL);
+   assert(oJournal->uLast != 0);
+
+   if (oJournal->uBufferLength != 0)
+   {
+      oJournal->uBufferLength -= oJournal->uLast;
+      oJournal->uPending--;
+   }
+   else if (oJournal->iStatus == SUCCESS)
+   {
+      /* The record was synced with its group, so cut it off the file */
+      iOffset = (off_t)(oJournal->uSize - oJournal->uLast);
+      if (ftruncate(oJournal->iFd, iOffset) != 0 ||
+          lseek(oJournal->iFd, iOffset, SEEK_SET) != iOffset ||
+          fsync(oJournal->iFd) != 0)
+         oJournal->iStatus = IO_ERROR;
+   }
+   oJournal->uSize -= oJournal->uLast;
+   oJournal->uLast = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_sync(Journal_T oJournal)
+{
+   assert(oJournal != NULL);
+   assert(oJournal->uLast == 0);
+
+   return Journal_flush(oJournal);
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_restart(Journal_T oJournal, unsigned long ulGeneration)
+{
+   char *pcTemp;
+   int iFd;
+
+   assert(oJournal != NULL);
+
+   if (Journal_sync(oJournal) != SUCCESS)
+      return oJournal->iStatus;
+
+   /* The new journal is complete on disk before it replaces the old */
+   pcTemp = (char*)malloc(strlen(oJournal->pcPath) + sizeof(".tmp"));
+   if (pcTemp == NULL)
+      return MEMORY_ERROR;
+   strcpy(pcTemp, oJournal->pcPath);
+   strcat(pcTemp, ".tmp");
+   iFd = Journal_create(pcTemp, ulGeneration);
+   if (iFd < 0 || rename(pcTemp, oJournal->pcPath) != 0)
+   {
+      /* The old journal is untouched, so it goes on taking records */
+      if (iFd >= 0)
+      {
+         (void)close(iFd);
+         (void)unlink(pcTemp);
+      }
+      free(pcTemp);
+      return IO_ERROR;
+   }
+   free(pcTemp);
+
+   (void)close(oJournal->iFd);
+   oJournal->iFd = iFd;
+   oJournal->ulGeneration = ulGeneration;
+   oJournal->uSize = sizeof(struct Header);
+   /* Until the rename is on disk, a crash may bring the old one back */
+   if (!Journal_syncDir(oJournal->pcPath))
+      oJournal->iStatus = IO_ERROR;
+   return oJournal->iStatus;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_close(Journal_T oJournal)
+{
+   int iResult;
+
+   assert(oJournal != NULL);
+
+   iResult = Journal_sync(oJournal);
+   if (close(oJournal->iFd) != 0 && iResult == SUCCESS)
+      iResult = IO_ERROR;
+   free(oJournal->pcBuffer);
+   free(oJournal->pcPath);
+   free(oJournal);
+   return iResult;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_syncFile(const char *pcPath, size_t *puSize)
+{
+   struct stat sStat;
+   int iFd;
+   int iResult = SUCCESS;
+
+   assert(pcPath != NULL);
+   assert(puSize != NULL);
+
+   iFd = open(pcPath, O_RDONLY);
+   if (iFd < 0)
+      return IO_ERROR;
+   if (fsync(iFd) != 0 || fstat(iFd, &sStat) != 0)
+      iResult = IO_ERROR;
+   else
+      *puSize = (size_t)sStat.st_size;
+   (void)close(iFd);
+   return iResult;
+}
@@ -0,0 +1,144 @@
+/*--------------------------------------------------------------------*/
+/* journal.h                                                          */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#ifndef JOURNAL_INCLUDED
+#define JOURNAL_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/* A Journal_T object is an append-only log of the changes made to a
+   file tree, kept in a file. Each change is a record holding the
+   operation, a path and, for a file, its contents, guarded by a
+   checksum. Records are buffered and written with one fsync per
+   group, so that a group of changes costs one trip to the disk.
+   The journal belongs to a generation, stored in its header, which
+   starts at 0 and names the snapshot the records apply on top of;
+   Journal_restart moves to a new generation atomically. */
+
+typedef struct Journal *Journal_T;
+
+/* The operations a record can hold. A JOURNAL_RENAME record holds
+   the old path, and the new path, with its '\0', as its contents. */
+
+enum JournalOp { JOURNAL_INSERT_DIR, JOURNAL_INSERT_FILE,
+                 JOURNAL_RM_DIR, JOURNAL_RM_FILE, JOURNAL_REPLACE,
+                 JOURNAL_RENAME };
+
+/*--------------------------------------------------------------------*/
+
+/* Open the journal in the file named pcPath, creating an empty one of
+   generation 0 if there is none, syncing after every uGroupSize
+   records, and store it in *poJournal. Return SUCCESS, IO_ERROR if
+   the file cannot be opened or created or is not a journal, or
+   MEMORY_ERROR if insufficient memory is available. */
+
+int Journal_open(const char *pcPath, size_t uGroupSize,
+                 Journal_T *poJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the path of the file of oJournal. */
+
+const char *Journal_getPath(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the generation of oJournal. */
+
+unsigned long Journal_getGeneration(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the size in bytes of oJournal, including the records that
+   are buffered but not yet written. */
+
+size_t Journal_getSize(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Call (*pfApply)(eOp, pcPath, pvContents, uLength, pvExtra) for each
+   record of oJournal, which must not have been appended to, in
+   order. pcPath is '\0'-terminated, and pvContents is NULL if the
+   record has no contents; both are valid only during the call.
+   Stops at the first record that is cut short or fails its checksum,
+   as the last group written before a crash can be, and truncates the
+   journal there, so that new records follow the last sound one.
+   Return SUCCESS, the first status other than SUCCESS that pfApply
+   returns, IO_ERROR if the file cannot be read or truncated, or
+   MEMORY_ERROR if insufficient memory is available. */
+
+int Journal_replay(Journal_T oJournal,
+                   int (*pfApply)(enum JournalOp eOp,
+                                  const char *pcPath,
+                                  const void *pvContents,
+                                  size_t uLength, void *pvExtra),
+                   void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* Append to oJournal a record of eOp on pcPath, with the uLength
+   bytes at pvContents, or no contents if pvContents is NULL, and sync
+   if it completes a group, so that a change can be recorded before it
+   is made. The record is then kept by Journal_commit once the change
+   is made, or dropped by Journal_cancel if it fails; until then,
+   oJournal takes no other call. Return SUCCESS, MEMORY_ERROR if the
+   record cannot be buffered, or IO_ERROR if this or an earlier write
+   or sync of oJournal failed, after which oJournal takes no more
+   records; the record is not kept unless SUCCESS is returned. */
+
+int Journal_append(Journal_T oJournal, enum JournalOp eOp,
+                   const char *pcPath, const void *pvContents,
+                   size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Keep the record last appended to oJournal. */
+
+void Journal_commit(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Drop the record last appended to oJournal, cutting it off the file
+   if it was synced with its group; if that fails, oJournal takes no
+   more records. */
+
+void Journal_cancel(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Write the buffered records of oJournal and wait until they are on
+   disk. Return SUCCESS, or IO_ERROR if this or an earlier write or
+   sync of oJournal failed. */
+
+int Journal_sync(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Sync oJournal, then replace it with an empty journal of generation
+   ulGeneration, atomically, so that a crash leaves either the old
+   journal or the new one. Return SUCCESS, MEMORY_ERROR if
+   insufficient memory is available, or IO_ERROR if the new journal
+   cannot be written, in which case oJournal goes on as it was, or
+   cannot be made to replace the old one durably, after which
+   oJournal takes no more records, or as Journal_sync does. */
+
+int Journal_restart(Journal_T oJournal, unsigned long ulGeneration);
+
+/*--------------------------------------------------------------------*/
+
+/* Sync oJournal, close its file and free it. Return SUCCESS, or as
+   Journal_sync does. */
+
+int Journal_close(Journal_T oJournal);
+
+/*--------------------------------------------------------------------*/
+
+/* Wait until the file named pcPath is on disk, and store its size in
+   *puSize. Return SUCCESS, or IO_ERROR if it cannot be synced. */
+
+int Journal_syncFile(const char *pcPath, size_t *puSize);
+
+#endif
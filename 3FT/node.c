@@ -8,16 +8,38 @@
 #include <assert.h>
 #include <stdio.h>
 
-#include "dynarray.h"
 #include "node.h"
+#include "pool.h"
+
+/* The capacity of a directory's children array when first grown */
+enum { MIN_CHILDREN = 2 };
+
+#ifdef FT_STATS
+/* The number of children arrays grown, for Node_getGrowCount */
+static size_t growCount;
+#endif
+
+/*
+   Readers may search a directory's children while a writer changes
+   them, without taking any lock. So a children array is never changed
+   in a way a reader could see half done: a child is appended in place
+   only past the end readers know of, and any other change builds a
+   new array and publishes it with a single release store. Replaced
+   arrays and destroyed nodes are retired to the pool, which reuses
+   them only once no reader can hold them.
+*/
 
 
 /*
    A node structure represents a directory in the file tree
 */
 struct node {
-   /* the full path of this directory/file */
-   char* path;
+   /* the name of this directory/file: the last component of its
+      path, which is rebuilt from the names of its ancestors */
+   char* name;
+
+   /* the length of name */
+   size_t nameLength;
 
    /* the parent directory of this directory
       NULL for the root of the file tree */
@@ -34,83 +56,188 @@ struct node {
    boolean status; 
 
 
-   /* the subdirectories of this directory
-      stored in sorted order by pathname */
-   DynArray_T children;
+   /* the files and subdirectories of this directory,
+      NULL if there are none, and always NULL for a file */
+   struct nodeArray* children;
+
+   /* the number of directories whose children include this node, plus
+      the number of trees and snapshots whose root it is; a node held
+      more than once is frozen, and is copied rather than changed.
+      Only writers, who hold the live tree's lock, use it */
+   size_t refs;
+
+   /* the number of files and of directories in the hierarchy rooted
+      at this node, itself included, and the total length of their
+      contents, kept up to date along the ancestors on every change */
+   size_t files;
+   size_t dirs;
+   size_t bytes;
+};
+
+/*
+   The children of a directory, stored in sorted order by name, files
+   first, in a block allocated from the tree's pool.
+*/
+struct nodeArray {
+   /* the number of children, and the number the array can hold */
+   size_t numChildren;
+   size_t capacity;
+
+   /* the children themselves */
+   Node_T nodes[];
+};
+
+
+/*
+   A search key for a child of some node: the first length characters
+   of name, which is the name of a file if status is TRUE and of a
+   directory otherwise. Lets the children be binary searched without
+   building a throwaway node for the comparison.
+*/
+struct nodeKey {
+   const char* name;
+   size_t length;
+   boolean status;
 };
 
 
 /*
-  returns a path with contents
-  n->path/dir
+  returns a copy of the first length characters of dir,
   or NULL if there is an allocation error.
-  Allocates memory for the returned string,
+  Allocates memory for the returned string from pool,
   which is then owned by the caller!
 */
-static char* Node_buildPath(Node_T n, const char* dir) {
-   char* path;
+static char* Node_copyName(const char* dir, size_t length,
+                           Pool_T pool) {
+   char* name;
 
    assert(dir != NULL);
+   assert(pool != NULL);
 
-   if(n == NULL)
-      path = malloc(strlen(dir)+1);
-   else
-      path = malloc(strlen(n->path) + 1 + strlen(dir) + 1);
-
-   if(path == NULL)
+   name = Pool_alloc(pool, length + 1);
+   if(name == NULL)
       return NULL;
-   *path = '\0'; 
+   memcpy(name, dir, length);
+   name[length] = '\0';
 
-   if(n != NULL) {
-      strcpy(path, n->path);
-      strcat(path, "/");
-   }
-   strcat(path, dir);
-   
-   return path;
+   return name;
+}
+
+/*
+   Returns the size of the block that holds a struct nodeArray with
+   room for capacity children.
+*/
+static size_t Node_arraySize(size_t capacity) {
+   return sizeof(struct nodeArray) + capacity * sizeof(Node_T);
+}
+
+/*
+   Returns the array of n's children as last published, or NULL if n
+   has none. The children the array held when it was published, and
+   the count, stay valid for the duration of the reader's epoch.
+*/
+static struct nodeArray* Node_loadChildren(Node_T n) {
+   assert(n != NULL);
+
+   return __atomic_load_n(&n->children, __ATOMIC_ACQUIRE);
+}
+
+/*
+   Returns n's parent, or NULL if n is the root. Copying a directory
+   moves the parent links of its children to the copy while readers
+   climb them.
+*/
+static Node_T Node_loadParent(Node_T n) {
+   assert(n != NULL);
+
+   return __atomic_load_n(&n->parent, __ATOMIC_ACQUIRE);
+}
+
+/*
+   Returns the number of children in array, which may be NULL.
+*/
+static size_t Node_loadCount(struct nodeArray* array) {
+   if(array == NULL)
+      return 0;
+   return __atomic_load_n(&array->numChildren, __ATOMIC_ACQUIRE);
 }
 
 /*
-  Compares node1 and node2 based on their paths.
-  Returns <0, 0, or >0 if node1 is less than,
-  equal to, or greater than node2, respectively. Places file in
-  front of directories.
+   Compares the first key->length characters of key->name, taken as
+   the name of a node with status key->status, against n's name.
+   Files come before directories, and nodes with the same status are
+   in lexicographic order of their names.
+   Returns <0, 0, or >0 if the key is less than, equal to, or greater
+   than n, respectively.
 */
-static int Node_compare(Node_T node1, Node_T node2) {
-   assert(node1 != NULL);
-   assert(node2 != NULL);
-   if (Node_getStatus(node1) && !Node_getStatus(node2))
+static int Node_compareKey(const struct nodeKey* key, Node_T n) {
+   int result;
+
+   assert(key != NULL);
+   assert(n != NULL);
+   if (key->status && !Node_getStatus(n))
       return -1;
-   if (!Node_getStatus(node1) && Node_getStatus(node2))
-       return 1;
-   return strcmp(node1->path, node2->path);
+   if (!key->status && Node_getStatus(n))
+      return 1;
+   result = strncmp(key->name, n->name, key->length);
+   if (result != 0)
+      return result;
+   /* The key is a proper prefix of n's name */
+   if (n->nameLength != key->length)
+      return -1;
+   return 0;
 }
 
 /*
-   Returns 1 if n has a child directory with path,
-   0 if it does not have such a child, and -1 if
-   there is an allocation error during search.
-   If n does have such a child, and childID is not NULL, store the
-   child's identifier in *childID. If n does not have such a child,
-   store the identifier that such a child would have in *childID.
+   Binary searches array, which may be NULL, for a child matching key.
+   Returns 1 if there is one, storing its index in *childID, and 0 if
+   not, storing in *childID the index such a child would have.
 */
-static int Node_hasChild(Node_T n, const char* path, size_t* childID) {
+static int Node_searchArray(struct nodeArray* array,
+                            const struct nodeKey* key, size_t* childID) {
+   size_t index = 0;
+   size_t high;
+   size_t middle;
+   int compare;
+   int result;
+
+   assert(key != NULL);
+   assert(childID != NULL);
+
+   high = Node_loadCount(array);
+   result = 0;
+   while(index < high) {
+      middle = index + (high - index) / 2;
+      compare = Node_compareKey(key, array->nodes[middle]);
+      if(compare < 0)
+         high = middle;
+      else if(compare > 0)
+         index = middle + 1;
+      else {
+         index = middle;
+         result = 1;
+         break;
+      }
+   }
+
+   *childID = index;
+   return result;
+}
+
+/* see node.h for specification */
+int Node_hasChild(Node_T n, const char* name, size_t length,
+                  boolean status, size_t* childID) {
+   struct nodeKey key;
    size_t index;
    int result;
-   Node_T checker;
 
    assert(n != NULL);
-   assert(path != NULL);
-   /* To avoid using a variable before its definition */
-   index = 0; 
+   assert(name != NULL);
 
-   checker = Node_create(path, NULL);
-   if(checker == NULL) {
-      return -1;
-   }
-   result = DynArray_bsearch(n->children, checker, &index,
-                             (int (*)(const void*, const void*)) Node_compare);
-   (void) Node_destroy(checker);
+   key.name = name;
+   key.length = length;
+   key.status = status;
+   result = Node_searchArray(Node_loadChildren(n), &key, &index);
 
    if(childID != NULL)
       *childID = index;
@@ -118,12 +245,49 @@ static int Node_hasChild(Node_T n, const char* path, size_t* childID) {
    return result;
 }
 
+/*
+   Adds files, dirs and bytes to the totals of n and of each of its
+   ancestors. A change that takes nodes away passes the negations,
+   which wrap around to the same result. Readers load the totals
+   without a lock, so each is stored whole.
+*/
+static void Node_addUp(Node_T n, size_t files, size_t dirs,
+                       size_t bytes) {
+   for(; n != NULL; n = n->parent) {
+      __atomic_store_n(&n->files, n->files + files, __ATOMIC_RELAXED);
+      __atomic_store_n(&n->dirs, n->dirs + dirs, __ATOMIC_RELAXED);
+      __atomic_store_n(&n->bytes, n->bytes + bytes, __ATOMIC_RELAXED);
+   }
+}
+
 /* see node.h for specification */
 void Node_changeFileContents(Node_T n, void* newContents,
                              size_t newLength){
    assert (n != NULL); 
-   n->contents = newContents;
-   n->length = newLength; 
+   Node_addUp(n, 0, 0, newLength - n->length);
+   __atomic_store_n(&n->contents, newContents, __ATOMIC_RELAXED);
+   __atomic_store_n(&n->length, newLength, __ATOMIC_RELAXED);
+}
+
+/* see node.h for specification */
+void Node_getTotals(Node_T n, size_t* files, size_t* dirs,
+                    size_t* bytes) {
+   assert(n != NULL);
+   assert(files != NULL);
+   assert(dirs != NULL);
+   assert(bytes != NULL);
+   *files = __atomic_load_n(&n->files, __ATOMIC_RELAXED);
+   *dirs = __atomic_load_n(&n->dirs, __ATOMIC_RELAXED);
+   *bytes = __atomic_load_n(&n->bytes, __ATOMIC_RELAXED);
+}
+
+/* see node.h for specification */
+void Node_addTotals(Node_T parent, Node_T child) {
+   assert(parent != NULL);
+   assert(child != NULL);
+   parent->files += child->files;
+   parent->dirs += child->dirs;
+   parent->bytes += child->bytes;
 }
 
 
@@ -137,28 +301,30 @@ boolean Node_getStatus(Node_T n){
 /* see node.h for specification */
 void *Node_getFileContents(Node_T n){
    assert (n != NULL); 
-   return n->contents; 
+   return __atomic_load_n(&n->contents, __ATOMIC_RELAXED); 
 }
 
 /* see node.h for specification */
 size_t Node_getFileLength(Node_T n){
    assert (n != NULL); 
-   return n->length; 
+   return __atomic_load_n(&n->length, __ATOMIC_RELAXED); 
 }
 
 /* see node.h for specification */
 
-Node_T Node_addFile(const char* dir, Node_T parent,
-                    void* contents, size_t length){
+Node_T Node_addFile(const char* dir, size_t nameLength, Node_T parent,
+                    void* contents, size_t length, Pool_T pool){
    Node_T new;
    assert (parent != NULL);
    assert (dir != NULL);
-   new = (Node_T) malloc(sizeof(struct node)); 
+   assert (pool != NULL);
+   new = (Node_T) Pool_alloc(pool, sizeof(struct node)); 
    if (new == NULL)
       return NULL;
-   new->path = Node_buildPath(parent,dir);
-   if(new->path == NULL){
-      free(new);
+   new->nameLength = nameLength;
+   new->name = Node_copyName(dir, nameLength, pool);
+   if(new->name == NULL){
+      Pool_release(pool, new, sizeof(struct node));
       return NULL;
    }
    new->status = TRUE; 
@@ -166,102 +332,419 @@ Node_T Node_addFile(const char* dir, Node_T parent,
    new->contents = contents;
    new->length = length;
    new->children = NULL; 
+   new->refs = 1;
+   new->files = 1;
+   new->dirs = 0;
+   new->bytes = length;
    return new; 
    
 }
 /* see node.h for specification */
-Node_T Node_create(const char* dir, Node_T parent){
+Node_T Node_create(const char* dir, size_t length, Node_T parent,
+                   Pool_T pool){
    Node_T new;
    
    assert(dir != NULL);
+   assert(pool != NULL);
 
-   new = (Node_T) malloc(sizeof(struct node));
+   new = (Node_T) Pool_alloc(pool, sizeof(struct node));
    if(new == NULL) {
       return NULL;
    }
 
-   new->path = Node_buildPath(parent, dir);
+   new->nameLength = length;
+   new->name = Node_copyName(dir, length, pool);
    new->status = FALSE; 
    new->contents = NULL;
    new->length = 0; 
-   if(new->path == NULL) {
-      free(new);
+   if(new->name == NULL) {
+      Pool_release(pool, new, sizeof(struct node));
       return NULL;
    }
 
    new->parent = parent;
-   new->children = DynArray_new(0);
-   if(new->children == NULL) {
-      free(new->path);
-      free(new);
-      return NULL;
-   } 
+   new->children = NULL;
+   new->refs = 1;
+   new->files = 0;
+   new->dirs = 1;
+   new->bytes = 0;
    return new;
 }
 
-/* see node.h for specification */
-size_t Node_destroy(Node_T n) {
-   size_t i;
+/*
+   Retires n, its name and its children array, but not its children,
+   to pool.
+*/
+static void Node_retire(Node_T n, Pool_T pool) {
+   assert(n != NULL);
+   assert(pool != NULL);
+
+   if(n->children != NULL)
+      Pool_retire(pool, n->children,
+                  Node_arraySize(n->children->capacity));
+   Pool_retire(pool, n->name, n->nameLength + 1);
+   Pool_retire(pool, n, sizeof(struct node));
+}
+
+/*
+   Drops one hold on n, and destroys n, once nothing holds it, and
+   each descendant that then has nothing holding it either, retiring
+   their memory to pool. A descendant that a snapshot still holds is
+   kept, and is walked only if countAll is TRUE.
+   Returns the number of nodes walked.
+*/
+static size_t Node_drop(Node_T n, boolean countAll, Pool_T pool) {
+   Node_T curr;
+   Node_T child;
+   Node_T parent;
+   size_t i = 0;
    size_t count = 0;
-   Node_T c;
 
    assert(n != NULL);
-   if (Node_getStatus(n) != TRUE){
-      for(i = 0; i < DynArray_getLength(n->children); i++) {
-         if (n->status == FALSE) {
-            c = DynArray_get(n->children, i);
-            count += Node_destroy(c);
+   assert(pool != NULL);
+   assert(n->refs > 0);
+
+   n->refs--;
+   if(n->refs > 0 && !countAll)
+      return 0;
+
+   /* Walks the hierarchy without recursion, so that a chain of any
+      depth can be destroyed: curr is the directory being emptied and
+      i the index of its next child. A child with no children of its
+      own is destroyed on the spot; any other is descended into, and
+      when it is empty, its position under its parent is found again
+      by binary search. Only a directory that is going releases its
+      children. A node may be shared by several parents, so the way
+      back up is stored in the parent link of each node descended
+      into: none of them is in the live tree any more. */
+   curr = n;
+   for(;;) {
+      while(curr->children != NULL &&
+            i < curr->children->numChildren) {
+         child = curr->children->nodes[i];
+         if(curr->refs == 0)
+            child->refs--;
+         if(child->children != NULL &&
+            child->children->numChildren > 0 &&
+            (countAll || child->refs == 0)) {
+            __atomic_store_n(&child->parent, curr, __ATOMIC_RELEASE);
+            curr = child;
+            i = 0;
          }
+         else {
+            if(child->refs == 0)
+               Node_retire(child, pool);
+            count++;
+            i++;
+         }
+      }
+
+      parent = curr->parent;
+      if(curr != n)
+         (void) Node_hasChild(parent, curr->name, curr->nameLength,
+                              curr->status, &i);
+      if(curr->refs == 0)
+         Node_retire(curr, pool);
+      count++;
+      if(curr == n)
+         return count;
+      curr = parent;
+      i++;
+   }
+}
+
+/* see node.h for specification */
+size_t Node_destroy(Node_T n, Pool_T pool) {
+   assert(n != NULL);
+   assert(pool != NULL);
+
+   return Node_drop(n, TRUE, pool);
+}
+
+/* see node.h for specification */
+void Node_release(Node_T n, Pool_T pool) {
+   assert(n != NULL);
+   assert(pool != NULL);
+
+   (void) Node_drop(n, FALSE, pool);
+}
+
+/* see node.h for specification */
+void Node_share(Node_T n) {
+   assert(n != NULL);
+
+   n->refs++;
+}
+
+/* see node.h for specification */
+boolean Node_isShared(Node_T n) {
+   assert(n != NULL);
+
+   return (boolean) (n->refs > 1);
+}
+
+/* see node.h for specification */
+Node_T Node_copy(Node_T n, Pool_T pool) {
+   Node_T copy;
+   size_t numChildren;
+
+   assert(n != NULL);
+   assert(pool != NULL);
+
+   copy = Pool_alloc(pool, sizeof(struct node));
+   if(copy == NULL)
+      return NULL;
+   *copy = *n;
+   copy->refs = 1;
+   copy->name = Node_copyName(n->name, n->nameLength, pool);
+   if(copy->name == NULL) {
+      Pool_release(pool, copy, sizeof(struct node));
+      return NULL;
+   }
+   if(n->children != NULL) {
+      copy->children = Pool_alloc(pool,
+                                  Node_arraySize(n->children->capacity));
+      if(copy->children == NULL) {
+         Pool_release(pool, copy->name, copy->nameLength + 1);
+         Pool_release(pool, copy, sizeof(struct node));
+         return NULL;
       }
-      if (n->children != NULL)
-      DynArray_free(n->children);
+      numChildren = n->children->numChildren;
+      copy->children->numChildren = numChildren;
+      copy->children->capacity = n->children->capacity;
+      memcpy(copy->children->nodes, n->children->nodes,
+             numChildren * sizeof(Node_T));
+   }
+   return copy;
+}
+
+/* see node.h for specification */
+void Node_discard(Node_T copy, Pool_T pool) {
+   assert(copy != NULL);
+   assert(pool != NULL);
+
+   if(copy->children != NULL)
+      Pool_release(pool, copy->children,
+                   Node_arraySize(copy->children->capacity));
+   Pool_release(pool, copy->name, copy->nameLength + 1);
+   Pool_release(pool, copy, sizeof(struct node));
+}
+
+/* see node.h for specification */
+void Node_setChild(Node_T copy, Node_T old, Node_T new) {
+   size_t i = 0;
+   int found;
+
+   assert(copy != NULL);
+   assert(old != NULL);
+   assert(new != NULL);
+
+   found = Node_hasChild(copy, old->name, old->nameLength,
+                         old->status, &i);
+   assert(found && copy->children->nodes[i] == old);
+   (void) found;
+
+   copy->children->nodes[i] = new;
+   new->parent = copy;
+}
+
+/* see node.h for specification */
+void Node_claimChildren(Node_T copy) {
+   Node_T child;
+   size_t i;
+
+   assert(copy != NULL);
+
+   for(i = 0; i < Node_loadCount(copy->children); i++) {
+      child = copy->children->nodes[i];
+      if(child->parent == copy)
+         continue;
+      child->refs++;
+      __atomic_store_n(&child->parent, copy, __ATOMIC_RELEASE);
    }
-   free(n->path);
-   free(n);
-   count++;
+}
+
+/* see node.h for specification */
+int Node_replaceChild(Node_T parent, Node_T old, Node_T new,
+                      Pool_T pool) {
+   struct nodeArray* array;
+   struct nodeArray* copy;
+   size_t i = 0;
+   int found;
+
+   assert(parent != NULL);
+   assert(old != NULL);
+   assert(new != NULL);
+   assert(pool != NULL);
+
+   found = Node_hasChild(parent, old->name, old->nameLength,
+                         old->status, &i);
+   array = parent->children;
+   assert(found && array->nodes[i] == old);
+   assert(old->refs > 1);
+   (void) found;
+
+   copy = Pool_alloc(pool, Node_arraySize(array->capacity));
+   if(copy == NULL)
+      return MEMORY_ERROR;
+   copy->numChildren = array->numChildren;
+   copy->capacity = array->capacity;
+   memcpy(copy->nodes, array->nodes,
+          array->numChildren * sizeof(Node_T));
+   copy->nodes[i] = new;
+   new->parent = parent;
+
+   __atomic_store_n(&parent->children, copy, __ATOMIC_RELEASE);
+   Pool_retire(pool, array, Node_arraySize(array->capacity));
+   old->refs--;
+   return SUCCESS;
+}
+
+/* see node.h for specification */
+const char* Node_getName(Node_T n) {
+   assert(n != NULL);
 
-   return count;
+   return n->name;
 }
 
 /* see node.h for specification */
+size_t Node_getNameLength(Node_T n) {
+   assert(n != NULL);
 
+   return n->nameLength;
+}
+
+/* see node.h for specification */
+size_t Node_getPathLength(Node_T n) {
+   size_t length;
 
-const char* Node_getPath(Node_T n) {
    assert(n != NULL);
 
-   return n->path;
+   length = n->nameLength;
+   for(n = Node_loadParent(n); n != NULL; n = Node_loadParent(n))
+      length += n->nameLength + 1;
+
+   return length;
 }
 
+/* see node.h for specification */
+char* Node_getPath(Node_T n, char* path) {
+   char* end;
+
+   assert(n != NULL);
+   assert(path != NULL);
 
+   /* Fills in the names from the last component back to the root */
+   end = path + Node_getPathLength(n);
+   *end = '\0';
+   for(;;) {
+      end -= n->nameLength;
+      memcpy(end, n->name, n->nameLength);
+      n = Node_loadParent(n);
+      if(n == NULL)
+         break;
+      *--end = '/';
+   }
+   assert(end == path);
+
+   return path;
+}
+
+/* see node.h for specification */
+boolean Node_hasPath(Node_T n, const char* path, size_t length) {
+   assert(n != NULL);
+   assert(path != NULL);
+
+   /* Matches the names against path from its last component back */
+   for(;;) {
+      if(length < n->nameLength ||
+         memcmp(path + length - n->nameLength, n->name,
+                n->nameLength) != 0)
+         return FALSE;
+      length -= n->nameLength;
+      n = Node_loadParent(n);
+      if(n == NULL)
+         return (boolean) (length == 0);
+      if(length == 0 || path[length - 1] != '/')
+         return FALSE;
+      length--;
+   }
+}
 
 /* see node.h for specification */
 size_t Node_getNumChildren(Node_T n) {
    assert(n != NULL);
-   if (n->status == TRUE) return 0;
-   assert (n->children != NULL); 
 
-   return DynArray_getLength(n->children);
+   return Node_loadCount(Node_loadChildren(n));
 }
 
 
 
 /* see node.h for specification */
 Node_T Node_getChild(Node_T n, size_t childID) {
+   struct nodeArray* array;
+
    assert(n != NULL);
 
-   if(DynArray_getLength(n->children) > childID) {
-      return DynArray_get(n->children, childID);
+   array = Node_loadChildren(n);
+   if(Node_loadCount(array) > childID) {
+      return array->nodes[childID];
    }
    else {
       return NULL;
    }
 }
 
+/* see node.h for specification */
+Node_T Node_findChild(Node_T n, const char* name, size_t length) {
+   struct nodeArray* array;
+   struct nodeKey key;
+   size_t i;
+
+   assert(n != NULL);
+   assert(name != NULL);
+
+   /* Searches one published array, so both groups are consistent */
+   array = Node_loadChildren(n);
+   key.name = name;
+   key.length = length;
+
+   /* Files are stored before directories, so look in each group */
+   key.status = TRUE;
+   if(Node_searchArray(array, &key, &i))
+      return array->nodes[i];
+   key.status = FALSE;
+   if(Node_searchArray(array, &key, &i))
+      return array->nodes[i];
+   return NULL;
+}
+
+/* see node.h for specification */
+Node_T Node_getChildAfter(Node_T n, const char* name, size_t length,
+                          boolean status) {
+   struct nodeArray* array;
+   struct nodeKey key;
+   size_t i;
+
+   assert(n != NULL);
+   assert(name != NULL);
+
+   array = Node_loadChildren(n);
+   key.name = name;
+   key.length = length;
+   key.status = status;
+   if(Node_searchArray(array, &key, &i))
+      i++;
+   if(i < Node_loadCount(array))
+      return array->nodes[i];
+   return NULL;
+}
+
 /* see node.h for specification */
 Node_T Node_getParent(Node_T n) {
    assert(n != NULL);
 
-   return n->parent;
+   return Node_loadParent(n);
 }
 
 
@@ -269,80 +752,279 @@ Node_T Node_getParent(Node_T n) {
 
 
 /* see node.h for specification */
-int Node_linkChild(Node_T parent, Node_T child) {
+int Node_linkChild(Node_T parent, Node_T child, Pool_T pool) {
    size_t i;
-   char* rest;
+   size_t numChildren;
+   size_t capacity;
+   struct nodeArray* old;
+   struct nodeArray* new;
 
    assert(parent != NULL);
    assert(child != NULL);
+   assert(pool != NULL);
   
-   /* Checks if already in tree */ 
-   if(Node_hasChild(parent, child->path, NULL)) {
-      return ALREADY_IN_TREE;
-   }
-   i = strlen(parent->path);
-   
-   /* Checks for parent-child errors */ 
-   if(strncmp(child->path, parent->path, i)) {
+   /* Checks for parent-child errors: child's name must be exactly
+      one non-empty path component */ 
+   if(parent->status == TRUE || child->nameLength == 0 ||
+      memchr(child->name, '/', child->nameLength) != NULL) {
       return PARENT_CHILD_ERROR;
    }
-   rest = child->path + i;
-   if(strlen(child->path) >= i && rest[0] != '/') {
-      return PARENT_CHILD_ERROR;
-   }
-   rest++;
-   if(strstr(rest, "/") != NULL) {
-      return PARENT_CHILD_ERROR;
+   /* Checks if already in tree with the other status */ 
+   if(Node_hasChild(parent, child->name, child->nameLength,
+                    (boolean) !child->status, NULL)) {
+      return ALREADY_IN_TREE;
    }
-   child->parent = parent;
-   /* Checks if already in tree */ 
-   if(DynArray_bsearch(parent->children, child, &i,
-                       (int (*)(const void*, const void*)) Node_compare) == 1) {
+   /* Checks if already in tree, and finds where child belongs */ 
+   if(Node_hasChild(parent, child->name, child->nameLength,
+                    child->status, &i)) {
       return ALREADY_IN_TREE;
    }
 
-   if(DynArray_addAt(parent->children, i, child) == TRUE) {
+   child->parent = parent;
+   old = parent->children;
+   numChildren = (old == NULL) ? 0 : old->numChildren;
+   capacity = (old == NULL) ? 0 : old->capacity;
+
+   /* A child that sorts last is stored past the published count,
+      which is then raised, so readers never see it half stored */
+   if(i == numChildren && numChildren < capacity) {
+      old->nodes[i] = child;
+      __atomic_store_n(&old->numChildren, numChildren + 1,
+                       __ATOMIC_RELEASE);
+      Node_addUp(parent, child->files, child->dirs, child->bytes);
       return SUCCESS;
    }
-   else {
-      return PARENT_CHILD_ERROR;
+
+   /* Otherwise builds the new array beside the old one, growing it
+      geometrically when it is full */
+   if(numChildren == capacity) {
+      capacity = (capacity == 0) ? MIN_CHILDREN : 2 * capacity;
+#ifdef FT_STATS
+      (void) __atomic_fetch_add(&growCount, 1, __ATOMIC_RELAXED);
+#endif
+   }
+   new = Pool_alloc(pool, Node_arraySize(capacity));
+   if(new == NULL)
+      return MEMORY_ERROR;
+   new->numChildren = numChildren + 1;
+   new->capacity = capacity;
+   if(old != NULL) {
+      memcpy(new->nodes, old->nodes, i * sizeof(Node_T));
+      memcpy(new->nodes + i + 1, old->nodes + i,
+             (numChildren - i) * sizeof(Node_T));
    }
+   new->nodes[i] = child;
+   __atomic_store_n(&parent->children, new, __ATOMIC_RELEASE);
+   if(old != NULL)
+      Pool_retire(pool, old, Node_arraySize(old->capacity));
+   Node_addUp(parent, child->files, child->dirs, child->bytes);
+   return SUCCESS;
 }
 
 /* see node.h for specification */
-int  Node_unlinkChild(Node_T parent, Node_T child) {
+int Node_appendChild(Node_T parent, Node_T child, Pool_T pool) {
+   struct nodeArray* array;
+   struct nodeKey key;
+   size_t numChildren;
+   size_t capacity;
+
+   assert(parent != NULL);
+   assert(child != NULL);
+   assert(pool != NULL);
+   assert(parent->status == FALSE);
+
+   array = parent->children;
+   numChildren = (array == NULL) ? 0 : array->numChildren;
+   capacity = (array == NULL) ? 0 : array->capacity;
+   key.name = child->name;
+   key.length = child->nameLength;
+   key.status = child->status;
+   assert(numChildren == 0 ||
+          Node_compareKey(&key, array->nodes[numChildren - 1]) > 0);
+
+   /* No reader can reach parent yet, so a full array is simply
+      reallocated, geometrically bigger */
+   if(numChildren == capacity) {
+      capacity = (capacity == 0) ? MIN_CHILDREN : 2 * capacity;
+#ifdef FT_STATS
+      (void) __atomic_fetch_add(&growCount, 1, __ATOMIC_RELAXED);
+#endif
+      array = Pool_realloc(pool, array,
+                           (array == NULL) ? 0 :
+                           Node_arraySize(array->capacity),
+                           Node_arraySize(capacity));
+      if(array == NULL)
+         return MEMORY_ERROR;
+      array->numChildren = numChildren;
+      array->capacity = capacity;
+      parent->children = array;
+   }
+   array->nodes[numChildren] = child;
+   array->numChildren = numChildren + 1;
+   child->parent = parent;
+   return SUCCESS;
+}
+
+/* see node.h for specification */
+int  Node_unlinkChild(Node_T parent, Node_T child, Pool_T pool) {
    size_t i;
+   size_t numChildren;
+   struct nodeArray* old;
+   struct nodeArray* new;
 
    assert(parent != NULL);
    assert(child != NULL);
+   assert(pool != NULL);
    /* To avoid using a variable before its definition */
    i = 0; 
-   if(DynArray_bsearch(parent->children, child, &i,
-                       (int (*)(const void*, const void*)) Node_compare) == 0) {
+   old = parent->children;
+   if(!Node_hasChild(parent, child->name, child->nameLength,
+                     child->status, &i) ||
+      old->nodes[i] != child) {
       return PARENT_CHILD_ERROR;
    }
+   numChildren = old->numChildren - 1;
+
+   /* Publishes an array without child, rather than shifting the
+      children in place under readers. The count of a published array
+      never goes down, so a slot past it is never in a reader's view
+      when an append fills it. */
+   new = NULL;
+   if(numChildren != 0) {
+      new = Pool_alloc(pool, Node_arraySize(old->capacity));
+      if(new == NULL)
+         return MEMORY_ERROR;
+      new->numChildren = numChildren;
+      new->capacity = old->capacity;
+      memcpy(new->nodes, old->nodes, i * sizeof(Node_T));
+      memcpy(new->nodes + i, old->nodes + i + 1,
+             (numChildren - i) * sizeof(Node_T));
+   }
+   __atomic_store_n(&parent->children, new, __ATOMIC_RELEASE);
+   Pool_retire(pool, old, Node_arraySize(old->capacity));
+   Node_addUp(parent, 0 - child->files, 0 - child->dirs,
+              0 - child->bytes);
 
-   (void) DynArray_removeAt(parent->children, i);
+   return SUCCESS;
+}
+
+/* see node.h for specification */
+int Node_move(Node_T n, Node_T newParent, const char* name,
+              size_t length, void (*pfQuiesce)(void), Pool_T pool) {
+   Node_T oldParent;
+   char* newName;
+   struct nodeArray* old = NULL;
+   struct nodeArray* without = NULL;
+   struct nodeArray* source = NULL;
+   struct nodeArray* with = NULL;
+   struct nodeKey key;
+   size_t i = 0;
+   size_t j = 0;
+   size_t numChildren;
+   size_t capacity;
+   int found;
 
+   assert(n != NULL);
+   assert(name != NULL);
+   assert(pool != NULL);
+   oldParent = n->parent;
+   assert((oldParent == NULL) == (newParent == NULL));
+
+   /* Allocates everything first, so that nothing can fail once n has
+      been hidden */
+   newName = Node_copyName(name, length, pool);
+   if(newName == NULL)
+      return MEMORY_ERROR;
+   if(oldParent != NULL) {
+      old = oldParent->children;
+      found = Node_hasChild(oldParent, n->name, n->nameLength,
+                            n->status, &i);
+      assert(found && old->nodes[i] == n);
+      numChildren = old->numChildren - 1;
+      if(numChildren != 0) {
+         without = Pool_alloc(pool, Node_arraySize(old->capacity));
+         if(without == NULL) {
+            Pool_release(pool, newName, length + 1);
+            return MEMORY_ERROR;
+         }
+         without->numChildren = numChildren;
+         without->capacity = old->capacity;
+         memcpy(without->nodes, old->nodes, i * sizeof(Node_T));
+         memcpy(without->nodes + i, old->nodes + i + 1,
+                (numChildren - i) * sizeof(Node_T));
+      }
+
+      /* The array newParent will have: n among the children it has
+         once n has left, placed by its new name */
+      source = (newParent == oldParent) ? without : newParent->children;
+      key.name = name;
+      key.length = length;
+      key.status = n->status;
+      found = Node_searchArray(source, &key, &j);
+      assert(!found);
+      numChildren = (source == NULL) ? 0 : source->numChildren;
+      capacity = (source == NULL) ? 0 : source->capacity;
+      if(numChildren == capacity)
+         capacity = (capacity == 0) ? MIN_CHILDREN : 2 * capacity;
+      with = Pool_alloc(pool, Node_arraySize(capacity));
+      if(with == NULL) {
+         if(without != NULL)
+            Pool_release(pool, without, Node_arraySize(old->capacity));
+         Pool_release(pool, newName, length + 1);
+         return MEMORY_ERROR;
+      }
+      with->numChildren = numChildren + 1;
+      with->capacity = capacity;
+      if(source != NULL) {
+         memcpy(with->nodes, source->nodes, j * sizeof(Node_T));
+         memcpy(with->nodes + j + 1, source->nodes + j,
+                (numChildren - j) * sizeof(Node_T));
+      }
+      with->nodes[j] = n;
+
+      /* Hides n, so that no new search can meet it */
+      __atomic_store_n(&oldParent->children, without, __ATOMIC_RELEASE);
+      Pool_retire(pool, old, Node_arraySize(old->capacity));
+      Node_addUp(oldParent, 0 - n->files, 0 - n->dirs, 0 - n->bytes);
+   }
+
+   /* A search already under way could meet n with its new name in an
+      array sorted by its old one, and go the wrong way past it, so the
+      name changes only once every such search is over */
+   if(pfQuiesce != NULL)
+      (*pfQuiesce)();
+   Pool_retire(pool, n->name, n->nameLength + 1);
+   n->name = newName;
+   n->nameLength = length;
+   __atomic_store_n(&n->parent, newParent, __ATOMIC_RELEASE);
+
+   if(newParent != NULL) {
+      source = newParent->children;
+      __atomic_store_n(&newParent->children, with, __ATOMIC_RELEASE);
+      if(source != NULL)
+         Pool_retire(pool, source, Node_arraySize(source->capacity));
+      Node_addUp(newParent, n->files, n->dirs, n->bytes);
+   }
    return SUCCESS;
 }
 
 
 /* see node.h for specification */
-int Node_addChild(Node_T parent, const char* dir) {
+int Node_addChild(Node_T parent, const char* dir, Pool_T pool) {
    Node_T new;
    int result;
 
    assert(parent != NULL);
    assert(dir != NULL);
+   assert(pool != NULL);
 
-   new = Node_create(dir, parent);
+   new = Node_create(dir, strlen(dir), parent, pool);
    if(new == NULL) {
       return PARENT_CHILD_ERROR;
    }
-   result = Node_linkChild(parent, new);
+   result = Node_linkChild(parent, new, pool);
    if(result != SUCCESS)
-      (void) Node_destroy(new);
+      (void) Node_destroy(new, pool);
 
    return result;
 }
@@ -354,11 +1036,18 @@ char* Node_toString(Node_T n) {
 
    assert(n != NULL);
 
-   copyPath = malloc(strlen(n->path)+1);
+   copyPath = malloc(Node_getPathLength(n)+1);
    if(copyPath == NULL) {
       return NULL;
    }
    else {
-      return strcpy(copyPath, n->path);
+      return Node_getPath(n, copyPath);
    }
 }
+
+#ifdef FT_STATS
+/* see node.h for specification */
+size_t Node_getGrowCount(void) {
+   return __atomic_load_n(&growCount, __ATOMIC_RELAXED);
+}
+#endif
@@ -8,51 +8,110 @@
 
 #include <stddef.h>
 #include "a4def.h"
+#include "pool.h"
 
 /*
-   a Node_T is an object that contains a path payload and references to
-   the node's parent (if it exists) and children (if they exist).
+   a Node_T is an object that contains a name payload (the last
+   component of its path) and references to the node's parent (if it
+   exists) and children (if they exist). The full path is not stored:
+   it is rebuilt from the names of the node and its ancestors.
+   A node, its name and its array of children are allocated from the
+   Pool_T of the tree the node belongs to, which is passed to every
+   function that allocates or frees.
+   The functions that only read a node may run in one thread while
+   another thread links or unlinks children, provided that memory the
+   writer retires to the pool is reclaimed only after the readers are
+   done with it. Writers must be serialized.
 */
 typedef struct node* Node_T;
 
 
 /*
-   Given a parent node and a directory string dir, returns a new
+   Given a parent node and a directory name dir of length characters,
+   which need not be '\0'-terminated, returns a new
    Node_T or NULL if any allocation error occurs in creating
    the node or its fields.
-   The new structure is initialized to have its path as the parent's
-   path (if it exists) prefixed to the directory string parameter,
-   separated by a slash. It is also initialized with its parent link
+   The new structure is initialized to have a copy of dir as its name,
+   so that its path is the parent's path (if it exists) prefixed to
+   dir, separated by a slash. It is also initialized with its parent link
    as the parent parameter value, but the parent itself is not changed
    to link to the new node.  The children links are initialized but
-   do not point to any children.
+   do not point to any children. Allocates from pool.
 */
 
 
-Node_T Node_create(const char* dir, Node_T parent);
+Node_T Node_create(const char* dir, size_t length, Node_T parent,
+                   Pool_T pool);
 
 /*
-   Given a parent node and a file path dir, returns a new
+   Given a parent node and a file name dir of nameLength characters,
+   which need not be '\0'-terminated, returns a new
    Node_T or NULL if any allocation error occurs in creating
    the node or its fields.
-   The new structure is initialized to have its path as the parent's
-   path (if it exists) prefixed to the directory string parameter,
-   separated by a slash. It is also initialized with its parent link
+   The new structure is initialized to have a copy of dir as its name,
+   so that its path is the parent's path prefixed to dir, separated
+   by a slash. It is also initialized with its parent link
    as the parent parameter value, but the parent itself is not changed
    to link to the new node.  The file represented by Node_T has 
-   contents (contents) and length (length) */
+   contents (contents) and length (length). Allocates from pool. */
 
-Node_T Node_addFile(const char* dir, Node_T parent,
-                    void* contents, size_t length); 
+Node_T Node_addFile(const char* dir, size_t nameLength, Node_T parent,
+                    void* contents, size_t length, Pool_T pool); 
 
 
 /* Destroys the entire hierarchy of nodes rooted at n,
-  including n itself.
-  Returns the number of nodes destroyed.*/
-size_t Node_destroy(Node_T n);
+  including n itself, retiring their memory to pool for reuse
+  at the next Pool_reclaim. Does not recurse, so a hierarchy of any
+  depth can be destroyed. A node that a snapshot still holds is
+  kept for the snapshot, with one hold fewer.
+  Returns the number of nodes in the hierarchy.*/
+size_t Node_destroy(Node_T n, Pool_T pool);
+
+/* Drops one hold on n, as when a snapshot whose root it is goes
+  away, destroying n and the descendants that nothing else holds,
+  as Node_destroy does. Walks only the nodes it destroys. */
+void Node_release(Node_T n, Pool_T pool);
+
+/* Adds one hold on n, as when a snapshot takes n as its root. A
+  node with more than one hold is frozen: none of its fields or
+  children may change until the other holds are dropped. */
+void Node_share(Node_T n);
+
+/* Returns TRUE if n has more than one hold, and so is frozen. */
+boolean Node_isShared(Node_T n);
+
+/* Returns a copy of n, with its own name and children array but the
+  same children, parent and contents, or NULL if it cannot be
+  allocated from pool. The copy is not yet linked anywhere: either
+  Node_claimChildren and link it, or Node_discard it. */
+Node_T Node_copy(Node_T n, Pool_T pool);
+
+/* Frees copy, returned by Node_copy and never claimed or linked,
+  back to pool, without its children. */
+void Node_discard(Node_T copy, Pool_T pool);
+
+/* Puts new, a copy of old, in old's place among the children of
+  copy, returned by Node_copy and not yet linked, and makes copy the
+  parent of new. Cannot fail. */
+void Node_setChild(Node_T copy, Node_T old, Node_T new);
+
+/* Makes copy, returned by Node_copy, hold each of its children that
+  Node_setChild did not put there, and their parent in the live tree.
+  Readers climbing from those children may see either parent. */
+void Node_claimChildren(Node_T copy);
+
+/* Puts new, a copy of old that has no parent yet, in old's place
+  among parent's children, which must be in parent's hands alone, by
+  publishing a new children array, and drops parent's hold on old,
+  which something else must still hold. Readers see either old or
+  new. Returns SUCCESS, or MEMORY_ERROR if the array cannot be
+  allocated from pool, in which case nothing has changed. */
+int Node_replaceChild(Node_T parent, Node_T old, Node_T new,
+                      Pool_T pool);
 
 /* Changes the file contents of Node_T n by replacing it with newContents
-   and changing the file's length to newLength */ 
+   and changing the file's length to newLength, and the total bytes of
+   n's ancestors with it */ 
 
 void Node_changeFileContents(Node_T n,
                              void* newContents, size_t newLength);
@@ -66,9 +125,38 @@ void *Node_getFileContents(Node_T n);
 /* Returns a size_t of the length of the file stored in Node_T n */
 size_t Node_getFileLength(Node_T n);
 
+/* Stores in *files, *dirs and *bytes the number of files and of
+   directories in the hierarchy rooted at n, n included, and the total
+   length of their contents. Each total is up to date with the last
+   change made under n, except that one made while this reads may be
+   seen in some totals and not yet in others. */
+void Node_getTotals(Node_T n, size_t* files, size_t* dirs,
+                    size_t* bytes);
+
+/* Adds the totals of child, whose hierarchy must be complete, to
+   those of parent alone, for a parent built up with Node_appendChild,
+   which leaves parent's totals as they were. */
+void Node_addTotals(Node_T parent, Node_T child);
 
-/* Returns n's path.*/
-const char* Node_getPath(Node_T n);
+
+/* Returns n's name: the last component of its path. */
+const char* Node_getName(Node_T n);
+
+/* Returns the length of n's name. */
+size_t Node_getNameLength(Node_T n);
+
+/* Returns the length of n's full path, not counting the '\0'.
+   Walks up to the root, so takes time proportional to n's depth. */
+size_t Node_getPathLength(Node_T n);
+
+/* Writes n's full path into path, which must have room for
+   Node_getPathLength(n) + 1 characters, and returns path. */
+char* Node_getPath(Node_T n, char* path);
+
+/* Returns TRUE if n's full path is the first length characters of
+   path, and FALSE otherwise. Compares names from n up to the root, so
+   it never allocates memory. */
+boolean Node_hasPath(Node_T n, const char* path, size_t length);
 
 /* Returns the number of child directories n has. */
 size_t Node_getNumChildren(Node_T n);
@@ -79,6 +167,38 @@ size_t Node_getNumChildren(Node_T n);
 */
 Node_T Node_getChild(Node_T n, size_t childID);
 
+/*
+   Returns 1 if n has a child whose name is the first length
+   characters of name and whose status (TRUE for a file, FALSE for a
+   directory) is status, and 0 if it does not.
+   If n does have such a child, and childID is not NULL, store the
+   child's identifier in *childID. If n does not have such a child,
+   store the identifier that such a child would have in *childID.
+   Compares the key directly against the children, so it never
+   allocates memory.
+*/
+int Node_hasChild(Node_T n, const char* name, size_t length,
+                  boolean status, size_t* childID);
+
+/*
+   Returns the child node of n whose name is the first length
+   characters of name, whether that child is a file or a directory,
+   or NULL if n is a file or has no such child. Binary searches n's
+   sorted children, so name need not be NUL-terminated after length.
+*/
+Node_T Node_findChild(Node_T n, const char* name, size_t length);
+
+/*
+   Returns the first child of n that comes after the child whose name
+   is the first length characters of name, and which is a file if
+   status is TRUE and a directory otherwise, whether or not n has that
+   child, or NULL if n has no child after it. Searches one published
+   children array, so a concurrent change cannot make it skip a child
+   that was there all along.
+*/
+Node_T Node_getChildAfter(Node_T n, const char* name, size_t length,
+                          boolean status);
+
 /*
    Returns the parent node of n, if it exists, otherwise returns NULL
 */
@@ -87,34 +207,68 @@ Node_T Node_getParent(Node_T n);
 /*
   Makes child a child of parent, if possible, and returns SUCCESS.
   This is not possible in the following cases:
-  * child's path is not parent's path + / + directory,
+  * parent is a file, or child's name is empty or contains a slash,
     in which case returns PARENT_CHILD_ERROR
-    * parent already has a child with child's path,
+    * parent already has a child with child's name,
     in which case returns ALREADY_IN_TREE
     * parent is unable to allocate memory to store new child link,
     in which case returns MEMORY_ERROR
+  The array of parent's children grows from pool. On success, adds
+  child's totals to those of parent and each of its ancestors.
+*/
+int Node_linkChild(Node_T parent, Node_T child, Pool_T pool);
+
+/*
+  Makes child the last child of parent, without searching parent's
+  children or checking child's name: child must sort after all of
+  them, files before directories and then by name. Only for a parent
+  that no reader can reach yet, since its children array may be
+  reallocated in place. Does not change parent's totals: see
+  Node_addTotals. Returns SUCCESS, or MEMORY_ERROR if the array
+  cannot grow from pool.
 */
-int Node_linkChild(Node_T parent, Node_T child);
+int Node_appendChild(Node_T parent, Node_T child, Pool_T pool);
 
 /*
-  Unlinks node parent from its child node child. child is unchanged.
+  Unlinks node parent from its child node child, taking child's
+  totals away from parent and its ancestors. child is unchanged.
   Returns PARENT_CHILD_ERROR if child is not a child of parent,
-  and SUCCESS otherwise.
+  MEMORY_ERROR if the new array of parent's children cannot be
+  allocated from pool, and SUCCESS otherwise.
+*/
+int Node_unlinkChild(Node_T parent, Node_T child, Pool_T pool);
+
+/*
+  Moves n, with all of its descendants, to be a child of newParent
+  named by the first length characters of name, in time independent
+  of the number of n's descendants. newParent must be a directory
+  that is neither n nor below it, with no child of that name, and may
+  be n's parent; it is NULL only to rename n when n is a root, which
+  the caller must first hide from readers. n is hidden from readers
+  between leaving its parent's children and joining newParent's, and
+  its name changes only after (*pfQuiesce)(), unless pfQuiesce is
+  NULL, has waited for every reader that may still see it.
+  The totals of n's hierarchy move from its old ancestors to its new.
+  Returns SUCCESS, or MEMORY_ERROR if the new name or children arrays
+  cannot be allocated from pool, in which case nothing has changed.
 */
-int Node_unlinkChild(Node_T parent, Node_T child);
+int Node_move(Node_T n, Node_T newParent, const char* name,
+              size_t length, void (*pfQuiesce)(void), Pool_T pool);
 
 /*
-  Creates a new node such that the new node's path is dir appended to
-  n's path, separated by a slash, and that the new node has no
+  Creates a new node such that the new node's name is dir, so its
+  path is dir appended to n's path, separated by a slash, and that
+  the new node has no
   children of its own. The new node's parent is n, and the new node is
   added as a child of n.
   (Reiterating for clarity: unlike with Node_create, parent *is*
   changed so that the link is bidirectional.)
   Returns SUCCESS upon completion, or:
   MEMORY_ERROR if the new node cannot be created,
-  ALREADY_IN_TREE if parent already has a child with that path
+  ALREADY_IN_TREE if parent already has a child with that name
+  Allocates from pool.
 */
-int Node_addChild(Node_T parent, const char* dir);
+int Node_addChild(Node_T parent, const char* dir, Pool_T pool);
 
 /*
   Returns a string representation for n, 
@@ -124,4 +278,13 @@ int Node_addChild(Node_T parent, const char* dir);
 */
 char* Node_toString(Node_T n);
 
+#ifdef FT_STATS
+/*
+  Returns the number of times a directory's children array has been
+  grown, by Node_linkChild or Node_appendChild, in any tree, since
+  the process started. Only in a build with FT_STATS, for FT_getStats.
+*/
+size_t Node_getGrowCount(void);
+#endif
+
 #endif
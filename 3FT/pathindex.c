@@ -0,0 +1,310 @@
+/*--------------------------------------------------------------------*/
+/* pathindex.c                                                        */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#include "pathindex.h"
+#include <assert.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The table starts with MIN_CAPACITY slots, a power of two, and is
+   rebuilt twice as big as its live entries need whenever the live and
+   removed entries together would fill more than three quarters of
+   it. */
+
+enum { MIN_CAPACITY = 16 };
+
+/* The 64-bit FNV-1a offset basis and prime. */
+
+#define FNV_OFFSET 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
+
+/*--------------------------------------------------------------------*/
+
+/* An entry holds a node and the hash of its path. A slot whose node
+   is NULL has never been used since the table was built or cleared;
+   a slot whose node is TOMBSTONE held a node that was removed, and
+   does not end a probe. */
+
+struct Entry
+{
+   unsigned long ulHash;
+   Node_T oNode;
+};
+
+static char cTombstone;
+#define TOMBSTONE ((Node_T)(void*)&cTombstone)
+
+/* A table is its mask, one less than its capacity, followed by its
+   entries. */
+
+struct Table
+{
+   size_t uMask;
+   struct Entry asEntries[];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A PathIndex consists of the table readers probe, the number of live
+   and of removed entries in it, and the pool its memory comes from. */
+
+struct PathIndex
+{
+   struct Table *psTable;
+   size_t uCount;
+   size_t uTombstones;
+   Pool_T oPool;
+};
+
+/*--------------------------------------------------------------------*/
+
+unsigned long PathIndex_hashStart(void)
+{
+   return FNV_OFFSET;
+}
+
+/*--------------------------------------------------------------------*/
+
+unsigned long PathIndex_hashAppend(unsigned long ulHash,
+                                   const char *pcChars, size_t uLength)
+{
+   size_t u;
+
+   assert(pcChars != NULL || uLength == 0);
+
+   for (u = 0; u < uLength; u++)
+   {
+      ulHash ^= (unsigned char)pcChars[u];
+      ulHash *= FNV_PRIME;
+   }
+   return ulHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the size of the block holding a table of uCapacity slots. */
+
+static size_t PathIndex_tableSize(size_t uCapacity)
+{
+   return sizeof(struct Table) + uCapacity * sizeof(struct Entry);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new table of uCapacity slots, a power of two, all unused,
+   allocated from oPool, or NULL if insufficient memory is
+   available. */
+
+static struct Table *PathIndex_newTable(Pool_T oPool, size_t uCapacity)
+{
+   struct Table *psTable;
+
+   assert(oPool != NULL);
+
+   psTable = (struct Table*)Pool_alloc(oPool,
+                                       PathIndex_tableSize(uCapacity));
+   if (psTable == NULL)
+      return NULL;
+   psTable->uMask = uCapacity - 1;
+   memset(psTable->asEntries, 0, uCapacity * sizeof(struct Entry));
+   return psTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+PathIndex_T PathIndex_new(Pool_T oPool)
+{
+   PathIndex_T oPathIndex;
+
+   assert(oPool != NULL);
+
+   oPathIndex = (PathIndex_T)Pool_alloc(oPool, sizeof(struct PathIndex));
+   if (oPathIndex == NULL)
+      return NULL;
+   oPathIndex->psTable = PathIndex_newTable(oPool, MIN_CAPACITY);
+   if (oPathIndex->psTable == NULL)
+   {
+      Pool_release(oPool, oPathIndex, sizeof(struct PathIndex));
+      return NULL;
+   }
+   oPathIndex->uCount = 0;
+   oPathIndex->uTombstones = 0;
+   oPathIndex->oPool = oPool;
+   return oPathIndex;
+}
+
+/*--------------------------------------------------------------------*/
+
+void PathIndex_retire(PathIndex_T oPathIndex)
+{
+   assert(oPathIndex != NULL);
+
+   Pool_retire(oPathIndex->oPool, oPathIndex->psTable,
+               PathIndex_tableSize(oPathIndex->psTable->uMask + 1));
+   Pool_retire(oPathIndex->oPool, oPathIndex, sizeof(struct PathIndex));
+}
+
+/*--------------------------------------------------------------------*/
+
+Node_T PathIndex_find(PathIndex_T oPathIndex, const char *pcPath,
+                      size_t uLength)
+{
+   struct Table *psTable;
+   unsigned long ulHash;
+   size_t uSlot;
+   Node_T oNode;
+
+   assert(oPathIndex != NULL);
+   assert(pcPath != NULL);
+
+   ulHash = PathIndex_hashAppend(FNV_OFFSET, pcPath, uLength);
+   psTable = __atomic_load_n(&oPathIndex->psTable, __ATOMIC_ACQUIRE);
+   for (uSlot = ulHash & psTable->uMask; ;
+        uSlot = (uSlot + 1) & psTable->uMask)
+   {
+      oNode = __atomic_load_n(&psTable->asEntries[uSlot].oNode,
+                              __ATOMIC_ACQUIRE);
+      if (oNode == NULL)
+         return NULL;
+      if (oNode != TOMBSTONE &&
+          __atomic_load_n(&psTable->asEntries[uSlot].ulHash,
+                          __ATOMIC_RELAXED) == ulHash &&
+          Node_hasPath(oNode, pcPath, uLength))
+         return oNode;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store oNode, whose path has hash ulHash, in the first unused or
+   removed slot of its probe sequence in psTable, publishing the node
+   after its hash. Return TRUE if the slot held a removed entry. */
+
+static boolean PathIndex_place(struct Table *psTable,
+                               unsigned long ulHash, Node_T oNode)
+{
+   size_t uSlot;
+   Node_T oOld;
+
+   assert(psTable != NULL);
+
+   for (uSlot = ulHash & psTable->uMask; ;
+        uSlot = (uSlot + 1) & psTable->uMask)
+   {
+      oOld = psTable->asEntries[uSlot].oNode;
+      if (oOld == NULL || oOld == TOMBSTONE)
+         break;
+   }
+   __atomic_store_n(&psTable->asEntries[uSlot].ulHash, ulHash,
+                    __ATOMIC_RELAXED);
+   __atomic_store_n(&psTable->asEntries[uSlot].oNode, oNode,
+                    __ATOMIC_RELEASE);
+   return (boolean)(oOld == TOMBSTONE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Replace oPathIndex's table by one with room for at least uCount
+   entries, holding only the live entries. Return SUCCESS, or
+   MEMORY_ERROR if insufficient memory is available. */
+
+static int PathIndex_rebuild(PathIndex_T oPathIndex, size_t uCount)
+{
+   struct Table *psOld;
+   struct Table *psNew;
+   size_t uCapacity;
+   size_t u;
+   Node_T oNode;
+
+   assert(oPathIndex != NULL);
+
+   uCapacity = MIN_CAPACITY;
+   while (uCapacity < 2 * uCount)
+      uCapacity *= 2;
+   psNew = PathIndex_newTable(oPathIndex->oPool, uCapacity);
+   if (psNew == NULL)
+      return MEMORY_ERROR;
+
+   psOld = oPathIndex->psTable;
+   for (u = 0; u <= psOld->uMask; u++)
+   {
+      oNode = psOld->asEntries[u].oNode;
+      if (oNode != NULL && oNode != TOMBSTONE)
+         (void)PathIndex_place(psNew, psOld->asEntries[u].ulHash, oNode);
+   }
+   __atomic_store_n(&oPathIndex->psTable, psNew, __ATOMIC_RELEASE);
+   Pool_retire(oPathIndex->oPool, psOld,
+               PathIndex_tableSize(psOld->uMask + 1));
+   oPathIndex->uTombstones = 0;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+int PathIndex_insert(PathIndex_T oPathIndex, unsigned long ulHash,
+                     Node_T oNode)
+{
+   size_t uUsed;
+
+   assert(oPathIndex != NULL);
+   assert(oNode != NULL);
+
+   uUsed = oPathIndex->uCount + oPathIndex->uTombstones + 1;
+   if (4 * uUsed > 3 * (oPathIndex->psTable->uMask + 1))
+      if (PathIndex_rebuild(oPathIndex, oPathIndex->uCount + 1)
+          != SUCCESS)
+         return MEMORY_ERROR;
+
+   if (PathIndex_place(oPathIndex->psTable, ulHash, oNode))
+      oPathIndex->uTombstones--;
+   oPathIndex->uCount++;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+void PathIndex_remove(PathIndex_T oPathIndex, unsigned long ulHash,
+                      Node_T oNode)
+{
+   struct Table *psTable;
+   size_t uSlot;
+   Node_T oOld;
+
+   assert(oPathIndex != NULL);
+   assert(oNode != NULL);
+
+   psTable = oPathIndex->psTable;
+   for (uSlot = ulHash & psTable->uMask; ;
+        uSlot = (uSlot + 1) & psTable->uMask)
+   {
+      oOld = psTable->asEntries[uSlot].oNode;
+      if (oOld == NULL)
+         return;
+      if (oOld == oNode)
+         break;
+   }
+   __atomic_store_n(&psTable->asEntries[uSlot].oNode, TOMBSTONE,
+                    __ATOMIC_RELEASE);
+   oPathIndex->uCount--;
+   oPathIndex->uTombstones++;
+}
+
+/*--------------------------------------------------------------------*/
+
+void PathIndex_clear(PathIndex_T oPathIndex)
+{
+   struct Table *psTable;
+   size_t u;
+
+   assert(oPathIndex != NULL);
+
+   psTable = oPathIndex->psTable;
+   for (u = 0; u <= psTable->uMask; u++)
+      __atomic_store_n(&psTable->asEntries[u].oNode, NULL,
+                       __ATOMIC_RELEASE);
+   oPathIndex->uCount = 0;
+   oPathIndex->uTombstones = 0;
+}
@@ -0,0 +1,80 @@
+/*--------------------------------------------------------------------*/
+/* pathindex.h                                                        */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#ifndef PATHINDEX_INCLUDED
+#define PATHINDEX_INCLUDED
+
+#include <stddef.h>
+#include "node.h"
+#include "pool.h"
+
+/* A PathIndex_T object maps the full path of each node of a tree to
+   the node, by open addressing on a hash of the path. The paths
+   themselves are not stored: a candidate node is confirmed by
+   comparing the path against its names. Its memory comes from the
+   tree's pool. Lookups may run while one writer changes the index;
+   replaced tables are retired to the pool, like children arrays. */
+
+typedef struct PathIndex *PathIndex_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash of the empty path. */
+
+unsigned long PathIndex_hashStart(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash of the path whose hash is ulHash followed by the
+   uLength characters at pcChars. */
+
+unsigned long PathIndex_hashAppend(unsigned long ulHash,
+                                   const char *pcChars, size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty PathIndex_T object allocated from oPool, or NULL
+   if insufficient memory is available. */
+
+PathIndex_T PathIndex_new(Pool_T oPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Retire oPathIndex and its table to the pool it was allocated from. */
+
+void PathIndex_retire(PathIndex_T oPathIndex);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the node whose full path is the first uLength characters of
+   pcPath, or NULL if oPathIndex has no such node. */
+
+Node_T PathIndex_find(PathIndex_T oPathIndex, const char *pcPath,
+                      size_t uLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Add oNode, whose full path has hash ulHash, to oPathIndex. Return
+   SUCCESS, or MEMORY_ERROR if the table cannot grow, in which case
+   oPathIndex is unchanged. */
+
+int PathIndex_insert(PathIndex_T oPathIndex, unsigned long ulHash,
+                     Node_T oNode);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove oNode, whose full path has hash ulHash, from oPathIndex, if
+   it is there. */
+
+void PathIndex_remove(PathIndex_T oPathIndex, unsigned long ulHash,
+                      Node_T oNode);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove every node from oPathIndex. */
+
+void PathIndex_clear(PathIndex_T oPathIndex);
+
+#endif
@@ -0,0 +1,356 @@
+/*--------------------------------------------------------------------*/
+/* pool.c                                                             */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#include "pool.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+/* Block sizes are rounded up to a multiple of GRAIN bytes, which
+   keeps every block aligned for pointers and sizes. Blocks of up to
+   MAX_SMALL bytes are carved out of slabs of SLAB_SIZE bytes and kept
+   on one free list per size class; bigger blocks are allocated one at
+   a time. */
+
+enum { GRAIN = 8, MAX_SMALL = 1024, SLAB_SIZE = 64 * 1024,
+       NUM_CLASSES = MAX_SMALL / GRAIN };
+
+/*--------------------------------------------------------------------*/
+
+/* A slab is a header followed by the blocks carved out of it. */
+
+struct Slab
+{
+   /* The slab allocated before this one. */
+   struct Slab *psNext;
+};
+
+/* A large block is a header followed by the block itself. The
+   headers of the blocks in use form a doubly-linked list, so that a
+   large block can be released on its own. Released large blocks are
+   kept on a list of their own, for reuse by requests of the same
+   size. */
+
+struct Large
+{
+   /* The neighbours of this block in its list. */
+   struct Large *psPrev;
+   struct Large *psNext;
+
+   /* The size of the block, not counting the header. */
+   size_t uSize;
+};
+
+/* Retired blocks are recorded in batches, each a small block of its
+   own holding up to RETIRED_PER_BATCH blocks and their sizes. */
+
+enum { RETIRED_PER_BATCH = 31 };
+
+struct Retired
+{
+   /* The batch filled before this one. */
+   struct Retired *psNext;
+
+   /* The number of blocks recorded in this batch. */
+   size_t uCount;
+
+   /* The blocks and their sizes. */
+   void *apvBlocks[RETIRED_PER_BATCH];
+   size_t auSizes[RETIRED_PER_BATCH];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A Pool consists of its slabs, the unused end of the newest slab,
+   the free lists, the large blocks, and the retired blocks. */
+
+struct Pool
+{
+   /* The slabs, newest first. */
+   struct Slab *psSlabs;
+
+   /* The part of the newest slab that has not been carved yet. */
+   char *pcNext;
+   char *pcEnd;
+
+   /* For each size class, a list of released blocks, each of which
+      holds the address of the next. */
+   void *apvFree[NUM_CLASSES];
+
+   /* The large blocks in use, and those released, newest first. */
+   struct Large *psLarge;
+   struct Large *psLargeFree;
+
+   /* The batches of retired blocks, newest first. */
+   struct Retired *psRetired;
+
+   /* The number of slabs and of large blocks. */
+   size_t uSlabCount;
+   size_t uLargeCount;
+
+   /* The number of retired blocks. */
+   size_t uRetiredCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the size class of a block of uSize bytes, which must be at
+   most MAX_SMALL. */
+
+static size_t Pool_class(size_t uSize)
+{
+   assert(uSize <= MAX_SMALL);
+
+   if (uSize == 0)
+      uSize = 1;
+   return (uSize - 1) / GRAIN;
+}
+
+/*--------------------------------------------------------------------*/
+
+Pool_T Pool_new(void)
+{
+   Pool_T oPool;
+
+   oPool = (struct Pool*)calloc(1, sizeof(struct Pool));
+   return oPool;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Pool_free(Pool_T oPool)
+{
+   struct Slab *psSlab;
+   struct Large *psLarge;
+
+   assert(oPool != NULL);
+
+   while (oPool->psSlabs != NULL)
+   {
+      psSlab = oPool->psSlabs;
+      oPool->psSlabs = psSlab->psNext;
+      free(psSlab);
+   }
+   while (oPool->psLarge != NULL)
+   {
+      psLarge = oPool->psLarge;
+      oPool->psLarge = psLarge->psNext;
+      free(psLarge);
+   }
+   while (oPool->psLargeFree != NULL)
+   {
+      psLarge = oPool->psLargeFree;
+      oPool->psLargeFree = psLarge->psNext;
+      free(psLarge);
+   }
+   free(oPool);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a large block of uSize bytes from oPool, reusing a released
+   block of the same size if there is one, or NULL if insufficient
+   memory is available. */
+
+static void *Pool_allocLarge(Pool_T oPool, size_t uSize)
+{
+   struct Large *psLarge;
+   struct Large **ppsLink;
+
+   assert(oPool != NULL);
+
+   for (ppsLink = &oPool->psLargeFree; *ppsLink != NULL;
+        ppsLink = &(*ppsLink)->psNext)
+      if ((*ppsLink)->uSize == uSize)
+         break;
+   if (*ppsLink != NULL)
+   {
+      psLarge = *ppsLink;
+      *ppsLink = psLarge->psNext;
+   }
+   else
+   {
+      psLarge = (struct Large*)malloc(sizeof(struct Large) + uSize);
+      if (psLarge == NULL)
+         return NULL;
+      psLarge->uSize = uSize;
+      oPool->uLargeCount++;
+   }
+
+   psLarge->psPrev = NULL;
+   psLarge->psNext = oPool->psLarge;
+   if (oPool->psLarge != NULL)
+      oPool->psLarge->psPrev = psLarge;
+   oPool->psLarge = psLarge;
+   return psLarge + 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Pool_alloc(Pool_T oPool, size_t uSize)
+{
+   size_t uClass;
+   size_t uRounded;
+   struct Slab *psSlab;
+   void *pvBlock;
+
+   assert(oPool != NULL);
+
+   if (uSize > MAX_SMALL)
+      return Pool_allocLarge(oPool, uSize);
+
+   /* Reuse a released block of the same class if there is one. */
+   uClass = Pool_class(uSize);
+   pvBlock = oPool->apvFree[uClass];
+   if (pvBlock != NULL)
+   {
+      oPool->apvFree[uClass] = *(void**)pvBlock;
+      return pvBlock;
+   }
+
+   /* Otherwise carve a new block, starting a new slab if needed. */
+   uRounded = (uClass + 1) * GRAIN;
+   if ((size_t)(oPool->pcEnd - oPool->pcNext) < uRounded)
+   {
+      psSlab = (struct Slab*)malloc(SLAB_SIZE);
+      if (psSlab == NULL)
+         return NULL;
+      psSlab->psNext = oPool->psSlabs;
+      oPool->psSlabs = psSlab;
+      oPool->uSlabCount++;
+      oPool->pcNext = (char*)psSlab +
+         ((sizeof(struct Slab) + GRAIN - 1) / GRAIN) * GRAIN;
+      oPool->pcEnd = (char*)psSlab + SLAB_SIZE;
+   }
+   pvBlock = oPool->pcNext;
+   oPool->pcNext += uRounded;
+   return pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Pool_release(Pool_T oPool, void *pvBlock, size_t uSize)
+{
+   struct Large *psLarge;
+   size_t uClass;
+
+   assert(oPool != NULL);
+
+   if (pvBlock == NULL)
+      return;
+
+   if (uSize > MAX_SMALL)
+   {
+      psLarge = (struct Large*)pvBlock - 1;
+      if (psLarge->psPrev != NULL)
+         psLarge->psPrev->psNext = psLarge->psNext;
+      else
+         oPool->psLarge = psLarge->psNext;
+      if (psLarge->psNext != NULL)
+         psLarge->psNext->psPrev = psLarge->psPrev;
+      psLarge->psNext = oPool->psLargeFree;
+      oPool->psLargeFree = psLarge;
+      return;
+   }
+
+   uClass = Pool_class(uSize);
+   *(void**)pvBlock = oPool->apvFree[uClass];
+   oPool->apvFree[uClass] = pvBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Pool_retire(Pool_T oPool, void *pvBlock, size_t uSize)
+{
+   struct Retired *psBatch;
+
+   assert(oPool != NULL);
+
+   if (pvBlock == NULL)
+      return;
+
+   psBatch = oPool->psRetired;
+   if (psBatch == NULL || psBatch->uCount == RETIRED_PER_BATCH)
+   {
+      psBatch = (struct Retired*)Pool_alloc(oPool, sizeof(struct Retired));
+      if (psBatch == NULL)
+         return;
+      psBatch->psNext = oPool->psRetired;
+      psBatch->uCount = 0;
+      oPool->psRetired = psBatch;
+   }
+   psBatch->apvBlocks[psBatch->uCount] = pvBlock;
+   psBatch->auSizes[psBatch->uCount] = uSize;
+   psBatch->uCount++;
+   oPool->uRetiredCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+void Pool_reclaim(Pool_T oPool)
+{
+   struct Retired *psBatch;
+   size_t u;
+
+   assert(oPool != NULL);
+
+   while (oPool->psRetired != NULL)
+   {
+      psBatch = oPool->psRetired;
+      oPool->psRetired = psBatch->psNext;
+      for (u = 0; u < psBatch->uCount; u++)
+         Pool_release(oPool, psBatch->apvBlocks[u], psBatch->auSizes[u]);
+      Pool_release(oPool, psBatch, sizeof(struct Retired));
+   }
+   oPool->uRetiredCount = 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Pool_getRetiredCount(Pool_T oPool)
+{
+   assert(oPool != NULL);
+
+   return oPool->uRetiredCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *Pool_realloc(Pool_T oPool, void *pvBlock,
+                   size_t uOldSize, size_t uNewSize)
+{
+   void *pvNewBlock;
+
+   assert(oPool != NULL);
+   assert(pvBlock != NULL || uOldSize == 0);
+
+   /* A block already big enough for its class stays where it is. */
+   if (pvBlock != NULL && uOldSize <= MAX_SMALL &&
+       uNewSize <= MAX_SMALL &&
+       Pool_class(uOldSize) == Pool_class(uNewSize))
+      return pvBlock;
+
+   pvNewBlock = Pool_alloc(oPool, uNewSize);
+   if (pvNewBlock == NULL)
+      return NULL;
+   if (pvBlock != NULL)
+   {
+      memcpy(pvNewBlock, pvBlock,
+             uOldSize < uNewSize ? uOldSize : uNewSize);
+      Pool_release(oPool, pvBlock, uOldSize);
+   }
+   return pvNewBlock;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t Pool_getSlabCount(Pool_T oPool)
+{
+   assert(oPool != NULL);
+
+   return oPool->uSlabCount + oPool->uLargeCount;
+}
@@ -0,0 +1,86 @@
+/*--------------------------------------------------------------------*/
+/* pool.h                                                             */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#ifndef POOL_INCLUDED
+#define POOL_INCLUDED
+
+#include <stddef.h>
+
+/* A Pool_T object is a slab allocator for the blocks of one tree.
+   Blocks are carved out of large slabs, released blocks are kept on
+   per-size free lists for reuse, and freeing the pool releases every
+   block at once, in time proportional to the number of slabs. */
+
+typedef struct Pool *Pool_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Return a new, empty Pool_T object, or NULL if insufficient memory
+   is available. */
+
+Pool_T Pool_new(void);
+
+/*--------------------------------------------------------------------*/
+
+/* Free oPool and every block allocated from it. */
+
+void Pool_free(Pool_T oPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a block of at least uSize bytes from oPool, aligned for any
+   object, or NULL if insufficient memory is available. */
+
+void *Pool_alloc(Pool_T oPool, size_t uSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Return pvBlock, which was allocated from oPool with size uSize, to
+   oPool for reuse. pvBlock may be NULL. */
+
+void Pool_release(Pool_T oPool, void *pvBlock, size_t uSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Hand pvBlock, which was allocated from oPool with size uSize, to
+   oPool for reuse at the next call of Pool_reclaim, rather than at
+   once, so that readers who may still hold it can finish first.
+   pvBlock may be NULL. If the record of the block cannot be
+   allocated, the block is reused only when oPool is freed. */
+
+void Pool_retire(Pool_T oPool, void *pvBlock, size_t uSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Release every block retired in oPool since the last call, which the
+   caller must know no reader still holds. */
+
+void Pool_reclaim(Pool_T oPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of blocks retired in oPool and not yet reclaimed. */
+
+size_t Pool_getRetiredCount(Pool_T oPool);
+
+/*--------------------------------------------------------------------*/
+
+/* Return a block of at least uNewSize bytes from oPool holding the
+   first uOldSize bytes (or uNewSize, if smaller) of pvBlock, which was
+   allocated from oPool with size uOldSize and is released, or NULL if
+   insufficient memory is available, in which case pvBlock is left
+   unchanged. pvBlock may be NULL if uOldSize is 0. */
+
+void *Pool_realloc(Pool_T oPool, void *pvBlock,
+                   size_t uOldSize, size_t uNewSize);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of slabs, including blocks too big for a slab,
+   that oPool currently holds. */
+
+size_t Pool_getSlabCount(Pool_T oPool);
+
+#endif
@@ -0,0 +1,321 @@
+/*--------------------------------------------------------------------*/
+/* trace.c                                                            */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#include "trace.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------*/
+
+/* The first bytes of every trace. */
+
+#define TRACE_MAGIC "FTTRACE1"
+
+/* A record is the operation and a byte of flags, then the result,
+   the gap and the duration as variable-length integers, then, if it
+   has a path, the path's length and the path without its '\0', then
+   the length. A variable-length integer holds seven bits in each
+   byte, lowest first, with the high bit set on all but the last. */
+
+enum { FLAG_PATH = 1, FLAG_CONTENTS = 2, FLAG_IS_FILE = 4,
+       FLAG_ALL = 7 };
+
+/* The most bytes a variable-length integer of an unsigned long can
+   take. */
+
+enum { MAX_VARINT = (sizeof(unsigned long) * 8 + 6) / 7 };
+
+/* The buffer for paths read back starts with MIN_PATH bytes, and
+   doubles as needed. */
+
+enum { MIN_PATH = 256 };
+
+/* The names of the operations, in the order of enum TraceOp. */
+
+static const char *const apcNames[TRACE_OPS] =
+{
+   "init", "destroy", "insertDir", "containsDir", "rmDir",
+   "insertFile", "containsFile", "rmFile", "getFileContents",
+   "replaceFileContents", "stat", "toString"
+};
+
+/*--------------------------------------------------------------------*/
+
+/* A Trace consists of its open file, whether it is being written,
+   the buffer for the path of the last record read and its size, and
+   the status of the first write that failed. */
+
+struct Trace
+{
+   FILE *psFile;
+   boolean bWriting;
+   char *pcPath;
+   size_t uPathSize;
+   int iStatus;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Write ul to psFile as a variable-length integer. Return TRUE if it
+   was written, and FALSE otherwise. */
+
+static boolean Trace_putNumber(FILE *psFile, unsigned long ul)
+{
+   for (; ul >= 0x80; ul >>= 7)
+      if (putc((int)(ul & 0x7f) | 0x80, psFile) == EOF)
+         return FALSE;
+   return putc((int)ul, psFile) != EOF;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Read a variable-length integer from psFile into *pul. Return TRUE
+   if one was read, and FALSE if the file ends first or the integer
+   does not fit. */
+
+static boolean Trace_getNumber(FILE *psFile, unsigned long *pul)
+{
+   unsigned long ul = 0;
+   int iByte;
+   size_t u;
+
+   for (u = 0; u < MAX_VARINT; u++)
+   {
+      iByte = getc(psFile);
+      if (iByte == EOF)
+         return FALSE;
+      ul |= (unsigned long)(iByte & 0x7f) << (7 * u);
+      if ((iByte & 0x80) == 0)
+      {
+         *pul = ul;
+         return TRUE;
+      }
+   }
+   return FALSE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Open the file named pcPath in mode pcMode and return a new Trace
+   for it, or NULL, storing the status in *piResult. */
+
+static Trace_T Trace_new(const char *pcPath, const char *pcMode,
+                         int *piResult)
+{
+   Trace_T oTrace;
+
+   oTrace = (Trace_T)malloc(sizeof(struct Trace));
+   if (oTrace == NULL)
+   {
+      *piResult = MEMORY_ERROR;
+      return NULL;
+   }
+   oTrace->psFile = fopen(pcPath, pcMode);
+   if (oTrace->psFile == NULL)
+   {
+      free(oTrace);
+      *piResult = IO_ERROR;
+      return NULL;
+   }
+   oTrace->bWriting = (boolean)(pcMode[0] == 'w');
+   oTrace->pcPath = NULL;
+   oTrace->uPathSize = 0;
+   oTrace->iStatus = SUCCESS;
+   *piResult = SUCCESS;
+   return oTrace;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *Trace_getName(enum TraceOp eOp)
+{
+   assert((int)eOp >= 0 && eOp < TRACE_OPS);
+
+   return apcNames[eOp];
+}
+
+/*--------------------------------------------------------------------*/
+
+int Trace_create(const char *pcPath, Trace_T *poTrace)
+{
+   Trace_T oTrace;
+   int iResult;
+
+   assert(pcPath != NULL);
+   assert(poTrace != NULL);
+
+   oTrace = Trace_new(pcPath, "wb", &iResult);
+   if (oTrace == NULL)
+      return iResult;
+   if (fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), oTrace->psFile)
+       != strlen(TRACE_MAGIC))
+   {
+      (void)fclose(oTrace->psFile);
+      free(oTrace);
+      return IO_ERROR;
+   }
+   *poTrace = oTrace;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Trace_open(const char *pcPath, Trace_T *poTrace)
+{
+   Trace_T oTrace;
+   char acMagic[sizeof(TRACE_MAGIC) - 1];
+   int iResult;
+
+   assert(pcPath != NULL);
+   assert(poTrace != NULL);
+
+   oTrace = Trace_new(pcPath, "rb", &iResult);
+   if (oTrace == NULL)
+      return iResult;
+   if (fread(acMagic, 1, sizeof(acMagic), oTrace->psFile)
+          != sizeof(acMagic) ||
+       memcmp(acMagic, TRACE_MAGIC, sizeof(acMagic)) != 0)
+   {
+      (void)fclose(oTrace->psFile);
+      free(oTrace);
+      return IO_ERROR;
+   }
+   *poTrace = oTrace;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Trace_append(Trace_T oTrace, const struct TraceRecord *psRecord)
+{
+   FILE *psFile;
+   size_t uPathLength = 0;
+   int iFlags = 0;
+
+   assert(oTrace != NULL);
+   assert(oTrace->bWriting);
+   assert(psRecord != NULL);
+   assert(psRecord->iResult >= 0);
+
+   if (oTrace->iStatus != SUCCESS)
+      return oTrace->iStatus;
+
+   psFile = oTrace->psFile;
+   if (psRecord->pcPath != NULL)
+   {
+      iFlags |= FLAG_PATH;
+      uPathLength = strlen(psRecord->pcPath);
+   }
+   if (psRecord->bHasContents)
+      iFlags |= FLAG_CONTENTS;
+   if (psRecord->bIsFile)
+      iFlags |= FLAG_IS_FILE;
+
+   if (putc((int)psRecord->eOp, psFile) == EOF ||
+       putc(iFlags, psFile) == EOF ||
+       !Trace_putNumber(psFile, (unsigned long)psRecord->iResult) ||
+       !Trace_putNumber(psFile, psRecord->ulGap) ||
+       !Trace_putNumber(psFile, psRecord->ulDuration) ||
+       (psRecord->pcPath != NULL &&
+        (!Trace_putNumber(psFile, (unsigned long)uPathLength) ||
+         fwrite(psRecord->pcPath, 1, uPathLength, psFile)
+            != uPathLength)) ||
+       !Trace_putNumber(psFile, (unsigned long)psRecord->uLength))
+      oTrace->iStatus = IO_ERROR;
+   return oTrace->iStatus;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Trace_next(Trace_T oTrace, struct TraceRecord *psRecord)
+{
+   FILE *psFile;
+   unsigned long ulResult;
+   unsigned long ulPathLength;
+   unsigned long ulLength;
+   size_t uNewSize;
+   char *pcNew;
+   int iOp;
+   int iFlags;
+
+   assert(oTrace != NULL);
+   assert(!oTrace->bWriting);
+   assert(psRecord != NULL);
+
+   psFile = oTrace->psFile;
+   iOp = getc(psFile);
+   if (iOp == EOF)
+      return ferror(psFile) ? IO_ERROR : NO_SUCH_PATH;
+   iFlags = getc(psFile);
+   if (iOp >= TRACE_OPS || iFlags == EOF || (iFlags & ~FLAG_ALL) != 0 ||
+       !Trace_getNumber(psFile, &ulResult) || ulResult > 0xffff ||
+       !Trace_getNumber(psFile, &psRecord->ulGap) ||
+       !Trace_getNumber(psFile, &psRecord->ulDuration))
+      return IO_ERROR;
+
+   psRecord->pcPath = NULL;
+   if (iFlags & FLAG_PATH)
+   {
+      if (!Trace_getNumber(psFile, &ulPathLength))
+         return IO_ERROR;
+      if (ulPathLength >= oTrace->uPathSize)
+      {
+         uNewSize = oTrace->uPathSize == 0 ? MIN_PATH
+                                           : oTrace->uPathSize;
+         while (uNewSize <= ulPathLength)
+            uNewSize *= 2;
+         pcNew = (char*)realloc(oTrace->pcPath, uNewSize);
+         if (pcNew == NULL)
+            return MEMORY_ERROR;
+         oTrace->pcPath = pcNew;
+         oTrace->uPathSize = uNewSize;
+      }
+      if (fread(oTrace->pcPath, 1, (size_t)ulPathLength, psFile)
+          != (size_t)ulPathLength)
+         return IO_ERROR;
+      oTrace->pcPath[ulPathLength] = '\0';
+      psRecord->pcPath = oTrace->pcPath;
+   }
+   if (!Trace_getNumber(psFile, &ulLength))
+      return IO_ERROR;
+
+   psRecord->eOp = (enum TraceOp)iOp;
+   psRecord->iResult = (int)ulResult;
+   psRecord->bHasContents = (boolean)((iFlags & FLAG_CONTENTS) != 0);
+   psRecord->bIsFile = (boolean)((iFlags & FLAG_IS_FILE) != 0);
+   psRecord->uLength = (size_t)ulLength;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Trace_flush(Trace_T oTrace)
+{
+   assert(oTrace != NULL);
+   assert(oTrace->bWriting);
+
+   if (oTrace->iStatus == SUCCESS && fflush(oTrace->psFile) != 0)
+      oTrace->iStatus = IO_ERROR;
+   return oTrace->iStatus;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Trace_close(Trace_T oTrace)
+{
+   int iResult = SUCCESS;
+
+   assert(oTrace != NULL);
+
+   if (oTrace->bWriting)
+      iResult = Trace_flush(oTrace);
+   if (fclose(oTrace->psFile) != 0 && iResult == SUCCESS)
+      iResult = IO_ERROR;
+   free(oTrace->pcPath);
+   free(oTrace);
+   return iResult;
+}
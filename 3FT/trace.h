@@ -0,0 +1,111 @@
+/*--------------------------------------------------------------------*/
+/* trace.h                                                            */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+#ifndef TRACE_INCLUDED
+#define TRACE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/* A Trace_T object is a file of records of calls to the global
+   interface of a file tree, in the order they were made, written by
+   the fttrace shim and read back by ft_replay. A record holds the
+   operation, its path, the length it passed or got back, its result,
+   and when and for how long it ran. Numbers are stored as
+   variable-length integers, so that a record of a short path takes
+   a handful of bytes beyond the path. A trace is either being
+   written or being read, never both. */
+
+typedef struct Trace *Trace_T;
+
+/* The operations a record can hold, one for each function of the
+   interface that every implementation of ft.h shares. */
+
+enum TraceOp { TRACE_INIT, TRACE_DESTROY, TRACE_INSERT_DIR,
+               TRACE_CONTAINS_DIR, TRACE_RM_DIR, TRACE_INSERT_FILE,
+               TRACE_CONTAINS_FILE, TRACE_RM_FILE, TRACE_GET_CONTENTS,
+               TRACE_REPLACE, TRACE_STAT, TRACE_TO_STRING, TRACE_OPS };
+
+/* A record. iResult is the status or boolean the call returned, or,
+   for a call that returns a pointer, 1 if it was not NULL and 0 if it
+   was. pcPath is the path passed, or NULL if there was none.
+   bHasContents tells whether contents were passed, and uLength is
+   their length; for TRACE_STAT, bIsFile and uLength are what the
+   call stored, and for TRACE_TO_STRING, uLength is the length of the
+   string. ulGap is the time in nanoseconds from the start of the
+   previous call to the start of this one, and ulDuration is how long
+   this one took. */
+
+struct TraceRecord
+{
+   enum TraceOp eOp;
+   int iResult;
+   const char *pcPath;
+   boolean bHasContents;
+   boolean bIsFile;
+   size_t uLength;
+   unsigned long ulGap;
+   unsigned long ulDuration;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Return the name of the function of eOp, without its "FT_". */
+
+const char *Trace_getName(enum TraceOp eOp);
+
+/*--------------------------------------------------------------------*/
+
+/* Create an empty trace in the file named pcPath, replacing any file
+   there, for writing, and store it in *poTrace. Return SUCCESS,
+   IO_ERROR if the file cannot be created, or MEMORY_ERROR if
+   insufficient memory is available. */
+
+int Trace_create(const char *pcPath, Trace_T *poTrace);
+
+/*--------------------------------------------------------------------*/
+
+/* Open the trace in the file named pcPath for reading, and store it
+   in *poTrace. Return SUCCESS, IO_ERROR if the file cannot be opened
+   or is not a trace, or MEMORY_ERROR if insufficient memory is
+   available. */
+
+int Trace_open(const char *pcPath, Trace_T *poTrace);
+
+/*--------------------------------------------------------------------*/
+
+/* Append *psRecord to oTrace, which must have been created. The
+   record may stay buffered until oTrace is flushed or closed. Return
+   SUCCESS, or IO_ERROR if this or an earlier write of oTrace
+   failed. */
+
+int Trace_append(Trace_T oTrace, const struct TraceRecord *psRecord);
+
+/*--------------------------------------------------------------------*/
+
+/* Read the next record of oTrace, which must have been opened, into
+   *psRecord. Its pcPath is valid until the next call. Return SUCCESS,
+   NO_SUCH_PATH if there are no more records, IO_ERROR if the file
+   cannot be read or the record is cut short or malformed, or
+   MEMORY_ERROR if insufficient memory is available. */
+
+int Trace_next(Trace_T oTrace, struct TraceRecord *psRecord);
+
+/*--------------------------------------------------------------------*/
+
+/* Write the buffered records of oTrace to its file. Return SUCCESS,
+   or IO_ERROR if this or an earlier write of oTrace failed. */
+
+int Trace_flush(Trace_T oTrace);
+
+/*--------------------------------------------------------------------*/
+
+/* Flush oTrace if it was created, close its file and free it. Return
+   SUCCESS, or IO_ERROR as Trace_flush does, or if the file cannot be
+   closed. */
+
+int Trace_close(Trace_T oTrace);
+
+#endif
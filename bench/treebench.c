@@ -0,0 +1,500 @@
+/*--------------------------------------------------------------------*/
+/* treebench.c                                                        */
+/* Authors: Rohan Amin and Alex Luo                                   */
+/*--------------------------------------------------------------------*/
+
+/* for clock_gettime, getrusage and getopt under -std=c99 */
+#define _XOPEN_SOURCE 600
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/*
+   treebench drives any implementation of the tree interfaces of this
+   assignment through the same workloads, using only the interface
+   that every implementation shares, so that it links against the
+   sample objects as well as against our own. It is built against
+   ft.h by default, against dt.h with -DBENCH_DT and against bdt.h
+   with -DBENCH_BDT. The Makefiles of 1BDT, 2DT and 3FT all build this
+   one copy with -I. so that each finds its own headers.
+*/
+
+#if defined(BENCH_BDT)
+
+#include "bdt.h"
+
+/* A binary tree directory has at most two children, and no files */
+enum { MAX_FANOUT = 2, HAS_FILES = FALSE };
+
+static const char benchInterface[] = "bdt";
+
+static int Bench_init(void) { return BDT_init(); }
+static int Bench_destroy(void) { return BDT_destroy(); }
+static char *Bench_toString(void) { return BDT_toString(); }
+static int Bench_insert(char *path, boolean isFile) {
+   (void) isFile;
+   return BDT_insertPath(path);
+}
+static boolean Bench_contains(char *path, boolean isFile) {
+   (void) isFile;
+   return BDT_containsPath(path);
+}
+static int Bench_rm(char *path, boolean isFile) {
+   (void) isFile;
+   return BDT_rmPath(path);
+}
+
+#elif defined(BENCH_DT)
+
+#include "dt.h"
+
+/* A directory tree has no files */
+enum { MAX_FANOUT = 0, HAS_FILES = FALSE };
+
+static const char benchInterface[] = "dt";
+
+static int Bench_init(void) { return DT_init(); }
+static int Bench_destroy(void) { return DT_destroy(); }
+static char *Bench_toString(void) { return DT_toString(); }
+static int Bench_insert(char *path, boolean isFile) {
+   (void) isFile;
+   return DT_insertPath(path);
+}
+static boolean Bench_contains(char *path, boolean isFile) {
+   (void) isFile;
+   return DT_containsPath(path);
+}
+static int Bench_rm(char *path, boolean isFile) {
+   (void) isFile;
+   return DT_rmPath(path);
+}
+
+#else
+
+#include "ft.h"
+
+/* A file tree has no limit on children, and its leaves are files */
+enum { MAX_FANOUT = 0, HAS_FILES = TRUE };
+
+static const char benchInterface[] = "ft";
+
+/* The contents every file of the tree is given */
+static char benchContents[] = "contents";
+
+static int Bench_init(void) { return FT_init(); }
+static int Bench_destroy(void) { return FT_destroy(); }
+static char *Bench_toString(void) { return FT_toString(); }
+static int Bench_insert(char *path, boolean isFile) {
+   return isFile ? FT_insertFile(path, benchContents,
+                                 sizeof(benchContents))
+                 : FT_insertDir(path);
+}
+static boolean Bench_contains(char *path, boolean isFile) {
+   return isFile ? FT_containsFile(path) : FT_containsDir(path);
+}
+static int Bench_rm(char *path, boolean isFile) {
+   return isFile ? FT_rmFile(path) : FT_rmDir(path);
+}
+
+#endif
+
+/* Default number of nodes, and the fanouts of wide and deep trees */
+enum { DEFAULT_NODES = 100000, WIDE_FANOUT = 1000, DEEP_FANOUT = 2 };
+
+/* Percentage of the mixed phase's operations that are lookups in a
+   lookup-heavy and a mutation-heavy mix */
+enum { LOOKUP_HEAVY = 90, MUTATION_HEAVY = 10 };
+
+/* Longest path the bench generates, including the '\0', and the most
+   levels a path can have */
+enum { MAX_PATH = 4096, MAX_LEVELS = 64 };
+
+/*
+   Latencies are counted in a histogram whose buckets each cover a
+   sixteenth of a power of two of nanoseconds, so that percentiles are
+   within about 6% without keeping every sample, and without the
+   bench's own memory showing up in the peak RSS it reports.
+*/
+enum { SUB_BITS = 4, SUBS = 1 << SUB_BITS,
+       BUCKETS = SUBS + (64 - SUB_BITS) * SUBS };
+
+/*
+   Allocation counter. treebench is linked with
+   -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so that every
+   allocation made by the implementation under test goes through the
+   wrappers below and is counted.
+*/
+static size_t allocCount;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+/* Counts and forwards a call to malloc. */
+void *__wrap_malloc(size_t size) {
+   allocCount++;
+   return __real_malloc(size);
+}
+
+/* Counts and forwards a call to calloc. */
+void *__wrap_calloc(size_t nmemb, size_t size) {
+   allocCount++;
+   return __real_calloc(nmemb, size);
+}
+
+/* Counts and forwards a call to realloc. */
+void *__wrap_realloc(void *ptr, size_t size) {
+   allocCount++;
+   return __real_realloc(ptr, size);
+}
+
+/* The shape of the tree: node 0 is the root "r", and the children of
+   node k are nodes fanout*k+1 to fanout*k+fanout, so every level is
+   full but the last. Nodes with no children are files if the
+   interface has files. */
+static size_t nodes;
+static size_t fanout;
+
+/* Number of digits in a child's name, so that names sort in the
+   order of the nodes they name */
+static int width;
+
+/* One bit per node: set if the node is in the tree */
+static unsigned char *present;
+
+/*
+   One phase of the bench: the histogram of its operations'
+   latencies, its number of operations, and the time and allocation
+   count at its start.
+*/
+struct benchPhase {
+   size_t counts[BUCKETS];
+   size_t ops;
+   unsigned long start;
+   size_t allocs;
+};
+
+/* The phase being timed */
+static struct benchPhase phase;
+
+/* Returns the current time in nanoseconds. */
+static unsigned long Bench_now(void) {
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (unsigned long) now.tv_sec * 1000000000UL +
+          (unsigned long) now.tv_nsec;
+}
+
+/* Returns the histogram bucket of a latency of ns nanoseconds. */
+static size_t Bench_bucket(unsigned long ns) {
+   size_t shift = 0;
+
+   while((ns >> shift) >= 2 * SUBS)
+      shift++;
+   if(ns < SUBS)
+      return (size_t) ns;
+   return SUBS + shift * SUBS + (size_t) ((ns >> shift) - SUBS);
+}
+
+/* Returns the least latency, in nanoseconds, of bucket b. */
+static unsigned long Bench_latency(size_t b) {
+   if(b < SUBS)
+      return (unsigned long) b;
+   return (unsigned long) (SUBS + (b - SUBS) % SUBS) <<
+          ((b - SUBS) / SUBS);
+}
+
+/* Returns the latency, in nanoseconds, below which percent percent
+   of the phase's operations finished. */
+static unsigned long Bench_percentile(size_t percent) {
+   size_t seen = 0;
+   size_t b;
+
+   for(b = 0; b < BUCKETS; b++) {
+      seen += phase.counts[b];
+      if(seen * 100 >= phase.ops * percent && seen > 0)
+         return Bench_latency(b);
+   }
+   return 0;
+}
+
+/* Starts timing a new phase. */
+static void Bench_begin(void) {
+   memset(&phase, 0, sizeof(phase));
+   phase.allocs = allocCount;
+   phase.start = Bench_now();
+}
+
+/* Counts one operation of the phase that started at start. */
+static void Bench_count(unsigned long start) {
+   phase.counts[Bench_bucket(Bench_now() - start)]++;
+   phase.ops++;
+}
+
+/*
+   Prints one result line for the phase named name of the run that
+   label, shape, order and mix describe: its throughput, median and
+   99th percentile latencies, allocations, and the peak resident set
+   of the process so far.
+*/
+static void Bench_report(const char *label, const char *shape,
+                         const char *order, const char *mix,
+                         const char *name) {
+   double seconds = (double) (Bench_now() - phase.start) / 1e9;
+   struct rusage usage;
+
+   getrusage(RUSAGE_SELF, &usage);
+   printf("%-18s %-4s %-6s %-6s %-7s %9lu ops %12.0f ops/s "
+          "p50 %8lu ns p99 %8lu ns %9lu mallocs %8ld KB\n",
+          label, shape, order, mix, name, (unsigned long) phase.ops,
+          seconds > 0 ? phase.ops / seconds : 0.0,
+          Bench_percentile(50), Bench_percentile(99),
+          (unsigned long) (allocCount - phase.allocs),
+          (long) usage.ru_maxrss);
+}
+
+/* Returns TRUE if node k has no children. */
+static boolean Bench_isLeaf(size_t k) {
+   return fanout * k + 1 >= nodes;
+}
+
+/* Returns TRUE if node k is a file. */
+static boolean Bench_isFile(size_t k) {
+   return HAS_FILES && Bench_isLeaf(k);
+}
+
+/* Writes into path the path of node k. */
+static void Bench_path(char *path, size_t k) {
+   size_t levels[MAX_LEVELS];
+   size_t depth = 0;
+
+   assert(path != NULL);
+
+   for(; k != 0; k = (k - 1) / fanout) {
+      assert(depth < MAX_LEVELS);
+      levels[depth++] = (k - 1) % fanout;
+   }
+   path += sprintf(path, "r");
+   while(depth > 0)
+      path += sprintf(path, "/c%0*lu", width,
+                      (unsigned long) levels[--depth]);
+}
+
+/* Returns the node after node k in path order, which lists each node
+   before its children, or 0 after the last node. */
+static size_t Bench_nextSorted(size_t k) {
+   if(!Bench_isLeaf(k))
+      return fanout * k + 1;
+   for(; k != 0; k = (k - 1) / fanout)
+      if((k - 1) % fanout != fanout - 1 && k + 1 < nodes)
+         return k + 1;
+   return 0;
+}
+
+/* Returns a step that visits every node from 1 to nodes - 1 in a
+   scattered order when added to itself modulo nodes - 1. */
+static size_t Bench_randomStep(void) {
+   size_t step = 2654435761UL % (nodes - 1);
+   size_t a;
+   size_t b;
+   size_t t;
+
+   for(;; step++) {
+      /* The step works if it has no factor in common with nodes - 1 */
+      for(a = step, b = nodes - 1; b != 0; t = a % b, a = b, b = t)
+         ;
+      if(a == 1)
+         return step;
+   }
+}
+
+/* Marks node k as in the tree if isIn is TRUE, and out otherwise. */
+static void Bench_mark(size_t k, boolean isIn) {
+   if(isIn)
+      present[k / 8] |= (unsigned char) (1 << k % 8);
+   else
+      present[k / 8] &= (unsigned char) ~(1 << k % 8);
+}
+
+/* Returns TRUE if node k is in the tree. */
+static boolean Bench_isIn(size_t k) {
+   return (present[k / 8] >> k % 8) & 1;
+}
+
+/* Prints how to run treebench to stderr and exits with failure. */
+static void Bench_usage(const char *program) {
+   fprintf(stderr, "usage: %s [-s wide|deep] [-o sorted|random] "
+           "[-m lookup|mutate] [-n nodes] [-f fanout] [-i ops] "
+           "[-l label]\n", program);
+   exit(EXIT_FAILURE);
+}
+
+/*
+   Builds a tree of -n nodes that is wide (fanout 1000) or deep
+   (fanout 2), or has -f children per directory, inserting the nodes
+   in sorted or random order, then runs -i operations (-n by default)
+   that are mostly lookups or mostly mutations, then dumps the tree
+   with toString and destroys it, printing one line for each phase.
+   Lookups pick any node; mutations remove a leaf, or insert it back
+   if it is gone. Every answer is checked against what the bench
+   knows of the tree. The label, which defaults to the program's name,
+   tells apart the implementations it is linked with.
+   Returns 0, or exits with failure if the arguments are wrong.
+*/
+int main(int argc, char *argv[]) {
+   const char *label;
+   const char *shape = "wide";
+   const char *order = "sorted";
+   const char *mix = "lookup";
+   size_t lookupPercent = LOOKUP_HEAVY;
+   size_t ops = 0;
+   char path[MAX_PATH];
+   unsigned long seed = 1;
+   unsigned long start;
+   size_t firstLeaf;
+   size_t step;
+   size_t i;
+   size_t k;
+   int status;
+   char *dump;
+   int c;
+
+   label = strrchr(argv[0], '/') != NULL ? strrchr(argv[0], '/') + 1
+                                         : argv[0];
+   nodes = DEFAULT_NODES;
+   fanout = 0;
+   while((c = getopt(argc, argv, "s:o:m:n:f:i:l:")) != -1) {
+      switch(c) {
+         case 's':
+            shape = optarg;
+            if(strcmp(shape, "wide") && strcmp(shape, "deep"))
+               Bench_usage(argv[0]);
+            break;
+         case 'o':
+            order = optarg;
+            if(strcmp(order, "sorted") && strcmp(order, "random"))
+               Bench_usage(argv[0]);
+            break;
+         case 'm':
+            mix = optarg;
+            if(!strcmp(mix, "lookup"))
+               lookupPercent = LOOKUP_HEAVY;
+            else if(!strcmp(mix, "mutate"))
+               lookupPercent = MUTATION_HEAVY;
+            else
+               Bench_usage(argv[0]);
+            break;
+         case 'n':
+            nodes = (size_t) strtoul(optarg, NULL, 10);
+            break;
+         case 'f':
+            fanout = (size_t) strtoul(optarg, NULL, 10);
+            break;
+         case 'i':
+            ops = (size_t) strtoul(optarg, NULL, 10);
+            break;
+         case 'l':
+            label = optarg;
+            break;
+         default:
+            Bench_usage(argv[0]);
+      }
+   }
+   if(optind != argc || nodes < 2)
+      Bench_usage(argv[0]);
+   if(fanout == 0)
+      fanout = strcmp(shape, "wide") ? DEEP_FANOUT : WIDE_FANOUT;
+   if(MAX_FANOUT != 0 && fanout > MAX_FANOUT)
+      fanout = MAX_FANOUT;
+   if(ops == 0)
+      ops = nodes;
+   for(width = 1, k = fanout - 1; k >= 10; k /= 10)
+      width++;
+   firstLeaf = (nodes - 2) / fanout + 1;
+
+   present = calloc(nodes / 8 + 1, 1);
+   assert(present != NULL);
+   printf("%-18s %s tree of %lu nodes, fanout %lu\n", label,
+          benchInterface, (unsigned long) nodes, (unsigned long) fanout);
+
+   /* Builds the tree; in random order, a directory may already have
+      been made for one of its descendants */
+   assert(Bench_init() == SUCCESS);
+   Bench_begin();
+   if(!strcmp(order, "sorted"))
+      for(k = 0; ; ) {
+         Bench_path(path, k);
+         start = Bench_now();
+         status = Bench_insert(path, Bench_isFile(k));
+         Bench_count(start);
+         assert(status == SUCCESS);
+         Bench_mark(k, TRUE);
+         if((k = Bench_nextSorted(k)) == 0)
+            break;
+      }
+   else {
+      step = Bench_randomStep();
+      for(i = 0; i < nodes - 1; i++) {
+         k = i * step % (nodes - 1) + 1;
+         Bench_path(path, k);
+         start = Bench_now();
+         status = Bench_insert(path, Bench_isFile(k));
+         Bench_count(start);
+         assert(status == SUCCESS || status == ALREADY_IN_TREE);
+         Bench_mark(k, TRUE);
+      }
+      Bench_mark(0, TRUE);
+   }
+   Bench_report(label, shape, order, mix, "build");
+
+   Bench_begin();
+   for(i = 0; i < ops; i++) {
+      seed = seed * 1103515245UL + 12345UL;
+      if((seed >> 8) % 100 < lookupPercent) {
+         k = (size_t) (seed >> 16) % nodes;
+         Bench_path(path, k);
+         start = Bench_now();
+         status = Bench_contains(path, Bench_isFile(k));
+         Bench_count(start);
+         assert(status == (int) Bench_isIn(k));
+      }
+      else {
+         k = firstLeaf + (size_t) (seed >> 16) % (nodes - firstLeaf);
+         Bench_path(path, k);
+         start = Bench_now();
+         if(Bench_isIn(k))
+            status = Bench_rm(path, Bench_isFile(k));
+         else
+            status = Bench_insert(path, Bench_isFile(k));
+         Bench_count(start);
+         assert(status == SUCCESS);
+         Bench_mark(k, !Bench_isIn(k));
+      }
+   }
+   Bench_report(label, shape, order, mix, "mix");
+
+   Bench_begin();
+   start = Bench_now();
+   dump = Bench_toString();
+   Bench_count(start);
+   assert(dump != NULL);
+   Bench_report(label, shape, order, mix, "dump");
+   free(dump);
+
+   Bench_begin();
+   start = Bench_now();
+   status = Bench_destroy();
+   Bench_count(start);
+   assert(status == SUCCESS);
+   Bench_report(label, shape, order, mix, "destroy");
+
+   free(present);
+   return 0;
+}